@@ -0,0 +1,39 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef BASE__MESSAGE_PRIORITY_H
+#define BASE__MESSAGE_PRIORITY_H
+
+namespace base {
+
+// Priority of a message sent through a channel. The queued messages of a higher priority are
+// written before the messages of a lower priority. The values are ordered from the highest
+// priority to the lowest one.
+enum class MessagePriority
+{
+    CONTROL = 0, // Control messages and input events.
+    CURSOR  = 1, // Shapes of the mouse cursor.
+    VIDEO   = 2, // Video packets.
+    BULK    = 3  // File transfer data.
+};
+
+constexpr int kMessagePriorityCount = 4;
+
+} // namespace base
+
+#endif // BASE__MESSAGE_PRIORITY_H
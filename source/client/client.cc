@@ -65,21 +65,16 @@ base::Version Client::clientVersion() const
     return base::Version(ASPIA_VERSION_MAJOR, ASPIA_VERSION_MINOR, ASPIA_VERSION_PATCH);
 }
 
-void Client::sendMessage(const google::protobuf::MessageLite& message)
+void Client::sendMessage(const google::protobuf::MessageLite& message,
+                         base::MessagePriority priority)
 {
-    size_t size = message.ByteSizeLong();
-    if (!size)
+    if (!message.ByteSizeLong())
     {
         LOG(LS_WARNING) << "Empty messages are not allowed";
         return;
     }
 
-    QByteArray buffer;
-    buffer.resize(size);
-
-    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer.data()));
-
-    channel_->send(buffer);
+    channel_->sendMessage(message, priority);
 }
 
 // static
@@ -59,8 +59,9 @@ protected:
     // Reads the incoming message for the session.
     virtual void messageReceived(const QByteArray& buffer) = 0;
 
-    // Sends outgoing message.
-    void sendMessage(const google::protobuf::MessageLite& message);
+    // Sends outgoing message. Messages with a higher |priority| are sent to the host first.
+    void sendMessage(const google::protobuf::MessageLite& message,
+                     base::MessagePriority priority = base::MessagePriority::CONTROL);
 
 private:
     static QString networkErrorToString(net::Channel::Error error);
@@ -18,17 +18,41 @@
 
 #include "client/client_desktop.h"
 #include "base/logging.h"
+#include "client/video_decode_thread.h"
 #include "codec/cursor_decoder.h"
-#include "codec/video_decoder.h"
 #include "codec/video_util.h"
 #include "common/desktop_session_constants.h"
+#include "desktop/desktop_frame_qimage.h"
 #include "desktop/mouse_cursor.h"
 
 #include <QCursor>
+#include <QGuiApplication>
+#include <QScreen>
 #include <QPixmap>
 
 namespace client {
 
+namespace {
+
+// Used if the refresh rate of the screen is unknown.
+const double kDefaultRefreshRate = 60.0;
+
+std::chrono::microseconds frameInterval()
+{
+    double refresh_rate = 0;
+
+    QScreen* screen = QGuiApplication::primaryScreen();
+    if (screen)
+        refresh_rate = screen->refreshRate();
+
+    if (refresh_rate < 1.0)
+        refresh_rate = kDefaultRefreshRate;
+
+    return std::chrono::microseconds(static_cast<int64_t>(1000000.0 / refresh_rate));
+}
+
+} // namespace
+
 ClientDesktop::ClientDesktop(const ConnectData& connect_data, Delegate* delegate, QObject* parent)
     : Client(connect_data, parent),
       delegate_(delegate)
@@ -51,7 +75,10 @@ void ClientDesktop::messageReceived(const QByteArray& buffer)
     if (incoming_message_.has_video_packet() || incoming_message_.has_cursor_shape())
     {
         if (incoming_message_.has_video_packet())
-            readVideoPacket(incoming_message_.video_packet());
+        {
+            readVideoPacket(std::unique_ptr<proto::desktop::VideoPacket>(
+                incoming_message_.release_video_packet()));
+        }
 
         if (incoming_message_.has_cursor_shape())
             readCursorShape(incoming_message_.cursor_shape());
@@ -144,7 +171,14 @@ void ClientDesktop::sendConfig(const proto::desktop::Config& config)
         cursor_decoder_.reset();
 
     outgoing_message_.Clear();
-    outgoing_message_.mutable_config()->CopyFrom(config);
+
+    proto::desktop::Config* outgoing_config = outgoing_message_.mutable_config();
+    outgoing_config->CopyFrom(config);
+
+    // We enable only those video features that are supported by both sides.
+    video_features_ = supported_video_features_ & common::kSupportedVideoFeatures;
+    outgoing_config->set_video_features(video_features_);
+
     sendMessage(outgoing_message_);
 }
 
@@ -174,6 +208,17 @@ void ClientDesktop::sendSystemInfoRequest()
     sendMessage(outgoing_message_);
 }
 
+void ClientDesktop::sendFrameAck(int packet_count)
+{
+    proto::desktop::FrameAck frame_ack;
+    frame_ack.set_packet_count(packet_count);
+
+    outgoing_message_.Clear();
+    outgoing_message_.mutable_extension()->set_name(common::kFrameAckExtension);
+    outgoing_message_.mutable_extension()->set_data(frame_ack.SerializeAsString());
+    sendMessage(outgoing_message_);
+}
+
 void ClientDesktop::readConfigRequest(const proto::desktop::ConfigRequest& config_request)
 {
     // The list of extensions is passed as a string. Extensions are separated by a semicolon.
@@ -183,6 +228,9 @@ void ClientDesktop::readConfigRequest(const proto::desktop::ConfigRequest& confi
     // The list of supported video encodings is passed as a bit field.
     supported_video_encodings_ = config_request.video_encodings();
 
+    // The list of supported video features is passed as a bit field. Old hosts do not send it.
+    supported_video_features_ = config_request.video_features();
+
     // We notify the window about changes in the list of extensions.
     // A window can disable/enable some of its capabilities in accordance with this information.
     delegate_->extensionListChanged();
@@ -209,23 +257,12 @@ void ClientDesktop::readConfigRequest(const proto::desktop::ConfigRequest& confi
     }
 }
 
-void ClientDesktop::readVideoPacket(const proto::desktop::VideoPacket& packet)
+void ClientDesktop::readVideoPacket(std::unique_ptr<proto::desktop::VideoPacket> packet)
 {
-    if (video_encoding_ != packet.encoding())
-    {
-        video_decoder_ = codec::VideoDecoder::create(packet.encoding());
-        video_encoding_ = packet.encoding();
-    }
-
-    if (!video_decoder_)
-    {
-        onSessionError(tr("Video decoder not initialized"));
-        return;
-    }
-
-    if (packet.has_format())
+    if (packet->has_format())
     {
-        desktop::Rect screen_rect = codec::VideoUtil::fromVideoRect(packet.format().screen_rect());
+        desktop::Rect screen_rect =
+            codec::VideoUtil::fromVideoRect(packet->format().screen_rect());
 
         static const int kMaxValue = std::numeric_limits<uint16_t>::max();
         static const int kMinValue = -std::numeric_limits<uint16_t>::max();
@@ -244,23 +281,67 @@ void ClientDesktop::readVideoPacket(const proto::desktop::VideoPacket& packet)
             return;
         }
 
-        delegate_->setDesktopRect(screen_rect);
+        // The new geometry is applied when the first frame with it is presented.
     }
 
-    desktop::Frame* frame = delegate_->desktopFrame();
-    if (!frame)
+    if (!decode_thread_)
     {
-        onSessionError(tr("The desktop frame is not initialized"));
-        return;
+        // The decoded frames are not passed to the widget more often than the screen is
+        // refreshed.
+        decode_thread_ = std::make_unique<VideoDecodeThread>(0, frameInterval(), this);
+        decode_thread_->start();
     }
 
-    if (!video_decoder_->decode(packet, frame))
+    // The packet is decoded on its own thread, the frame is received in customEvent.
+    decode_thread_->decodePacket(std::move(packet));
+}
+
+void ClientDesktop::customEvent(QEvent* event)
+{
+    if (event->type() != VideoDecodeThread::FrameEvent::kType)
+        return;
+
+    VideoDecodeThread::FrameEvent* frame_event = static_cast<VideoDecodeThread::FrameEvent*>(event);
+
+    const std::shared_ptr<desktop::FrameQImage>& frame = frame_event->frame();
+    if (!frame)
     {
         onSessionError(tr("The video packet could not be decoded"));
         return;
     }
 
-    delegate_->drawDesktop();
+    const VideoDecodeThread::FrameInfo& info = frame_event->info();
+    statistics_.addDecodedFrame(info.packet_count, info.decode_time, info.latency);
+
+    frame_time_ = FrameStatistics::Clock::now();
+    frame_painted_ = false;
+
+    // The frames decoded before the format packet have the previous geometry.
+    if (info.screen_rect != screen_rect_)
+    {
+        screen_rect_ = info.screen_rect;
+        delegate_->setDesktopRect(screen_rect_);
+    }
+
+    delegate_->drawDesktop(frame, info.changed_region);
+
+    // The widget paints the new frame, the previous one can be overwritten.
+    decode_thread_->framePresented();
+
+    if (video_features_ & proto::desktop::VIDEO_FEATURE_FRAME_ACK)
+        sendFrameAck(info.packet_count);
+}
+
+void ClientDesktop::desktopPainted()
+{
+    // Only the first paint of the frame is counted.
+    if (frame_painted_)
+        return;
+
+    frame_painted_ = true;
+
+    statistics_.addPaintedFrame(std::chrono::duration_cast<std::chrono::microseconds>(
+        FrameStatistics::Clock::now() - frame_time_));
 }
 
 void ClientDesktop::readCursorShape(const proto::desktop::CursorShape& cursor_shape)
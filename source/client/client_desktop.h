@@ -20,21 +20,24 @@
 #define CLIENT__CLIENT_DESKTOP_H
 
 #include "client/client.h"
+#include "client/frame_statistics.h"
 #include "desktop/desktop_geometry.h"
+#include "desktop/desktop_region.h"
 #include "proto/desktop_extensions.pb.h"
 #include "proto/system_info.pb.h"
 
 namespace codec {
 class CursorDecoder;
-class VideoDecoder;
 } // namespace codec
 
 namespace desktop {
-class Frame;
+class FrameQImage;
 } // namespace desktop
 
 namespace client {
 
+class VideoDecodeThread;
+
 class ClientDesktop : public Client
 {
     Q_OBJECT
@@ -48,9 +51,15 @@ public:
         virtual void extensionListChanged() = 0;
         virtual void configRequered() = 0;
 
+        // Called before drawDesktop if the position or size of the screen of its frame differs
+        // from the previous frame.
         virtual void setDesktopRect(const desktop::Rect& screen_rect) = 0;
-        virtual void drawDesktop() = 0;
-        virtual desktop::Frame* desktopFrame() = 0;
+
+        // Called when video packets are decoded. |frame| contains the whole screen,
+        // |changed_region| contains the areas changed since the previous call. The size of
+        // |frame| can differ from the previous one only after setDesktopRect.
+        virtual void drawDesktop(std::shared_ptr<desktop::FrameQImage> frame,
+                                 const desktop::Region& changed_region) = 0;
 
         virtual void setRemoteCursor(const QCursor& cursor) = 0;
         virtual void setRemoteClipboard(const proto::desktop::ClipboardEvent& event) = 0;
@@ -63,6 +72,7 @@ public:
 
     const QStringList& supportedExtensions() const { return supported_extensions_; }
     uint32_t supportedVideoEncodings() const { return supported_video_encodings_; }
+    uint32_t supportedVideoFeatures() const { return supported_video_features_; }
 
     void sendKeyEvent(uint32_t usb_keycode, uint32_t flags);
     void sendPointerEvent(const QPoint& pos, uint32_t mask);
@@ -73,17 +83,26 @@ public:
     void sendRemoteUpdate();
     void sendSystemInfoRequest();
 
+    // Called when the widget has painted the desktop.
+    void desktopPainted();
+
 protected:
     // Client implementation.
     void messageReceived(const QByteArray& buffer) override;
 
+    // QObject implementation.
+    void customEvent(QEvent* event) override;
+
 private:
     void readConfigRequest(const proto::desktop::ConfigRequest& config_request);
-    void readVideoPacket(const proto::desktop::VideoPacket& packet);
+    void readVideoPacket(std::unique_ptr<proto::desktop::VideoPacket> packet);
     void readCursorShape(const proto::desktop::CursorShape& cursor_shape);
     void readClipboardEvent(const proto::desktop::ClipboardEvent& clipboard_event);
     void readExtension(const proto::desktop::Extension& extension);
 
+    // Tells the host that |packet_count| video packets are decoded.
+    void sendFrameAck(int packet_count);
+
     void onSessionError(const QString& message);
 
     Delegate* delegate_;
@@ -93,9 +112,20 @@ private:
 
     QStringList supported_extensions_;
     uint32_t supported_video_encodings_ = 0;
+    uint32_t supported_video_features_ = 0;
+
+    // Video features enabled by the last sent configuration.
+    uint32_t video_features_ = 0;
+
+    std::unique_ptr<VideoDecodeThread> decode_thread_;
+
+    // Position and size of the screen of the last presented frame.
+    desktop::Rect screen_rect_;
 
-    proto::desktop::VideoEncoding video_encoding_ = proto::desktop::VIDEO_ENCODING_UNKNOWN;
-    std::unique_ptr<codec::VideoDecoder> video_decoder_;
+    // Decode and paint times of the frames for diagnostics.
+    FrameStatistics statistics_;
+    FrameStatistics::Clock::time_point frame_time_;
+    bool frame_painted_ = true;
     std::unique_ptr<codec::CursorDecoder> cursor_decoder_;
 
     DISALLOW_COPY_AND_ASSIGN(ClientDesktop);
@@ -74,7 +74,7 @@ void ClientFileTransfer::messageReceived(const QByteArray& buffer)
 void ClientFileTransfer::remoteRequest(common::FileRequest* request)
 {
     requests_.push_back(QPointer<common::FileRequest>(request));
-    sendMessage(request->request());
+    sendMessage(request->request(), base::MessagePriority::BULK);
 }
 
 void ClientFileTransfer::onSessionError(const QString& message)
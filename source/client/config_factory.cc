@@ -19,6 +19,7 @@
 #include "client/config_factory.h"
 #include "base/logging.h"
 #include "codec/video_util.h"
+#include "common/desktop_session_constants.h"
 
 namespace client {
 
@@ -63,6 +64,7 @@ void ConfigFactory::setDefaultDesktopManageConfig(proto::desktop::Config* config
     config->set_video_encoding(proto::desktop::VideoEncoding::VIDEO_ENCODING_ZSTD);
     config->set_compress_ratio(kDefCompressRatio);
     config->set_update_interval(kDefUpdateInterval);
+    config->set_scale_factor(common::kMaxScaleFactor);
 
     codec::VideoUtil::toVideoPixelFormat(
         desktop::PixelFormat::RGB565(), config->mutable_pixel_format());
@@ -80,6 +82,7 @@ void ConfigFactory::setDefaultDesktopViewConfig(proto::desktop::Config* config)
     config->set_video_encoding(proto::desktop::VideoEncoding::VIDEO_ENCODING_ZSTD);
     config->set_compress_ratio(kDefCompressRatio);
     config->set_update_interval(kDefUpdateInterval);
+    config->set_scale_factor(common::kMaxScaleFactor);
 
     codec::VideoUtil::toVideoPixelFormat(
         desktop::PixelFormat::RGB565(), config->mutable_pixel_format());
@@ -88,7 +91,11 @@ void ConfigFactory::setDefaultDesktopViewConfig(proto::desktop::Config* config)
 // static
 void ConfigFactory::fixupDesktopConfig(proto::desktop::Config* config)
 {
-    config->set_scale_factor(100);
+    if (config->scale_factor() < common::kMinScaleFactor ||
+        config->scale_factor() > common::kMaxScaleFactor)
+    {
+        config->set_scale_factor(common::kMaxScaleFactor);
+    }
 
     if (config->update_interval() < kMinUpdateInterval || config->update_interval() > kMaxUpdateInterval)
         config->set_update_interval(kDefUpdateInterval);
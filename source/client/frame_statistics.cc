@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/frame_statistics.h"
+#include "base/logging.h"
+
+#include <algorithm>
+
+namespace client {
+
+namespace {
+
+const std::chrono::seconds kLogInterval(10);
+
+double averageMs(std::chrono::microseconds total, int64_t count)
+{
+    if (!count)
+        return 0;
+
+    return static_cast<double>(total.count()) / count / 1000.0;
+}
+
+} // namespace
+
+FrameStatistics::FrameStatistics()
+    : period_start_(Clock::now())
+{
+    // Nothing
+}
+
+void FrameStatistics::addDecodedFrame(int packet_count,
+                                      std::chrono::microseconds decode_time,
+                                      std::chrono::microseconds latency)
+{
+    ++frame_count_;
+    packet_count_ += packet_count;
+    decode_time_ += decode_time;
+    latency_ += latency;
+    max_latency_ = std::max(max_latency_, latency);
+
+    logIfNeeded();
+}
+
+void FrameStatistics::addPaintedFrame(std::chrono::microseconds paint_latency)
+{
+    ++painted_count_;
+    paint_latency_ += paint_latency;
+}
+
+void FrameStatistics::logIfNeeded()
+{
+    const Clock::time_point now = Clock::now();
+    if (now - period_start_ < kLogInterval)
+        return;
+
+    LOG(LS_INFO) << "Video frames: " << frame_count_
+                 << " (packets: " << packet_count_
+                 << ", painted: " << painted_count_
+                 << "), decode: " << averageMs(decode_time_, frame_count_)
+                 << " ms, latency: " << averageMs(latency_, frame_count_)
+                 << " ms (max: " << averageMs(max_latency_, 1)
+                 << " ms), paint latency: " << averageMs(paint_latency_, painted_count_) << " ms";
+
+    period_start_ = now;
+    frame_count_ = 0;
+    packet_count_ = 0;
+    painted_count_ = 0;
+    decode_time_ = std::chrono::microseconds::zero();
+    latency_ = std::chrono::microseconds::zero();
+    paint_latency_ = std::chrono::microseconds::zero();
+    max_latency_ = std::chrono::microseconds::zero();
+}
+
+} // namespace client
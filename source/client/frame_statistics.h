@@ -0,0 +1,68 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FRAME_STATISTICS_H
+#define CLIENT__FRAME_STATISTICS_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace client {
+
+// Collects the decode and paint times of the video frames of a desktop session and writes the
+// averages to the log periodically.
+class FrameStatistics
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FrameStatistics();
+    ~FrameStatistics() = default;
+
+    // |packet_count| packets were decoded into one frame. |decode_time| is the time spent in the
+    // decoders, |latency| is the time from the receipt of the first packet to the end of
+    // decoding.
+    void addDecodedFrame(int packet_count,
+                         std::chrono::microseconds decode_time,
+                         std::chrono::microseconds latency);
+
+    // The frame was painted |paint_latency| after the end of decoding.
+    void addPaintedFrame(std::chrono::microseconds paint_latency);
+
+private:
+    void logIfNeeded();
+
+    Clock::time_point period_start_;
+
+    int64_t frame_count_ = 0;
+    int64_t packet_count_ = 0;
+    int64_t painted_count_ = 0;
+
+    std::chrono::microseconds decode_time_{ 0 };
+    std::chrono::microseconds latency_{ 0 };
+    std::chrono::microseconds paint_latency_{ 0 };
+    std::chrono::microseconds max_latency_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(FrameStatistics);
+};
+
+} // namespace client
+
+#endif // CLIENT__FRAME_STATISTICS_H
@@ -20,6 +20,7 @@
 #include "base/logging.h"
 #include "client/config_factory.h"
 #include "codec/video_util.h"
+#include "common/desktop_session_constants.h"
 
 namespace client {
 
@@ -52,12 +53,30 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (video_encodings & proto::desktop::VIDEO_ENCODING_VP9)
         combo_codec->addItem(QLatin1String("VP9"), proto::desktop::VIDEO_ENCODING_VP9);
 
+    if (video_encodings & proto::desktop::VIDEO_ENCODING_VP9_I444)
+    {
+        combo_codec->addItem(QLatin1String("VP9 (4:4:4)"),
+                             proto::desktop::VIDEO_ENCODING_VP9_I444);
+    }
+
+    if (video_encodings & proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS)
+    {
+        combo_codec->addItem(tr("VP9 (lossless)"),
+                             proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS);
+    }
+
     if (video_encodings & proto::desktop::VIDEO_ENCODING_VP8)
         combo_codec->addItem(QLatin1String("VP8"), proto::desktop::VIDEO_ENCODING_VP8);
 
     if (video_encodings & proto::desktop::VIDEO_ENCODING_ZSTD)
         combo_codec->addItem(QLatin1String("ZSTD"), proto::desktop::VIDEO_ENCODING_ZSTD);
 
+    if (video_encodings & proto::desktop::VIDEO_ENCODING_HYBRID)
+    {
+        combo_codec->addItem(QLatin1String("ZSTD + VP9"),
+                             proto::desktop::VIDEO_ENCODING_HYBRID);
+    }
+
     int current_codec = combo_codec->findData(config_.video_encoding());
     if (current_codec == -1)
         current_codec = 0;
@@ -96,6 +115,10 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
 
     ui.spin_update_interval->setValue(config_.update_interval());
 
+    ui.spin_scale_factor->setRange(static_cast<int>(common::kMinScaleFactor),
+                                   static_cast<int>(common::kMaxScaleFactor));
+    ui.spin_scale_factor->setValue(static_cast<int>(config_.scale_factor()));
+
     if (session_type == proto::SESSION_TYPE_DESKTOP_MANAGE)
     {
         if (config_.flags() & proto::desktop::BLOCK_REMOTE_INPUT)
@@ -134,8 +157,11 @@ DesktopConfigDialog::~DesktopConfigDialog() = default;
 
 void DesktopConfigDialog::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::desktop::VIDEO_ENCODING_ZSTD);
+    const int encoding = ui.combo_codec->itemData(item_index).toInt();
+
+    // The hybrid encoding sends the text and the user interface with Zstd.
+    bool has_pixel_format = (encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+                             encoding == proto::desktop::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -159,7 +185,8 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
 
         config_.set_video_encoding(video_encoding);
 
-        if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD)
+        if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+            video_encoding == proto::desktop::VIDEO_ENCODING_HYBRID)
         {
             desktop::PixelFormat pixel_format;
 
@@ -196,6 +223,7 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
         }
 
         config_.set_update_interval(ui.spin_update_interval->value());
+        config_.set_scale_factor(ui.spin_scale_factor->value());
 
         uint32_t flags = 0;
 
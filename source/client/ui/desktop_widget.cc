@@ -25,6 +25,8 @@
 #include <QPainter>
 #include <QWheelEvent>
 
+#include <cmath>
+
 namespace client {
 
 namespace {
@@ -69,9 +71,31 @@ DesktopWidget::DesktopWidget(Delegate* delegate, QWidget* parent)
     setMouseTracking(true);
 }
 
-void DesktopWidget::setDesktopSize(const desktop::Size& screen_size)
+void DesktopWidget::setDesktopFrame(std::shared_ptr<desktop::FrameQImage> frame,
+                                    const desktop::Region& changed_region)
 {
-    frame_ = desktop::FrameQImage::create(screen_size);
+    if (!frame_ || frame_->size() != frame->size())
+    {
+        frame_ = std::move(frame);
+        update();
+        return;
+    }
+
+    frame_ = std::move(frame);
+
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(frame_->size());
+    QRegion update_region;
+
+    for (desktop::Region::Iterator it(changed_region); !it.isAtEnd(); it.advance())
+    {
+        desktop::Rect rect = it.rect();
+        rect.intersectWith(frame_rect);
+
+        if (!rect.isEmpty())
+            update_region += toWidgetRect(rect);
+    }
+
+    update(update_region.intersected(rect()));
 }
 
 desktop::Frame* DesktopWidget::desktopFrame()
@@ -222,13 +246,26 @@ void DesktopWidget::enableKeyCombinations(bool enable)
 #endif // defined(OS_WIN)
 }
 
-void DesktopWidget::paintEvent(QPaintEvent* /* event */)
+void DesktopWidget::paintEvent(QPaintEvent* event)
 {
     if (frame_)
     {
         QPainter painter(this);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform);
-        painter.drawImage(rect(), frame_->constImage());
+        const QImage& image = frame_->constImage();
+
+        if (image.size() == size())
+        {
+            // Without scaling the changed rectangles are copied from the frame as is.
+            for (const QRect& rect : event->region())
+                painter.drawImage(rect, image, rect);
+        }
+        else
+        {
+            // The painter is clipped to the region of the event, so only the changed areas
+            // are scaled.
+            painter.setRenderHint(QPainter::SmoothPixmapTransform);
+            painter.drawImage(rect(), image);
+        }
     }
 
     delegate_->onDrawDesktop();
@@ -312,6 +349,26 @@ void DesktopWidget::focusOutEvent(QFocusEvent* event)
     QWidget::focusOutEvent(event);
 }
 
+QRect DesktopWidget::toWidgetRect(const desktop::Rect& rect) const
+{
+    const desktop::Size& frame_size = frame_->size();
+
+    if (frame_size.toQSize() == size())
+        return QRect(rect.x(), rect.y(), rect.width(), rect.height());
+
+    const double scale_x = static_cast<double>(width()) / frame_size.width();
+    const double scale_y = static_cast<double>(height()) / frame_size.height();
+
+    // The smooth scaling takes the neighboring pixels into account, so the rectangle is expanded
+    // by one pixel.
+    const int left = static_cast<int>(std::floor(rect.left() * scale_x)) - 1;
+    const int top = static_cast<int>(std::floor(rect.top() * scale_y)) - 1;
+    const int right = static_cast<int>(std::ceil(rect.right() * scale_x)) + 1;
+    const int bottom = static_cast<int>(std::ceil(rect.bottom() * scale_y)) + 1;
+
+    return QRect(left, top, right - left, bottom - top);
+}
+
 void DesktopWidget::executeKeyEvent(uint32_t usb_keycode, uint32_t flags)
 {
     if (flags & proto::desktop::KeyEvent::PRESSED)
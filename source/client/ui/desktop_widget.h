@@ -24,6 +24,7 @@
 #include "base/win/scoped_user_object.h"
 #endif // defined(OS_WIN)
 #include "desktop/desktop_frame.h"
+#include "desktop/desktop_region.h"
 
 #include <QEvent>
 #include <QWidget>
@@ -55,7 +56,11 @@ public:
     DesktopWidget(Delegate* delegate, QWidget* parent);
     ~DesktopWidget() = default;
 
-    void setDesktopSize(const desktop::Size& screen_size);
+    // Replaces the painted frame and repaints |changed_region| of it. The rest of the widget is
+    // not repainted if the size of the frame is not changed, otherwise the whole widget is
+    // repainted.
+    void setDesktopFrame(std::shared_ptr<desktop::FrameQImage> frame,
+                         const desktop::Region& changed_region);
     desktop::Frame* desktopFrame();
 
     void doMouseEvent(QEvent::Type event_type,
@@ -86,6 +91,9 @@ protected:
     void focusOutEvent(QFocusEvent* event) override;
 
 private:
+    // Converts the rectangle of the frame to the rectangle of the scaled widget which covers it.
+    QRect toWidgetRect(const desktop::Rect& rect) const;
+
     void executeKeyEvent(uint32_t usb_keycode, uint32_t flags);
 
 #if defined(OS_WIN)
@@ -96,7 +104,7 @@ private:
 
     Delegate* delegate_;
 
-    std::unique_ptr<desktop::FrameQImage> frame_;
+    std::shared_ptr<desktop::FrameQImage> frame_;
     bool enable_key_sequenses_ = true;
 
     QPoint prev_pos_;
@@ -172,32 +172,31 @@ void DesktopWindow::configRequered()
 }
 
 void DesktopWindow::setDesktopRect(const desktop::Rect& screen_rect)
+{
+    // The widget is resized when it receives the frame of the new size in drawDesktop.
+    screen_top_left_ = screen_rect.topLeft();
+}
+
+void DesktopWindow::drawDesktop(std::shared_ptr<desktop::FrameQImage> frame,
+                                const desktop::Region& changed_region)
 {
     desktop::Size prev_size;
 
-    desktop::Frame* frame = desktop_->desktopFrame();
-    if (frame)
-        prev_size = desktop_->desktopFrame()->size();
+    desktop::Frame* prev_frame = desktop_->desktopFrame();
+    if (prev_frame)
+        prev_size = prev_frame->size();
+
+    const desktop::Size screen_size = frame->size();
 
-    desktop::Size screen_size = screen_rect.size();
+    desktop_->setDesktopFrame(std::move(frame), changed_region);
+
+    if (screen_size == prev_size)
+        return;
 
-    desktop_->setDesktopSize(screen_size);
     scaleDesktop();
 
     if (prev_size.isEmpty())
         autosizeWindow();
-
-    screen_top_left_ = screen_rect.topLeft();
-}
-
-void DesktopWindow::drawDesktop()
-{
-    desktop_->update();
-}
-
-desktop::Frame* DesktopWindow::desktopFrame()
-{
-    return desktop_->desktopFrame();
 }
 
 void DesktopWindow::setRemoteCursor(const QCursor& cursor)
@@ -303,6 +302,10 @@ void DesktopWindow::onKeyEvent(uint32_t usb_keycode, uint32_t flags)
 
 void DesktopWindow::onDrawDesktop()
 {
+    ClientDesktop* client = desktopClient();
+    if (client)
+        client->desktopPainted();
+
     panel_->update();
 }
 
@@ -521,6 +524,11 @@ ClientDesktop* DesktopWindow::desktopClient()
     return static_cast<ClientDesktop*>(currentClient());
 }
 
+desktop::Frame* DesktopWindow::desktopFrame()
+{
+    return desktop_->desktopFrame();
+}
+
 // static
 QString DesktopWindow::createWindowTitle(const ConnectData& connect_data)
 {
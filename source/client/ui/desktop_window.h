@@ -34,6 +34,7 @@ class Clipboard;
 
 namespace desktop {
 class Frame;
+class FrameQImage;
 } // namespace desktop
 
 namespace client {
@@ -57,8 +58,8 @@ public:
     void extensionListChanged() override;
     void configRequered() override;
     void setDesktopRect(const desktop::Rect& screen_rect) override;
-    void drawDesktop() override;
-    desktop::Frame* desktopFrame() override;
+    void drawDesktop(std::shared_ptr<desktop::FrameQImage> frame,
+                     const desktop::Region& changed_region) override;
     void setRemoteCursor(const QCursor& cursor) override;
     void setRemoteClipboard(const proto::desktop::ClipboardEvent& event) override;
     void setScreenList(const proto::desktop::ScreenList& screen_list) override;
@@ -89,6 +90,7 @@ private slots:
 
 private:
     ClientDesktop* desktopClient();
+    desktop::Frame* desktopFrame();
 
     static QString createWindowTitle(const ConnectData& connect_data);
 
@@ -0,0 +1,293 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/video_decode_thread.h"
+#include "base/logging.h"
+#include "codec/tile_cache_decoder.h"
+#include "codec/video_decoder.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame_qimage.h"
+
+#include <QCoreApplication>
+
+namespace client {
+
+namespace {
+
+// Width and height of the tiles of the tile cache (see proto::desktop::CacheTile).
+const int kCacheTileSize = 64;
+
+// Adds the areas of the frame which are changed by |packet| to |region|.
+void addPacketRegion(const proto::desktop::VideoPacket& packet, desktop::Region* region)
+{
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+        region->addRect(codec::VideoUtil::fromVideoRect(packet.dirty_rect(i)));
+
+    for (int i = 0; i < packet.part_size(); ++i)
+        addPacketRegion(packet.part(i), region);
+
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
+    {
+        const proto::desktop::CopyRect& copy_rect = packet.copy_rect(i);
+
+        region->addRect(desktop::Rect::makeXYWH(copy_rect.dest_x(),
+                                                copy_rect.dest_y(),
+                                                copy_rect.source_rect().width(),
+                                                copy_rect.source_rect().height()));
+    }
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::desktop::CacheTile& tile = packet.cached_tile(i);
+
+        region->addRect(
+            desktop::Rect::makeXYWH(tile.x(), tile.y(), kCacheTileSize, kCacheTileSize));
+    }
+}
+
+} // namespace
+
+VideoDecodeThread::VideoDecodeThread(int thread_count,
+                                     std::chrono::microseconds frame_interval,
+                                     QObject* parent)
+    : QThread(parent),
+      thread_count_(thread_count),
+      frame_interval_(frame_interval)
+{
+    // Nothing
+}
+
+VideoDecodeThread::~VideoDecodeThread()
+{
+    {
+        std::scoped_lock lock(lock_);
+        terminating_ = true;
+    }
+
+    condition_.notify_all();
+
+    // Waiting for the completion of the thread.
+    wait();
+}
+
+void VideoDecodeThread::decodePacket(std::unique_ptr<proto::desktop::VideoPacket> packet)
+{
+    {
+        std::scoped_lock lock(lock_);
+        queue_.push_back({ std::move(packet), Clock::now() });
+    }
+
+    condition_.notify_all();
+}
+
+void VideoDecodeThread::framePresented()
+{
+    {
+        std::scoped_lock lock(lock_);
+        frame_presented_ = true;
+    }
+
+    condition_.notify_all();
+}
+
+void VideoDecodeThread::run()
+{
+    std::deque<PendingPacket> packets;
+
+    while (true)
+    {
+        {
+            std::unique_lock lock(lock_);
+
+            // The back frame can be overwritten only when the parent has stopped painting it.
+            condition_.wait(lock, [this]()
+            {
+                return terminating_ || (!queue_.empty() && frame_presented_);
+            });
+
+            if (terminating_)
+                return;
+
+            packets.swap(queue_);
+            frame_presented_ = false;
+        }
+
+        const Clock::time_point first_receive_time = packets.front().receive_time;
+
+        FrameInfo info;
+        bool is_decoded = decodePackets(&packets, &info);
+
+        // The packets received before the next refresh of the screen are decoded into the same
+        // frame.
+        while (is_decoded)
+        {
+            const Clock::time_point next_frame_time = last_frame_time_ + frame_interval_;
+            if (Clock::now() >= next_frame_time)
+                break;
+
+            {
+                std::unique_lock lock(lock_);
+
+                if (!condition_.wait_until(lock, next_frame_time, [this]()
+                {
+                    return terminating_ || !queue_.empty();
+                }))
+                {
+                    break;
+                }
+
+                if (terminating_)
+                    return;
+
+                packets.swap(queue_);
+            }
+
+            is_decoded = decodePackets(&packets, &info);
+        }
+
+        if (!is_decoded)
+        {
+            // The session is stopped after an error.
+            QCoreApplication::postEvent(parent(), new FrameEvent(nullptr, std::move(info)));
+            return;
+        }
+
+        last_frame_time_ = Clock::now();
+
+        info.screen_rect = screen_rect_;
+        info.changed_region = back_region_;
+        info.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            last_frame_time_ - first_receive_time);
+
+        // The previous frame does not have the changes of the decoded packets. They are copied
+        // before the next packets are decoded into it.
+        front_region_ = back_region_;
+        std::swap(front_frame_, back_frame_);
+        back_frame_updated_ = false;
+
+        QCoreApplication::postEvent(parent(), new FrameEvent(front_frame_, std::move(info)));
+    }
+}
+
+bool VideoDecodeThread::decodePackets(std::deque<PendingPacket>* packets, FrameInfo* info)
+{
+    for (const PendingPacket& pending : *packets)
+    {
+        const Clock::time_point begin_time = Clock::now();
+
+        if (!decode(*pending.packet))
+            return false;
+
+        info->decode_time +=
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin_time);
+        ++info->packet_count;
+    }
+
+    packets->clear();
+    return true;
+}
+
+bool VideoDecodeThread::decode(const proto::desktop::VideoPacket& packet)
+{
+    if (packet.has_format())
+    {
+        screen_rect_ = codec::VideoUtil::fromVideoRect(packet.format().screen_rect());
+
+        // The frames passed to the parent keep the previous size until they are replaced.
+        front_frame_ = desktop::FrameQImage::create(screen_rect_.size());
+        back_frame_ = desktop::FrameQImage::create(screen_rect_.size());
+
+        front_region_.clear();
+        back_region_.clear();
+        back_frame_updated_ = true;
+    }
+    else if (!back_frame_)
+    {
+        LOG(LS_WARNING) << "A packet with image information was not received";
+        return false;
+    }
+    else if (!back_frame_updated_)
+    {
+        // Bring the frame up to date with the frame passed to the parent last time.
+        for (desktop::Region::Iterator it(front_region_); !it.isAtEnd(); it.advance())
+            back_frame_->copyPixelsFrom(*front_frame_, it.rect().topLeft(), it.rect());
+
+        back_region_.clear();
+        back_frame_updated_ = true;
+    }
+
+    if (video_encoding_ != packet.encoding())
+    {
+        video_decoder_ = codec::VideoDecoder::create(packet.encoding(), thread_count_);
+        video_encoding_ = packet.encoding();
+    }
+
+    if (!video_decoder_)
+    {
+        LOG(LS_WARNING) << "Video decoder not initialized";
+        return false;
+    }
+
+    desktop::Frame* frame = back_frame_.get();
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
+
+    // The moved areas are copied before decoding, the packet data contains the rest of the update.
+    for (int i = 0; i < packet.copy_rect_size(); ++i)
+    {
+        const proto::desktop::CopyRect& copy_rect = packet.copy_rect(i);
+
+        desktop::Rect source_rect = codec::VideoUtil::fromVideoRect(copy_rect.source_rect());
+        desktop::Rect dest_rect = desktop::Rect::makeXYWH(
+            desktop::Point(copy_rect.dest_x(), copy_rect.dest_y()), source_rect.size());
+
+        if (!frame_rect.containsRect(source_rect) || !frame_rect.containsRect(dest_rect))
+        {
+            LOG(LS_WARNING) << "The moved area is outside the desktop frame";
+            return false;
+        }
+
+        frame->copyPixelsFrom(*frame, source_rect.topLeft(), dest_rect);
+    }
+
+    const bool has_cache_tiles = packet.tile_cache_size() || packet.cached_tile_size() ||
+                                 packet.stored_tile_size();
+
+    if (has_cache_tiles)
+    {
+        if (!tile_cache_decoder_)
+            tile_cache_decoder_ = std::make_unique<codec::TileCacheDecoder>();
+
+        if (!tile_cache_decoder_->readTiles(packet, frame))
+            return false;
+    }
+
+    if (!video_decoder_->decode(packet, frame))
+        return false;
+
+    if (has_cache_tiles && !tile_cache_decoder_->storeTiles(packet, *frame))
+        return false;
+
+    desktop::Region packet_region;
+    addPacketRegion(packet, &packet_region);
+    packet_region.intersectWith(frame_rect);
+
+    back_region_.addRegion(packet_region);
+    return true;
+}
+
+} // namespace client
@@ -0,0 +1,166 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__VIDEO_DECODE_THREAD_H
+#define CLIENT__VIDEO_DECODE_THREAD_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+#include "proto/desktop.pb.h"
+
+#include <QEvent>
+#include <QThread>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace codec {
+class TileCacheDecoder;
+class VideoDecoder;
+} // namespace codec
+
+namespace desktop {
+class FrameQImage;
+} // namespace desktop
+
+namespace client {
+
+// Decodes the video packets of a desktop session on its own thread. The decoded frames are passed
+// to the parent object with FrameEvent. Two frames are used in turn: while the parent paints one
+// of them, the next packets are decoded into the other one.
+//
+// If the packets arrive faster than the frames can be painted, all of them are decoded, but the
+// frame is passed to the parent only once for all the packets decoded while the parent painted
+// the previous frame. The frames are not passed more often than the screen is refreshed.
+class VideoDecodeThread : public QThread
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // |thread_count| is the number of threads of the VP8/VP9 decoders. If 0, it is chosen by the
+    // number of processors. |frame_interval| is the refresh interval of the screen.
+    VideoDecodeThread(int thread_count, std::chrono::microseconds frame_interval, QObject* parent);
+    ~VideoDecodeThread();
+
+    struct FrameInfo
+    {
+        // Position and size of the screen of the frame (from the last format of the packets).
+        desktop::Rect screen_rect;
+
+        // The areas of the frame changed since the previous event.
+        desktop::Region changed_region;
+
+        // Number of the packets decoded into the frame.
+        int packet_count = 0;
+
+        // Time spent in the decoders.
+        std::chrono::microseconds decode_time{ 0 };
+
+        // Time from the receipt of the first packet to the end of decoding.
+        std::chrono::microseconds latency{ 0 };
+    };
+
+    class FrameEvent : public QEvent
+    {
+    public:
+        static const int kType = QEvent::User + 1;
+
+        // |frame| is null if a packet could not be decoded.
+        FrameEvent(std::shared_ptr<desktop::FrameQImage> frame, FrameInfo&& info) noexcept
+            : QEvent(static_cast<QEvent::Type>(kType)),
+              frame_(std::move(frame)),
+              info_(std::move(info))
+        {
+            // Nothing
+        }
+
+        const std::shared_ptr<desktop::FrameQImage>& frame() const { return frame_; }
+        const FrameInfo& info() const { return info_; }
+
+    private:
+        std::shared_ptr<desktop::FrameQImage> frame_;
+        FrameInfo info_;
+        DISALLOW_COPY_AND_ASSIGN(FrameEvent);
+    };
+
+    // Adds the packet to the queue of the thread.
+    void decodePacket(std::unique_ptr<proto::desktop::VideoPacket> packet);
+
+    // Called when the parent has replaced the previous frame with the last decoded one and does
+    // not paint the previous frame anymore. The next packet is decoded into it.
+    void framePresented();
+
+protected:
+    // QThread implementation.
+    void run() override;
+
+private:
+    struct PendingPacket
+    {
+        std::unique_ptr<proto::desktop::VideoPacket> packet;
+        Clock::time_point receive_time;
+    };
+
+    // Decodes the packets of |packets| into |back_frame_|.
+    bool decodePackets(std::deque<PendingPacket>* packets, FrameInfo* info);
+    bool decode(const proto::desktop::VideoPacket& packet);
+
+    const int thread_count_;
+    const std::chrono::microseconds frame_interval_;
+
+    std::deque<PendingPacket> queue_;
+    bool frame_presented_ = true;
+    bool terminating_ = false;
+
+    std::condition_variable condition_;
+    std::mutex lock_;
+
+    // Used only on the decoding thread.
+    proto::desktop::VideoEncoding video_encoding_ = proto::desktop::VIDEO_ENCODING_UNKNOWN;
+    std::unique_ptr<codec::VideoDecoder> video_decoder_;
+    std::unique_ptr<codec::TileCacheDecoder> tile_cache_decoder_;
+
+    // Position and size of the screen from the last format of the packets.
+    desktop::Rect screen_rect_;
+
+    // The frame passed to the parent last time and the frame into which the next packet is
+    // decoded.
+    std::shared_ptr<desktop::FrameQImage> front_frame_;
+    std::shared_ptr<desktop::FrameQImage> back_frame_;
+
+    // The areas changed by the packets decoded into |front_frame_| last time. |back_frame_| does
+    // not have them yet.
+    desktop::Region front_region_;
+
+    // The areas changed by the packets decoded into |back_frame_|.
+    desktop::Region back_region_;
+
+    // True if the packets have been decoded into |back_frame_| after the last swap.
+    bool back_frame_updated_ = false;
+
+    Clock::time_point last_frame_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecodeThread);
+};
+
+} // namespace client
+
+#endif // CLIENT__VIDEO_DECODE_THREAD_H
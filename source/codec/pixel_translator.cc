@@ -19,6 +19,10 @@
 #include "codec/pixel_translator.h"
 #include "base/macros_magic.h"
 #include "build/build_config.h"
+#include "codec/pixel_translator_avx2.h"
+#include "codec/pixel_translator_sse2.h"
+
+#include <libyuv/cpu_id.h>
 
 namespace codec {
 
@@ -209,11 +213,107 @@ private:
     DISALLOW_COPY_AND_ASSIGN(PixelTranslatorFrom8_16bppT);
 };
 
+using TranslateFunc = void(*)(const uint8_t*, int, uint8_t*, int, int, int);
+
+class PixelTranslatorSIMD : public PixelTranslator
+{
+public:
+    explicit PixelTranslatorSIMD(TranslateFunc translate_func)
+        : translate_func_(translate_func)
+    {
+        // Nothing
+    }
+
+    ~PixelTranslatorSIMD() = default;
+
+    void translate(const uint8_t* src, int src_stride,
+                   uint8_t* dst, int dst_stride,
+                   int width, int height) override
+    {
+        translate_func_(src, src_stride, dst, dst_stride, width, height);
+    }
+
+private:
+    TranslateFunc translate_func_;
+
+    DISALLOW_COPY_AND_ASSIGN(PixelTranslatorSIMD);
+};
+
+TranslateFunc translateFuncAVX2(const desktop::PixelFormat& source_format,
+                                const desktop::PixelFormat& target_format)
+{
+    if (source_format == desktop::PixelFormat::ARGB())
+    {
+        if (target_format == desktop::PixelFormat::ARGB())
+            return translatePixels_ARGB_to_ARGB_AVX2;
+
+        if (target_format == desktop::PixelFormat::RGB565())
+            return translatePixels_ARGB_to_RGB565_AVX2;
+
+        if (target_format == desktop::PixelFormat::RGB332())
+            return translatePixels_ARGB_to_RGB332_AVX2;
+    }
+    else if (target_format == desktop::PixelFormat::ARGB())
+    {
+        if (source_format == desktop::PixelFormat::RGB565())
+            return translatePixels_RGB565_to_ARGB_AVX2;
+
+        if (source_format == desktop::PixelFormat::RGB332())
+            return translatePixels_RGB332_to_ARGB_AVX2;
+    }
+
+    return nullptr;
+}
+
+TranslateFunc translateFuncSSE2(const desktop::PixelFormat& source_format,
+                                const desktop::PixelFormat& target_format)
+{
+    if (source_format == desktop::PixelFormat::ARGB())
+    {
+        if (target_format == desktop::PixelFormat::ARGB())
+            return translatePixels_ARGB_to_ARGB_SSE2;
+
+        if (target_format == desktop::PixelFormat::RGB565())
+            return translatePixels_ARGB_to_RGB565_SSE2;
+
+        if (target_format == desktop::PixelFormat::RGB332())
+            return translatePixels_ARGB_to_RGB332_SSE2;
+    }
+    else if (target_format == desktop::PixelFormat::ARGB())
+    {
+        if (source_format == desktop::PixelFormat::RGB565())
+            return translatePixels_RGB565_to_ARGB_SSE2;
+
+        if (source_format == desktop::PixelFormat::RGB332())
+            return translatePixels_RGB332_to_ARGB_SSE2;
+    }
+
+    return nullptr;
+}
+
 } // namespace
 
 // static
 std::unique_ptr<PixelTranslator> PixelTranslator::create(
     const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format)
+{
+    TranslateFunc translate_func = nullptr;
+
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        translate_func = translateFuncAVX2(source_format, target_format);
+
+    if (!translate_func && libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        translate_func = translateFuncSSE2(source_format, target_format);
+
+    if (translate_func)
+        return std::make_unique<PixelTranslatorSIMD>(translate_func);
+
+    return createTableDriven(source_format, target_format);
+}
+
+// static
+std::unique_ptr<PixelTranslator> PixelTranslator::createTableDriven(
+    const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format)
 {
     switch (target_format.bytesPerPixel())
     {
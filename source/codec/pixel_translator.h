@@ -30,9 +30,15 @@ class PixelTranslator
 public:
     virtual ~PixelTranslator() = default;
 
+    // Creates a translator for the specified formats. If the processor supports it, SSE2 or AVX2
+    // kernels are used for the most common formats (ARGB, RGB565 and RGB332).
     static std::unique_ptr<PixelTranslator> create(const desktop::PixelFormat& source_format,
                                                    const desktop::PixelFormat& target_format);
 
+    // Creates a translator that uses only lookup tables. SIMD kernels give the same result.
+    static std::unique_ptr<PixelTranslator> createTableDriven(
+        const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format);
+
     virtual void translate(const uint8_t* src,
                            int src_stride,
                            uint8_t* dst,
@@ -0,0 +1,317 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator_avx2.h"
+#include "build/build_config.h"
+#include "codec/pixel_translator_sse2.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+// The kernels give the same result as the table-driven translator (see pixel_translator_sse2.cc).
+// The pixels at the right edge that do not fill a whole block are translated by SSE2 kernels.
+
+namespace codec {
+
+namespace {
+
+// Divides each 16-bit value by 255. Valid for values up to 65534.
+inline __m256i div255(__m256i value)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    return _mm256_srli_epi16(
+        _mm256_add_epi16(_mm256_add_epi16(value, one), _mm256_srli_epi16(value, 8)), 8);
+}
+
+// Reduces each 16-bit 8-bit component value to |max| with rounding.
+inline __m256i reduceComponent(__m256i value, int max)
+{
+    const __m256i half = _mm256_set1_epi16(127);
+    return div255(_mm256_add_epi16(_mm256_mullo_epi16(value, _mm256_set1_epi16(max)), half));
+}
+
+// Unpacks 16 ARGB pixels to 16-bit red, green and blue components. Inside each 128-bit lane the
+// order of the pixels is: 4 pixels from |pixels0|, 4 pixels from |pixels1|.
+inline void unpackARGB(__m256i pixels0, __m256i pixels1, __m256i* red, __m256i* green, __m256i* blue)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+
+    *blue = _mm256_packs_epi32(_mm256_and_si256(pixels0, mask), _mm256_and_si256(pixels1, mask));
+
+    *green = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(pixels0, 8), mask),
+                                _mm256_and_si256(_mm256_srli_epi32(pixels1, 8), mask));
+
+    *red = _mm256_packs_epi32(_mm256_and_si256(_mm256_srli_epi32(pixels0, 16), mask),
+                              _mm256_and_si256(_mm256_srli_epi32(pixels1, 16), mask));
+}
+
+// Packs 16-bit red, green and blue components (0-255) to 16 ARGB pixels.
+inline void packARGB(__m256i red, __m256i green, __m256i blue, __m256i* pixels0, __m256i* pixels1)
+{
+    const __m256i low = _mm256_or_si256(blue, _mm256_slli_epi16(green, 8));
+
+    const __m256i unpacked_low = _mm256_unpacklo_epi16(low, red);
+    const __m256i unpacked_high = _mm256_unpackhi_epi16(low, red);
+
+    // Restore the order of the pixels after unpacking inside the 128-bit lanes.
+    *pixels0 = _mm256_permute2x128_si256(unpacked_low, unpacked_high, 0x20);
+    *pixels1 = _mm256_permute2x128_si256(unpacked_low, unpacked_high, 0x31);
+}
+
+// Converts 16 RGB565 pixels to 16 ARGB pixels.
+inline void expandRGB565(__m256i pixels, __m256i* pixels0, __m256i* pixels1)
+{
+    const __m256i red = _mm256_srli_epi16(_mm256_mullo_epi16(
+        _mm256_srli_epi16(pixels, 11), _mm256_set1_epi16(1053)), 7);
+
+    const __m256i green = _mm256_mulhi_epu16(_mm256_slli_epi16(
+        _mm256_and_si256(pixels, _mm256_set1_epi16(0x07E0)), 1), _mm256_set1_epi16(4145));
+
+    const __m256i blue = _mm256_srli_epi16(_mm256_mullo_epi16(
+        _mm256_and_si256(pixels, _mm256_set1_epi16(0x1F)), _mm256_set1_epi16(1053)), 7);
+
+    packARGB(red, green, blue, pixels0, pixels1);
+}
+
+// Converts 16 RGB332 pixels (unpacked to 16-bit values) to 16 ARGB pixels.
+inline void expandRGB332(__m256i pixels, __m256i* pixels0, __m256i* pixels1)
+{
+    const __m256i mul = _mm256_set1_epi16(583);
+
+    const __m256i red = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(pixels, 5), mul), 4);
+
+    const __m256i green = _mm256_srli_epi16(_mm256_mullo_epi16(
+        _mm256_and_si256(_mm256_srli_epi16(pixels, 2), _mm256_set1_epi16(0x07)), mul), 4);
+
+    const __m256i blue = _mm256_mullo_epi16(
+        _mm256_and_si256(pixels, _mm256_set1_epi16(0x03)), _mm256_set1_epi16(85));
+
+    packARGB(red, green, blue, pixels0, pixels1);
+}
+
+} // namespace
+
+void translatePixels_ARGB_to_ARGB_AVX2(const uint8_t* src, int src_stride,
+                                       uint8_t* dst, int dst_stride,
+                                       int width, int height)
+{
+    const __m256i mask = _mm256_set1_epi32(0x00FFFFFF);
+    const int block_count = width / 8;
+
+    const uint8_t* src_row = src;
+    uint8_t* dst_row = dst;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m256i* src_ptr = reinterpret_cast<const __m256i*>(src_row);
+        __m256i* dst_ptr = reinterpret_cast<__m256i*>(dst_row);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            _mm256_storeu_si256(dst_ptr++,
+                                _mm256_and_si256(_mm256_loadu_si256(src_ptr++), mask));
+        }
+
+        src_row += src_stride;
+        dst_row += dst_stride;
+    }
+
+    const int processed_width = block_count * 8;
+    if (processed_width < width)
+    {
+        translatePixels_ARGB_to_ARGB_SSE2(src + processed_width * 4, src_stride,
+                                          dst + processed_width * 4, dst_stride,
+                                          width - processed_width, height);
+    }
+}
+
+void translatePixels_ARGB_to_RGB565_AVX2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const int block_count = width / 16;
+
+    const uint8_t* src_row = src;
+    uint8_t* dst_row = dst;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m256i* src_ptr = reinterpret_cast<const __m256i*>(src_row);
+        __m256i* dst_ptr = reinterpret_cast<__m256i*>(dst_row);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m256i red, green, blue;
+
+            unpackARGB(_mm256_loadu_si256(src_ptr), _mm256_loadu_si256(src_ptr + 1),
+                       &red, &green, &blue);
+            src_ptr += 2;
+
+            red = _mm256_slli_epi16(reduceComponent(red, 31), 11);
+            green = _mm256_slli_epi16(reduceComponent(green, 63), 5);
+            blue = reduceComponent(blue, 31);
+
+            const __m256i result = _mm256_or_si256(_mm256_or_si256(red, green), blue);
+
+            // Restore the order of the pixels after packing inside the 128-bit lanes.
+            _mm256_storeu_si256(dst_ptr++, _mm256_permute4x64_epi64(result, 0xD8));
+        }
+
+        src_row += src_stride;
+        dst_row += dst_stride;
+    }
+
+    const int processed_width = block_count * 16;
+    if (processed_width < width)
+    {
+        translatePixels_ARGB_to_RGB565_SSE2(src + processed_width * 4, src_stride,
+                                            dst + processed_width * 2, dst_stride,
+                                            width - processed_width, height);
+    }
+}
+
+void translatePixels_ARGB_to_RGB332_AVX2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const int block_count = width / 32;
+
+    const uint8_t* src_row = src;
+    uint8_t* dst_row = dst;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m256i* src_ptr = reinterpret_cast<const __m256i*>(src_row);
+        __m256i* dst_ptr = reinterpret_cast<__m256i*>(dst_row);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m256i result[2];
+
+            for (int i = 0; i < 2; ++i)
+            {
+                __m256i red, green, blue;
+
+                unpackARGB(_mm256_loadu_si256(src_ptr), _mm256_loadu_si256(src_ptr + 1),
+                           &red, &green, &blue);
+                src_ptr += 2;
+
+                red = _mm256_slli_epi16(reduceComponent(red, 7), 5);
+                green = _mm256_slli_epi16(reduceComponent(green, 7), 2);
+                blue = reduceComponent(blue, 3);
+
+                result[i] = _mm256_or_si256(_mm256_or_si256(red, green), blue);
+            }
+
+            // Restore the order of the pixels after packing inside the 128-bit lanes.
+            _mm256_storeu_si256(dst_ptr++, _mm256_permutevar8x32_epi32(
+                _mm256_packus_epi16(result[0], result[1]), order));
+        }
+
+        src_row += src_stride;
+        dst_row += dst_stride;
+    }
+
+    const int processed_width = block_count * 32;
+    if (processed_width < width)
+    {
+        translatePixels_ARGB_to_RGB332_SSE2(src + processed_width * 4, src_stride,
+                                            dst + processed_width, dst_stride,
+                                            width - processed_width, height);
+    }
+}
+
+void translatePixels_RGB565_to_ARGB_AVX2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const int block_count = width / 16;
+
+    const uint8_t* src_row = src;
+    uint8_t* dst_row = dst;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m256i* src_ptr = reinterpret_cast<const __m256i*>(src_row);
+        __m256i* dst_ptr = reinterpret_cast<__m256i*>(dst_row);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m256i pixels0, pixels1;
+
+            expandRGB565(_mm256_loadu_si256(src_ptr++), &pixels0, &pixels1);
+
+            _mm256_storeu_si256(dst_ptr++, pixels0);
+            _mm256_storeu_si256(dst_ptr++, pixels1);
+        }
+
+        src_row += src_stride;
+        dst_row += dst_stride;
+    }
+
+    const int processed_width = block_count * 16;
+    if (processed_width < width)
+    {
+        translatePixels_RGB565_to_ARGB_SSE2(src + processed_width * 2, src_stride,
+                                            dst + processed_width * 4, dst_stride,
+                                            width - processed_width, height);
+    }
+}
+
+void translatePixels_RGB332_to_ARGB_AVX2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const int block_count = width / 16;
+
+    const uint8_t* src_row = src;
+    uint8_t* dst_row = dst;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src_row);
+        __m256i* dst_ptr = reinterpret_cast<__m256i*>(dst_row);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m256i pixels0, pixels1;
+
+            expandRGB332(_mm256_cvtepu8_epi16(_mm_loadu_si128(src_ptr++)), &pixels0, &pixels1);
+
+            _mm256_storeu_si256(dst_ptr++, pixels0);
+            _mm256_storeu_si256(dst_ptr++, pixels1);
+        }
+
+        src_row += src_stride;
+        dst_row += dst_stride;
+    }
+
+    const int processed_width = block_count * 16;
+    if (processed_width < width)
+    {
+        translatePixels_RGB332_to_ARGB_SSE2(src + processed_width, src_stride,
+                                            dst + processed_width * 4, dst_stride,
+                                            width - processed_width, height);
+    }
+}
+
+} // namespace codec
@@ -0,0 +1,325 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator_sse2.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <mmintrin.h>
+#include <emmintrin.h>
+#endif
+
+// The kernels give the same result as the table-driven translator:
+// * When the number of bits of a component is reduced, the value is rounded:
+//   (value * target_max + 127) / 255.
+// * When the number of bits of a component is increased, the value is truncated:
+//   value * 255 / source_max.
+// The alpha channel is always cleared.
+
+namespace codec {
+
+namespace {
+
+// Divides each 16-bit value by 255. Valid for values up to 65534.
+inline __m128i div255(__m128i value)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(value, one), _mm_srli_epi16(value, 8)), 8);
+}
+
+// Reduces each 16-bit 8-bit component value to |max| with rounding.
+inline __m128i reduceComponent(__m128i value, int max)
+{
+    const __m128i half = _mm_set1_epi16(127);
+    return div255(_mm_add_epi16(_mm_mullo_epi16(value, _mm_set1_epi16(max)), half));
+}
+
+// Unpacks 8 ARGB pixels to 16-bit red, green and blue components.
+inline void unpackARGB(__m128i pixels0, __m128i pixels1, __m128i* red, __m128i* green, __m128i* blue)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+
+    *blue = _mm_packs_epi32(_mm_and_si128(pixels0, mask), _mm_and_si128(pixels1, mask));
+
+    *green = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(pixels0, 8), mask),
+                             _mm_and_si128(_mm_srli_epi32(pixels1, 8), mask));
+
+    *red = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(pixels0, 16), mask),
+                           _mm_and_si128(_mm_srli_epi32(pixels1, 16), mask));
+}
+
+// Packs 16-bit red, green and blue components (0-255) to 8 ARGB pixels.
+inline void packARGB(__m128i red, __m128i green, __m128i blue, __m128i* pixels0, __m128i* pixels1)
+{
+    const __m128i low = _mm_or_si128(blue, _mm_slli_epi16(green, 8));
+
+    *pixels0 = _mm_unpacklo_epi16(low, red);
+    *pixels1 = _mm_unpackhi_epi16(low, red);
+}
+
+// Converts 8 RGB565 pixels to 16 bytes of ARGB pixels.
+inline void expandRGB565(__m128i pixels, __m128i* pixels0, __m128i* pixels1)
+{
+    // red * 255 / 31 == (red * 1053) >> 7
+    // green * 255 / 63 == (green * 4145) >> 10
+    // blue * 255 / 31 == (blue * 1053) >> 7
+    const __m128i red = _mm_srli_epi16(_mm_mullo_epi16(
+        _mm_srli_epi16(pixels, 11), _mm_set1_epi16(1053)), 7);
+
+    const __m128i green = _mm_mulhi_epu16(
+        _mm_slli_epi16(_mm_and_si128(pixels, _mm_set1_epi16(0x07E0)), 1), _mm_set1_epi16(4145));
+
+    const __m128i blue = _mm_srli_epi16(_mm_mullo_epi16(
+        _mm_and_si128(pixels, _mm_set1_epi16(0x1F)), _mm_set1_epi16(1053)), 7);
+
+    packARGB(red, green, blue, pixels0, pixels1);
+}
+
+// Converts 8 RGB332 pixels (unpacked to 16-bit values) to ARGB pixels.
+inline void expandRGB332(__m128i pixels, __m128i* pixels0, __m128i* pixels1)
+{
+    // red * 255 / 7 == (red * 583) >> 4
+    // green * 255 / 7 == (green * 583) >> 4
+    // blue * 255 / 3 == blue * 85
+    const __m128i mul = _mm_set1_epi16(583);
+
+    const __m128i red = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(pixels, 5), mul), 4);
+
+    const __m128i green = _mm_srli_epi16(_mm_mullo_epi16(
+        _mm_and_si128(_mm_srli_epi16(pixels, 2), _mm_set1_epi16(0x07)), mul), 4);
+
+    const __m128i blue = _mm_mullo_epi16(
+        _mm_and_si128(pixels, _mm_set1_epi16(0x03)), _mm_set1_epi16(85));
+
+    packARGB(red, green, blue, pixels0, pixels1);
+}
+
+inline uint32_t reduce(uint32_t value, uint32_t max)
+{
+    return (value * max + 127) / 255;
+}
+
+inline uint16_t pixelToRGB565(uint32_t pixel)
+{
+    return static_cast<uint16_t>((reduce((pixel >> 16) & 0xFF, 31) << 11) |
+                                 (reduce((pixel >> 8) & 0xFF, 63) << 5) |
+                                 reduce(pixel & 0xFF, 31));
+}
+
+inline uint8_t pixelToRGB332(uint32_t pixel)
+{
+    return static_cast<uint8_t>((reduce((pixel >> 16) & 0xFF, 7) << 5) |
+                                (reduce((pixel >> 8) & 0xFF, 7) << 2) |
+                                reduce(pixel & 0xFF, 3));
+}
+
+inline uint32_t pixelFromRGB565(uint16_t pixel)
+{
+    return (((pixel >> 11) & 0x1F) * 255 / 31) << 16 |
+           (((pixel >> 5) & 0x3F) * 255 / 63) << 8 |
+           ((pixel & 0x1F) * 255 / 31);
+}
+
+inline uint32_t pixelFromRGB332(uint8_t pixel)
+{
+    return (((pixel >> 5) & 0x07) * 255 / 7) << 16 |
+           (((pixel >> 2) & 0x07) * 255 / 7) << 8 |
+           ((pixel & 0x03) * 255 / 3);
+}
+
+} // namespace
+
+void translatePixels_ARGB_to_ARGB_SSE2(const uint8_t* src, int src_stride,
+                                       uint8_t* dst, int dst_stride,
+                                       int width, int height)
+{
+    const __m128i mask = _mm_set1_epi32(0x00FFFFFF);
+    const int block_count = width / 4;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src);
+        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst);
+
+        for (int x = 0; x < block_count; ++x)
+            _mm_storeu_si128(dst_ptr++, _mm_and_si128(_mm_loadu_si128(src_ptr++), mask));
+
+        const uint32_t* src_pixel = reinterpret_cast<const uint32_t*>(src_ptr);
+        uint32_t* dst_pixel = reinterpret_cast<uint32_t*>(dst_ptr);
+
+        for (int x = block_count * 4; x < width; ++x)
+            *dst_pixel++ = *src_pixel++ & 0x00FFFFFF;
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void translatePixels_ARGB_to_RGB565_SSE2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const int block_count = width / 8;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src);
+        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m128i red, green, blue;
+
+            unpackARGB(_mm_loadu_si128(src_ptr), _mm_loadu_si128(src_ptr + 1),
+                       &red, &green, &blue);
+            src_ptr += 2;
+
+            red = _mm_slli_epi16(reduceComponent(red, 31), 11);
+            green = _mm_slli_epi16(reduceComponent(green, 63), 5);
+            blue = reduceComponent(blue, 31);
+
+            _mm_storeu_si128(dst_ptr++, _mm_or_si128(_mm_or_si128(red, green), blue));
+        }
+
+        const uint32_t* src_pixel = reinterpret_cast<const uint32_t*>(src_ptr);
+        uint16_t* dst_pixel = reinterpret_cast<uint16_t*>(dst_ptr);
+
+        for (int x = block_count * 8; x < width; ++x)
+            *dst_pixel++ = pixelToRGB565(*src_pixel++);
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void translatePixels_ARGB_to_RGB332_SSE2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const int block_count = width / 16;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src);
+        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m128i result[2];
+
+            for (int i = 0; i < 2; ++i)
+            {
+                __m128i red, green, blue;
+
+                unpackARGB(_mm_loadu_si128(src_ptr), _mm_loadu_si128(src_ptr + 1),
+                           &red, &green, &blue);
+                src_ptr += 2;
+
+                red = _mm_slli_epi16(reduceComponent(red, 7), 5);
+                green = _mm_slli_epi16(reduceComponent(green, 7), 2);
+                blue = reduceComponent(blue, 3);
+
+                result[i] = _mm_or_si128(_mm_or_si128(red, green), blue);
+            }
+
+            _mm_storeu_si128(dst_ptr++, _mm_packus_epi16(result[0], result[1]));
+        }
+
+        const uint32_t* src_pixel = reinterpret_cast<const uint32_t*>(src_ptr);
+        uint8_t* dst_pixel = reinterpret_cast<uint8_t*>(dst_ptr);
+
+        for (int x = block_count * 16; x < width; ++x)
+            *dst_pixel++ = pixelToRGB332(*src_pixel++);
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void translatePixels_RGB565_to_ARGB_SSE2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const int block_count = width / 8;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src);
+        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            __m128i pixels0, pixels1;
+
+            expandRGB565(_mm_loadu_si128(src_ptr++), &pixels0, &pixels1);
+
+            _mm_storeu_si128(dst_ptr++, pixels0);
+            _mm_storeu_si128(dst_ptr++, pixels1);
+        }
+
+        const uint16_t* src_pixel = reinterpret_cast<const uint16_t*>(src_ptr);
+        uint32_t* dst_pixel = reinterpret_cast<uint32_t*>(dst_ptr);
+
+        for (int x = block_count * 8; x < width; ++x)
+            *dst_pixel++ = pixelFromRGB565(*src_pixel++);
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+void translatePixels_RGB332_to_ARGB_SSE2(const uint8_t* src, int src_stride,
+                                         uint8_t* dst, int dst_stride,
+                                         int width, int height)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const int block_count = width / 16;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src);
+        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const __m128i pixels = _mm_loadu_si128(src_ptr++);
+            __m128i pixels0, pixels1;
+
+            expandRGB332(_mm_unpacklo_epi8(pixels, zero), &pixels0, &pixels1);
+            _mm_storeu_si128(dst_ptr++, pixels0);
+            _mm_storeu_si128(dst_ptr++, pixels1);
+
+            expandRGB332(_mm_unpackhi_epi8(pixels, zero), &pixels0, &pixels1);
+            _mm_storeu_si128(dst_ptr++, pixels0);
+            _mm_storeu_si128(dst_ptr++, pixels1);
+        }
+
+        const uint8_t* src_pixel = reinterpret_cast<const uint8_t*>(src_ptr);
+        uint32_t* dst_pixel = reinterpret_cast<uint32_t*>(dst_ptr);
+
+        for (int x = block_count * 16; x < width; ++x)
+            *dst_pixel++ = pixelFromRGB332(*src_pixel++);
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+} // namespace codec
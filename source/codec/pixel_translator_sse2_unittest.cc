@@ -0,0 +1,116 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator.h"
+#include "codec/pixel_translator_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <random>
+#include <vector>
+
+namespace codec {
+
+namespace {
+
+using TranslateFunc = void(*)(const uint8_t*, int, uint8_t*, int, int, int);
+
+const int kHeight = 7;
+const int kStridePadding = 13;
+
+// Widths cover the full blocks of the kernels and all possible partial blocks.
+const int kWidths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 1366 };
+
+void checkTranslation(const desktop::PixelFormat& source_format,
+                      const desktop::PixelFormat& target_format,
+                      TranslateFunc translate_func)
+{
+    std::unique_ptr<PixelTranslator> translator =
+        PixelTranslator::createTableDriven(source_format, target_format);
+    ASSERT_TRUE(translator);
+
+    std::mt19937 random(source_format.bitsPerPixel() * 256 + target_format.bitsPerPixel());
+
+    for (int width : kWidths)
+    {
+        const int src_stride = width * source_format.bytesPerPixel() + kStridePadding;
+        const int dst_stride = width * target_format.bytesPerPixel() + kStridePadding;
+
+        std::vector<uint8_t> src(src_stride * kHeight);
+        for (auto& value : src)
+            value = static_cast<uint8_t>(random());
+
+        std::vector<uint8_t> expected(dst_stride * kHeight, 0xAA);
+        std::vector<uint8_t> actual(dst_stride * kHeight, 0xAA);
+
+        translator->translate(src.data(), src_stride, expected.data(), dst_stride, width, kHeight);
+        translate_func(src.data(), src_stride, actual.data(), dst_stride, width, kHeight);
+
+        EXPECT_EQ(expected, actual) << "width: " << width;
+    }
+}
+
+} // namespace
+
+TEST(pixel_translator_sse2, argb_to_argb)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    checkTranslation(desktop::PixelFormat::ARGB(), desktop::PixelFormat::ARGB(),
+                     translatePixels_ARGB_to_ARGB_SSE2);
+}
+
+TEST(pixel_translator_sse2, argb_to_rgb565)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    checkTranslation(desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB565(),
+                     translatePixels_ARGB_to_RGB565_SSE2);
+}
+
+TEST(pixel_translator_sse2, argb_to_rgb332)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    checkTranslation(desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB332(),
+                     translatePixels_ARGB_to_RGB332_SSE2);
+}
+
+TEST(pixel_translator_sse2, rgb565_to_argb)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    checkTranslation(desktop::PixelFormat::RGB565(), desktop::PixelFormat::ARGB(),
+                     translatePixels_RGB565_to_ARGB_SSE2);
+}
+
+TEST(pixel_translator_sse2, rgb332_to_argb)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    checkTranslation(desktop::PixelFormat::RGB332(), desktop::PixelFormat::ARGB(),
+                     translatePixels_RGB332_to_ARGB_SSE2);
+}
+
+} // namespace codec
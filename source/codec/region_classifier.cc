@@ -0,0 +1,215 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/region_classifier.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+
+#include <algorithm>
+#include <array>
+
+namespace codec {
+
+namespace {
+
+// Width and height of a block.
+const int kBlockSize = 64;
+
+// The number of recent frames which are taken into account.
+const uint32_t kHistoryMask = 0xFFFF;
+
+// A block is changed often if it was changed in at least this number of the recent frames.
+const int kMinChangeCount = 4;
+
+// Step between the sampled pixels in both directions.
+const int kSampleStep = 4;
+
+// A block is colorful if its sample has at least this number of different colors. The sample of a
+// full block has 256 pixels.
+const int kMinColorCount = 48;
+
+// Size of the hash table of the sampled colors. Must be a power of two larger than the sample.
+const int kColorTableSize = 512;
+const uint32_t kEmptyColor = 0xFFFFFFFF;
+
+int bitCount(uint32_t value)
+{
+    int count = 0;
+
+    while (value)
+    {
+        value &= value - 1;
+        ++count;
+    }
+
+    return count;
+}
+
+} // namespace
+
+void RegionClassifier::classify(const desktop::Frame* frame,
+                                desktop::Region* lossy_region,
+                                desktop::Region* lossless_region)
+{
+    DCHECK(lossy_region);
+    DCHECK(lossless_region);
+
+    if (frame->size() != size_)
+        reset(frame->size());
+
+    const desktop::Region& updated_region = frame->constUpdatedRegion();
+
+    for (auto& history : history_)
+        history = (history << 1) & kHistoryMask;
+
+    for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        for (int row = rect.top() / kBlockSize; row <= (rect.bottom() - 1) / kBlockSize; ++row)
+        {
+            for (int column = rect.left() / kBlockSize;
+                 column <= (rect.right() - 1) / kBlockSize; ++column)
+            {
+                history_[row * columns_ + column] |= 1;
+            }
+        }
+    }
+
+    // The region of the lossy blocks. The adjacent blocks of a row are merged.
+    desktop::Region lossy_blocks;
+
+    for (int row = 0; row < rows_; ++row)
+    {
+        int run_start = -1;
+
+        for (int column = 0; column <= columns_; ++column)
+        {
+            bool lossy = false;
+
+            if (column < columns_)
+            {
+                const int index = row * columns_ + column;
+                const uint32_t history = history_[index];
+
+                // The blocks which are not changed keep the previous decision. The colors are
+                // counted only for the blocks which are changed often.
+                if (history & 1)
+                {
+                    if (bitCount(history) >= kMinChangeCount)
+                    {
+                        const desktop::Rect block_rect = desktop::Rect::makeXYWH(
+                            column * kBlockSize, row * kBlockSize, kBlockSize, kBlockSize);
+
+                        lossy_[index] = countColors(
+                            frame,
+                            desktop::Rect::makeLTRB(block_rect.left(),
+                                                    block_rect.top(),
+                                                    std::min(block_rect.right(), size_.width()),
+                                                    std::min(block_rect.bottom(), size_.height())),
+                            kMinColorCount) >= kMinColorCount;
+                    }
+                    else
+                    {
+                        lossy_[index] = false;
+                    }
+                }
+
+                lossy = lossy_[index] && (history & 1);
+            }
+
+            if (lossy && run_start == -1)
+            {
+                run_start = column;
+            }
+            else if (!lossy && run_start != -1)
+            {
+                lossy_blocks.addRect(desktop::Rect::makeLTRB(
+                    run_start * kBlockSize, row * kBlockSize,
+                    column * kBlockSize, (row + 1) * kBlockSize));
+                run_start = -1;
+            }
+        }
+    }
+
+    lossy_region->intersect(updated_region, lossy_blocks);
+
+    *lossless_region = updated_region;
+    lossless_region->subtract(*lossy_region);
+}
+
+// static
+int RegionClassifier::countColors(const desktop::Frame* frame,
+                                  const desktop::Rect& rect,
+                                  int max_count)
+{
+    // The table must keep free slots.
+    max_count = std::min(max_count, kColorTableSize / 2);
+
+    std::array<uint32_t, kColorTableSize> table;
+    table.fill(kEmptyColor);
+
+    const int bytes_per_pixel = frame->format().bytesPerPixel();
+    int count = 0;
+
+    for (int y = rect.top(); y < rect.bottom(); y += kSampleStep)
+    {
+        const uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width(); x += kSampleStep)
+        {
+            const uint8_t* pixel = row + x * bytes_per_pixel;
+            uint32_t color = 0;
+
+            // The alpha channel of the screen is not used.
+            if (bytes_per_pixel == 4)
+                color = *reinterpret_cast<const uint32_t*>(pixel) & 0x00FFFFFF;
+            else if (bytes_per_pixel == 2)
+                color = *reinterpret_cast<const uint16_t*>(pixel);
+            else
+                color = *pixel;
+
+            uint32_t slot = (color * 2654435761U) >> 23;
+
+            while (table[slot] != kEmptyColor && table[slot] != color)
+                slot = (slot + 1) & (kColorTableSize - 1);
+
+            if (table[slot] == kEmptyColor)
+            {
+                table[slot] = color;
+
+                if (++count >= max_count)
+                    return count;
+            }
+        }
+    }
+
+    return count;
+}
+
+void RegionClassifier::reset(const desktop::Size& size)
+{
+    size_ = size;
+    columns_ = (size.width() + kBlockSize - 1) / kBlockSize;
+    rows_ = (size.height() + kBlockSize - 1) / kBlockSize;
+
+    history_.assign(columns_ * rows_, 0);
+    lossy_.assign(columns_ * rows_, false);
+}
+
+} // namespace codec
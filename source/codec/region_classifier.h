@@ -0,0 +1,72 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__REGION_CLASSIFIER_H
+#define CODEC__REGION_CLASSIFIER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <vector>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// Splits the updated region of the frames into the areas which suit lossy video coding and the
+// other areas. The screen is divided into blocks. A block is lossy if it was changed in many of
+// the recent frames and a sample of its pixels has many different colors (a video or an
+// animation). Text and user interface have few colors and are better compressed losslessly.
+class RegionClassifier
+{
+public:
+    RegionClassifier() = default;
+    ~RegionClassifier() = default;
+
+    // Classifies the updated region of |frame|. The frames must be passed in the order in which
+    // they are captured.
+    void classify(const desktop::Frame* frame,
+                  desktop::Region* lossy_region,
+                  desktop::Region* lossless_region);
+
+    // Returns the number of different colors in |rect| of |frame| sampled with a fixed step. The
+    // counting stops at |max_count|.
+    static int countColors(const desktop::Frame* frame, const desktop::Rect& rect, int max_count);
+
+private:
+    void reset(const desktop::Size& size);
+
+    desktop::Size size_;
+    int columns_ = 0;
+    int rows_ = 0;
+
+    // For each block, a bit for each of the recent frames. The lowest bit is set if the block is
+    // changed in the last frame.
+    std::vector<uint32_t> history_;
+
+    // For each block, true if the block is lossy.
+    std::vector<uint8_t> lossy_;
+
+    DISALLOW_COPY_AND_ASSIGN(RegionClassifier);
+};
+
+} // namespace codec
+
+#endif // CODEC__REGION_CLASSIFIER_H
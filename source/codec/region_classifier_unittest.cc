@@ -0,0 +1,163 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/region_classifier.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace codec {
+
+namespace {
+
+const desktop::Size kScreenSize(320, 240);
+
+// The area where the tests draw. It covers several blocks of the classifier.
+const desktop::Rect kUpdateRect = desktop::Rect::makeXYWH(64, 64, 128, 128);
+
+std::unique_ptr<desktop::FrameSimple> createFrame()
+{
+    std::unique_ptr<desktop::FrameSimple> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    memset(frame->frameData(), 0xFF, frame->stride() * frame->size().height());
+    return frame;
+}
+
+// Fills |rect| with random colors, like a video.
+void drawNoise(desktop::Frame* frame, const desktop::Rect& rect, std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = (*random)();
+    }
+
+    frame->updatedRegion()->setRect(rect);
+}
+
+// Fills |rect| with stripes of two colors, like text.
+void drawText(desktop::Frame* frame, const desktop::Rect& rect, int phase)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = ((x + y + phase) % 3) ? 0xFFFFFFFF : 0xFF000000;
+    }
+
+    frame->updatedRegion()->setRect(rect);
+}
+
+} // namespace
+
+TEST(region_classifier_test, video_is_lossy)
+{
+    std::unique_ptr<desktop::FrameSimple> frame = createFrame();
+    std::mt19937 random(1);
+    RegionClassifier classifier;
+
+    desktop::Region lossy_region;
+    desktop::Region lossless_region;
+
+    // The first changes are lossless until the area changes often enough.
+    drawNoise(frame.get(), kUpdateRect, &random);
+    classifier.classify(frame.get(), &lossy_region, &lossless_region);
+
+    EXPECT_TRUE(lossy_region.isEmpty());
+    EXPECT_TRUE(lossless_region.equals(desktop::Region(kUpdateRect)));
+
+    for (int i = 0; i < 10; ++i)
+    {
+        drawNoise(frame.get(), kUpdateRect, &random);
+        classifier.classify(frame.get(), &lossy_region, &lossless_region);
+    }
+
+    EXPECT_TRUE(lossy_region.equals(desktop::Region(kUpdateRect)));
+    EXPECT_TRUE(lossless_region.isEmpty());
+}
+
+TEST(region_classifier_test, text_is_lossless)
+{
+    std::unique_ptr<desktop::FrameSimple> frame = createFrame();
+    RegionClassifier classifier;
+
+    desktop::Region lossy_region;
+    desktop::Region lossless_region;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        drawText(frame.get(), kUpdateRect, i);
+        classifier.classify(frame.get(), &lossy_region, &lossless_region);
+
+        EXPECT_TRUE(lossy_region.isEmpty());
+        EXPECT_TRUE(lossless_region.equals(desktop::Region(kUpdateRect)));
+    }
+}
+
+TEST(region_classifier_test, mixed_update)
+{
+    std::unique_ptr<desktop::FrameSimple> frame = createFrame();
+    std::mt19937 random(2);
+    RegionClassifier classifier;
+
+    desktop::Region lossy_region;
+    desktop::Region lossless_region;
+
+    const desktop::Rect text_rect = desktop::Rect::makeXYWH(0, 0, 320, 20);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        drawNoise(frame.get(), kUpdateRect, &random);
+        classifier.classify(frame.get(), &lossy_region, &lossless_region);
+    }
+
+    // The text changes once together with the video.
+    drawNoise(frame.get(), kUpdateRect, &random);
+    drawText(frame.get(), text_rect, 0);
+    frame->updatedRegion()->addRect(kUpdateRect);
+
+    classifier.classify(frame.get(), &lossy_region, &lossless_region);
+
+    EXPECT_TRUE(lossy_region.equals(desktop::Region(kUpdateRect)));
+    EXPECT_TRUE(lossless_region.equals(desktop::Region(text_rect)));
+}
+
+TEST(region_classifier_test, count_colors)
+{
+    std::unique_ptr<desktop::FrameSimple> frame = createFrame();
+    std::mt19937 random(3);
+
+    const desktop::Rect rect = desktop::Rect::makeWH(64, 64);
+
+    EXPECT_EQ(RegionClassifier::countColors(frame.get(), rect, 100), 1);
+
+    drawText(frame.get(), rect, 0);
+    EXPECT_EQ(RegionClassifier::countColors(frame.get(), rect, 100), 2);
+
+    drawNoise(frame.get(), rect, &random);
+    EXPECT_EQ(RegionClassifier::countColors(frame.get(), rect, 100), 100);
+    EXPECT_EQ(RegionClassifier::countColors(frame.get(), rect, 1000), 256);
+}
+
+} // namespace codec
@@ -0,0 +1,184 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/scale_reducer.h"
+#include "common/desktop_session_constants.h"
+#include "desktop/desktop_frame_aligned.h"
+
+#include <libyuv/scale_argb.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+// The box filter averages all the source pixels of the target pixel. It is better for the large
+// reductions, the bilinear filter is faster for the small ones.
+const int kMaxBilinearScaleFactor = 50;
+
+int scaleValue(int value, int scale_factor)
+{
+    return static_cast<int>(
+        static_cast<int64_t>(value) * scale_factor / static_cast<int>(common::kMaxScaleFactor));
+}
+
+// Scales |rect| of |target_frame| with the nearest pixels of |source_frame|. libyuv scales only
+// 32-bit pixels, the packed pixels of the other formats can not be filtered.
+void scaleRectPoint(const desktop::Frame& source_frame,
+                    desktop::Frame* target_frame,
+                    const desktop::Rect& rect)
+{
+    const int bytes_per_pixel = source_frame.format().bytesPerPixel();
+    const int64_t source_width = source_frame.size().width();
+    const int64_t source_height = source_frame.size().height();
+    const int64_t target_width = target_frame->size().width();
+    const int64_t target_height = target_frame->size().height();
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const uint8_t* source_row =
+            source_frame.frameDataAtPos(0, static_cast<int>(y * source_height / target_height));
+        uint8_t* target = target_frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = rect.left(); x < rect.right(); ++x)
+        {
+            const int64_t source_x = x * source_width / target_width;
+
+            memcpy(target, source_row + source_x * bytes_per_pixel, bytes_per_pixel);
+            target += bytes_per_pixel;
+        }
+    }
+}
+
+} // namespace
+
+ScaleReducer::ScaleReducer(int scale_factor)
+    : scale_factor_(scale_factor)
+{
+    // Nothing
+}
+
+ScaleReducer::~ScaleReducer() = default;
+
+// static
+std::unique_ptr<ScaleReducer> ScaleReducer::create(int scale_factor)
+{
+    if (scale_factor < static_cast<int>(common::kMinScaleFactor) ||
+        scale_factor >= static_cast<int>(common::kMaxScaleFactor))
+        return nullptr;
+
+    return std::unique_ptr<ScaleReducer>(new ScaleReducer(scale_factor));
+}
+
+desktop::Frame* ScaleReducer::scaleFrame(const desktop::Frame* source_frame)
+{
+    desktop::Region* updated_region;
+
+    if (!target_frame_ ||
+        source_size_ != source_frame->size() ||
+        !target_frame_->format().isEqual(source_frame->format()))
+    {
+        source_size_ = source_frame->size();
+
+        const desktop::Size target_size(
+            std::max(scaleValue(source_size_.width(), scale_factor_), 1),
+            std::max(scaleValue(source_size_.height(), scale_factor_), 1));
+
+        target_frame_ = desktop::FrameAligned::create(target_size, source_frame->format(), 32);
+
+        // The new frame is scaled completely.
+        updated_region = target_frame_->updatedRegion();
+        updated_region->addRect(desktop::Rect::makeSize(target_size));
+    }
+    else
+    {
+        updated_region = target_frame_->updatedRegion();
+        updated_region->clear();
+
+        for (desktop::Region::Iterator it(source_frame->constUpdatedRegion());
+             !it.isAtEnd(); it.advance())
+        {
+            updated_region->addRect(scaledRect(it.rect()));
+        }
+
+        updated_region->intersectWith(desktop::Rect::makeSize(target_frame_->size()));
+    }
+
+    const desktop::Point& top_left = source_frame->topLeft();
+
+    target_frame_->setTopLeft(desktop::Point(scaleValue(top_left.x(), scale_factor_),
+                                             scaleValue(top_left.y(), scale_factor_)));
+
+    if (source_frame->format().bytesPerPixel() != 4)
+    {
+        for (desktop::Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+            scaleRectPoint(*source_frame, target_frame_.get(), it.rect());
+
+        return target_frame_.get();
+    }
+
+    const libyuv::FilterMode filter_mode = (scale_factor_ > kMaxBilinearScaleFactor) ?
+        libyuv::kFilterBilinear : libyuv::kFilterBox;
+
+    const desktop::Size& target_size = target_frame_->size();
+
+    // The whole frame is scaled with the clip rectangle, so the scaled areas are the same as if
+    // the frame was scaled completely.
+    for (desktop::Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        libyuv::ARGBScaleClip(source_frame->frameData(),
+                              source_frame->stride(),
+                              source_size_.width(),
+                              source_size_.height(),
+                              target_frame_->frameData(),
+                              target_frame_->stride(),
+                              target_size.width(),
+                              target_size.height(),
+                              rect.x(),
+                              rect.y(),
+                              rect.width(),
+                              rect.height(),
+                              filter_mode);
+    }
+
+    return target_frame_.get();
+}
+
+desktop::Rect ScaleReducer::scaledRect(const desktop::Rect& source_rect) const
+{
+    const int64_t source_width = source_size_.width();
+    const int64_t source_height = source_size_.height();
+    const int64_t target_width = target_frame_->size().width();
+    const int64_t target_height = target_frame_->size().height();
+
+    // The filters take the neighboring source pixels into account, so the rectangle is expanded
+    // by one pixel.
+    return desktop::Rect::makeLTRB(
+        static_cast<int>(source_rect.left() * target_width / source_width) - 1,
+        static_cast<int>(source_rect.top() * target_height / source_height) - 1,
+        static_cast<int>((source_rect.right() * target_width + source_width - 1) /
+                         source_width) + 1,
+        static_cast<int>((source_rect.bottom() * target_height + source_height - 1) /
+                         source_height) + 1);
+}
+
+} // namespace codec
@@ -0,0 +1,65 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__SCALE_REDUCER_H
+#define CODEC__SCALE_REDUCER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <memory>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// Scales the captured frames down before encoding. Only the updated areas of the frames are
+// scaled, the scaled frame keeps the rest of the screen from the previous frames.
+class ScaleReducer
+{
+public:
+    ~ScaleReducer();
+
+    // |scale_factor| is the size of the scaled frame in percent of the source size. Returns null
+    // if the frames do not need to be scaled or the factor is less than common::kMinScaleFactor.
+    static std::unique_ptr<ScaleReducer> create(int scale_factor);
+
+    // Scales the updated region of |source_frame|. The returned frame contains the whole scaled
+    // screen, its updated region contains the scaled areas. The frame is valid until the next
+    // call. The frames with other than 32-bit pixels are scaled without filtering.
+    desktop::Frame* scaleFrame(const desktop::Frame* source_frame);
+
+private:
+    explicit ScaleReducer(int scale_factor);
+
+    // Returns the rectangle of the scaled frame which covers |source_rect|.
+    desktop::Rect scaledRect(const desktop::Rect& source_rect) const;
+
+    const int scale_factor_;
+
+    desktop::Size source_size_;
+    std::unique_ptr<desktop::Frame> target_frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScaleReducer);
+};
+
+} // namespace codec
+
+#endif // CODEC__SCALE_REDUCER_H
@@ -0,0 +1,195 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/scale_reducer.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace codec {
+
+namespace {
+
+const desktop::Size kScreenSize(300, 200);
+
+std::unique_ptr<desktop::Frame> createFrame(uint32_t seed)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    std::mt19937 random(seed);
+
+    for (int y = 0; y < kScreenSize.height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+
+        for (int x = 0; x < kScreenSize.width(); ++x)
+            row[x] = random();
+    }
+
+    frame->updatedRegion()->setRect(desktop::Rect::makeSize(kScreenSize));
+    return frame;
+}
+
+bool isEqualFrames(const desktop::Frame& first, const desktop::Frame& second)
+{
+    if (first.size() != second.size())
+        return false;
+
+    const int row_size = first.size().width() * first.format().bytesPerPixel();
+
+    for (int y = 0; y < first.size().height(); ++y)
+    {
+        if (memcmp(first.frameDataAtPos(0, y), second.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+// Changes |rect| of |frame| and scales the frame with |reducer| incrementally. The result must be
+// the same as if the frame was scaled completely.
+void testPartialUpdate(int scale_factor, const desktop::Rect& rect)
+{
+    std::unique_ptr<ScaleReducer> reducer = ScaleReducer::create(scale_factor);
+    ASSERT_TRUE(reducer);
+
+    std::unique_ptr<desktop::Frame> frame = createFrame(1);
+    ASSERT_TRUE(reducer->scaleFrame(frame.get()));
+
+    std::unique_ptr<desktop::Frame> changed_frame = createFrame(2);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        memcpy(frame->frameDataAtPos(rect.left(), y),
+               changed_frame->frameDataAtPos(rect.left(), y),
+               rect.width() * frame->format().bytesPerPixel());
+    }
+
+    frame->updatedRegion()->setRect(rect);
+
+    desktop::Frame* scaled_frame = reducer->scaleFrame(frame.get());
+    ASSERT_TRUE(scaled_frame);
+    EXPECT_FALSE(scaled_frame->constUpdatedRegion().isEmpty());
+
+    std::unique_ptr<ScaleReducer> full_reducer = ScaleReducer::create(scale_factor);
+    desktop::Frame* full_scaled_frame = full_reducer->scaleFrame(frame.get());
+    ASSERT_TRUE(full_scaled_frame);
+
+    EXPECT_TRUE(isEqualFrames(*scaled_frame, *full_scaled_frame));
+}
+
+} // namespace
+
+TEST(scale_reducer_test, create)
+{
+    EXPECT_FALSE(ScaleReducer::create(0));
+    EXPECT_FALSE(ScaleReducer::create(5));
+    EXPECT_FALSE(ScaleReducer::create(100));
+    EXPECT_FALSE(ScaleReducer::create(150));
+    EXPECT_TRUE(ScaleReducer::create(50));
+}
+
+TEST(scale_reducer_test, full_frame)
+{
+    std::unique_ptr<ScaleReducer> reducer = ScaleReducer::create(50);
+    ASSERT_TRUE(reducer);
+
+    std::unique_ptr<desktop::Frame> frame = createFrame(1);
+    frame->setTopLeft(desktop::Point(-300, 100));
+
+    desktop::Frame* scaled_frame = reducer->scaleFrame(frame.get());
+    ASSERT_TRUE(scaled_frame);
+
+    EXPECT_EQ(scaled_frame->size().width(), 150);
+    EXPECT_EQ(scaled_frame->size().height(), 100);
+    EXPECT_EQ(scaled_frame->topLeft().x(), -150);
+    EXPECT_EQ(scaled_frame->topLeft().y(), 50);
+
+    desktop::Region expected_region(desktop::Rect::makeSize(scaled_frame->size()));
+    EXPECT_TRUE(scaled_frame->constUpdatedRegion().equals(expected_region));
+}
+
+TEST(scale_reducer_test, rgb565_frame)
+{
+    std::unique_ptr<ScaleReducer> reducer = ScaleReducer::create(50);
+    ASSERT_TRUE(reducer);
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::RGB565());
+
+    std::mt19937 random(1);
+
+    for (int y = 0; y < kScreenSize.height(); ++y)
+    {
+        uint16_t* row = reinterpret_cast<uint16_t*>(frame->frameDataAtPos(0, y));
+
+        for (int x = 0; x < kScreenSize.width(); ++x)
+            row[x] = static_cast<uint16_t>(random());
+    }
+
+    frame->updatedRegion()->setRect(desktop::Rect::makeSize(kScreenSize));
+
+    desktop::Frame* scaled_frame = reducer->scaleFrame(frame.get());
+    ASSERT_TRUE(scaled_frame);
+    ASSERT_EQ(scaled_frame->size().width(), 150);
+    ASSERT_EQ(scaled_frame->size().height(), 100);
+
+    // Each pixel of the scaled frame is taken from the source frame.
+    for (int y = 0; y < scaled_frame->size().height(); ++y)
+    {
+        for (int x = 0; x < scaled_frame->size().width(); ++x)
+        {
+            ASSERT_EQ(memcmp(scaled_frame->frameDataAtPos(x, y),
+                             frame->frameDataAtPos(x * 2, y * 2), 2), 0);
+        }
+    }
+}
+
+TEST(scale_reducer_test, no_changes)
+{
+    std::unique_ptr<ScaleReducer> reducer = ScaleReducer::create(50);
+    ASSERT_TRUE(reducer);
+
+    std::unique_ptr<desktop::Frame> frame = createFrame(1);
+    ASSERT_TRUE(reducer->scaleFrame(frame.get()));
+
+    frame->updatedRegion()->clear();
+
+    desktop::Frame* scaled_frame = reducer->scaleFrame(frame.get());
+    ASSERT_TRUE(scaled_frame);
+    EXPECT_TRUE(scaled_frame->constUpdatedRegion().isEmpty());
+}
+
+TEST(scale_reducer_test, partial_update_box)
+{
+    testPartialUpdate(50, desktop::Rect::makeXYWH(33, 17, 41, 29));
+    testPartialUpdate(25, desktop::Rect::makeXYWH(0, 0, 7, 5));
+    testPartialUpdate(25, desktop::Rect::makeXYWH(290, 190, 10, 10));
+}
+
+TEST(scale_reducer_test, partial_update_bilinear)
+{
+    testPartialUpdate(75, desktop::Rect::makeXYWH(33, 17, 41, 29));
+    testPartialUpdate(60, desktop::Rect::makeXYWH(0, 0, 7, 5));
+    testPartialUpdate(90, desktop::Rect::makeXYWH(290, 190, 10, 10));
+}
+
+} // namespace codec
@@ -0,0 +1,137 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache_decoder.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+// Width and height of the tiles. Must be the same as in TileCacheEncoder.
+const int kTileSize = 64;
+
+// Limits the memory used by the cache. 4096 tiles of 32-bit pixels take 64 MB.
+const uint32_t kMaxCacheSize = 4096;
+
+} // namespace
+
+TileCacheDecoder::TileCacheDecoder() = default;
+
+TileCacheDecoder::~TileCacheDecoder() = default;
+
+bool TileCacheDecoder::readTiles(const proto::desktop::VideoPacket& packet,
+                                 desktop::Frame* frame)
+{
+    if (packet.tile_cache_size())
+    {
+        if (packet.tile_cache_size() > kMaxCacheSize)
+        {
+            LOG(LS_WARNING) << "Invalid tile cache size: " << packet.tile_cache_size();
+            return false;
+        }
+
+        slots_.clear();
+        slots_.resize(packet.tile_cache_size());
+        bytes_per_pixel_ = frame->format().bytesPerPixel();
+    }
+
+    if (!packet.cached_tile_size() && !packet.stored_tile_size())
+        return true;
+
+    if (slots_.empty() || bytes_per_pixel_ != frame->format().bytesPerPixel())
+    {
+        LOG(LS_WARNING) << "The tile cache is not initialized";
+        return false;
+    }
+
+    for (int i = 0; i < packet.cached_tile_size(); ++i)
+    {
+        const proto::desktop::CacheTile& tile = packet.cached_tile(i);
+        desktop::Rect rect;
+
+        if (!tileRect(tile, *frame, &rect))
+            return false;
+
+        const uint8_t* tile_data = slots_[tile.slot()].get();
+        if (!tile_data)
+        {
+            LOG(LS_WARNING) << "The tile cache slot is empty: " << tile.slot();
+            return false;
+        }
+
+        frame->copyPixelsFrom(tile_data, kTileSize * bytes_per_pixel_, rect);
+    }
+
+    return true;
+}
+
+bool TileCacheDecoder::storeTiles(const proto::desktop::VideoPacket& packet,
+                                  const desktop::Frame& frame)
+{
+    const int bytes_per_row = kTileSize * bytes_per_pixel_;
+
+    for (int i = 0; i < packet.stored_tile_size(); ++i)
+    {
+        const proto::desktop::CacheTile& tile = packet.stored_tile(i);
+        desktop::Rect rect;
+
+        if (!tileRect(tile, frame, &rect))
+            return false;
+
+        std::unique_ptr<uint8_t[]>& tile_data = slots_[tile.slot()];
+        if (!tile_data)
+            tile_data = std::make_unique<uint8_t[]>(bytes_per_row * kTileSize);
+
+        uint8_t* dst = tile_data.get();
+
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            memcpy(dst, frame.frameDataAtPos(rect.left(), y), bytes_per_row);
+            dst += bytes_per_row;
+        }
+    }
+
+    return true;
+}
+
+bool TileCacheDecoder::tileRect(const proto::desktop::CacheTile& tile,
+                                const desktop::Frame& frame,
+                                desktop::Rect* rect) const
+{
+    if (tile.slot() >= slots_.size())
+    {
+        LOG(LS_WARNING) << "Invalid tile cache slot: " << tile.slot();
+        return false;
+    }
+
+    if (tile.x() < 0 || tile.x() > frame.size().width() - kTileSize ||
+        tile.y() < 0 || tile.y() > frame.size().height() - kTileSize)
+    {
+        LOG(LS_WARNING) << "The tile is outside the frame";
+        return false;
+    }
+
+    *rect = desktop::Rect::makeXYWH(tile.x(), tile.y(), kTileSize, kTileSize);
+    return true;
+}
+
+} // namespace codec
@@ -0,0 +1,64 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__TILE_CACHE_DECODER_H
+#define CODEC__TILE_CACHE_DECODER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+#include "proto/desktop.pb.h"
+
+#include <memory>
+#include <vector>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// The tile cache of the client. The host puts the tiles into the slots of the cache and then
+// sends references to them instead of the pixels (see TileCacheEncoder).
+class TileCacheDecoder
+{
+public:
+    TileCacheDecoder();
+    ~TileCacheDecoder();
+
+    // Copies the cached tiles referenced by |packet| to |frame|. Must be called before the data
+    // of the packet is decoded.
+    bool readTiles(const proto::desktop::VideoPacket& packet, desktop::Frame* frame);
+
+    // Puts the tiles of |frame| listed in |packet| into the cache. Must be called after the data
+    // of the packet is decoded.
+    bool storeTiles(const proto::desktop::VideoPacket& packet, const desktop::Frame& frame);
+
+private:
+    // Checks the slot and the position of |tile| and returns the rectangle of the tile.
+    bool tileRect(const proto::desktop::CacheTile& tile, const desktop::Frame& frame,
+                  desktop::Rect* rect) const;
+
+    std::vector<std::unique_ptr<uint8_t[]>> slots_;
+    int bytes_per_pixel_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCacheDecoder);
+};
+
+} // namespace codec
+
+#endif // CODEC__TILE_CACHE_DECODER_H
@@ -0,0 +1,262 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache_encoder.h"
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+#include "desktop/row_hash_sse42.h"
+
+#include <libyuv/cpu_id.h>
+
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+// Width and height of the tiles. Only the complete tiles of the grid are cached.
+const int kTileSize = 64;
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t hashRow_C(const uint8_t* data, int size)
+{
+    uint64_t hash = kFnvOffsetBasis;
+
+    for (int i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * kFnvPrime;
+
+    return hash;
+}
+
+int alignDown(int value)
+{
+    return value - (((value % kTileSize) + kTileSize) % kTileSize);
+}
+
+int alignUp(int value)
+{
+    return alignDown(value + kTileSize - 1);
+}
+
+} // namespace
+
+TileCacheEncoder::TileCacheEncoder(size_t cache_size)
+    : cache_size_(cache_size)
+{
+    DCHECK_GT(cache_size_, 0U);
+
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        hash_row_func_ = desktop::hashRow_SSE42;
+    else
+        hash_row_func_ = hashRow_C;
+}
+
+TileCacheEncoder::~TileCacheEncoder() = default;
+
+bool TileCacheEncoder::encode(desktop::Frame* frame, proto::desktop::VideoPacket* packet)
+{
+    // The frames without changes are not sent.
+    if (frame->constUpdatedRegion().isEmpty())
+        return false;
+
+    // The client keeps the tiles in its own pixel format. The same checksums of the frames in
+    // other formats can mean other pixels.
+    if (!has_format_ || format_ != frame->format())
+    {
+        reset(frame->format());
+        packet->set_tile_cache_size(static_cast<uint32_t>(cache_size_));
+    }
+
+    ++packet_number_;
+
+    // The rectangles of the region are aligned to the grid of the tiles, so each tile is
+    // checked once.
+    desktop::Region tile_region;
+
+    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        tile_region.addRect(desktop::Rect::makeLTRB(alignDown(rect.left()),
+                                                    alignDown(rect.top()),
+                                                    alignUp(rect.right()),
+                                                    alignUp(rect.bottom())));
+    }
+
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
+    desktop::Region cached_region;
+
+    for (desktop::Region::Iterator it(tile_region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        for (int y = rect.top(); y < rect.bottom(); y += kTileSize)
+        {
+            for (int x = rect.left(); x < rect.right(); x += kTileSize)
+            {
+                const desktop::Rect tile = desktop::Rect::makeXYWH(x, y, kTileSize, kTileSize);
+                if (!frame_rect.containsRect(tile))
+                    continue;
+
+                const uint64_t hash = hashTile(frame, x, y);
+                proto::desktop::CacheTile* cache_tile;
+
+                auto result = index_.find(hash);
+                if (result != index_.end())
+                {
+                    const uint32_t slot = result->second;
+
+                    // The client reads the cached tiles before it stores the new ones. The tile
+                    // stored by this packet is sent with the pixels.
+                    if (slots_[slot].packet_number == packet_number_)
+                        continue;
+
+                    touchSlot(slot);
+
+                    if (isTileEqual(frame, x, y, slot))
+                    {
+                        cached_region.addRect(tile);
+                        cache_tile = packet->add_cached_tile();
+                    }
+                    else
+                    {
+                        // Other pixels with the same checksum. The slot is reused for the new
+                        // tile, the index does not change.
+                        storeTile(frame, x, y, slot, hash);
+                        cache_tile = packet->add_stored_tile();
+                    }
+
+                    cache_tile->set_slot(slot);
+                }
+                else
+                {
+                    const uint32_t slot = allocateSlot();
+
+                    if (slots_[slot].packet_number)
+                        index_.erase(slots_[slot].hash);
+
+                    storeTile(frame, x, y, slot, hash);
+                    index_.emplace(hash, slot);
+                    touchSlot(slot);
+
+                    cache_tile = packet->add_stored_tile();
+                    cache_tile->set_slot(slot);
+                }
+
+                cache_tile->set_x(x);
+                cache_tile->set_y(y);
+            }
+        }
+    }
+
+    if (cached_region.isEmpty())
+        return false;
+
+    frame->updatedRegion()->subtract(cached_region);
+    return true;
+}
+
+uint64_t TileCacheEncoder::hashTile(const desktop::Frame* frame, int x, int y) const
+{
+    const int bytes_per_row = kTileSize * frame->format().bytesPerPixel();
+    const uint8_t* row = frame->frameDataAtPos(x, y);
+    uint64_t hash = kFnvOffsetBasis;
+
+    for (int i = 0; i < kTileSize; ++i)
+    {
+        hash = (hash ^ hash_row_func_(row, bytes_per_row)) * kFnvPrime;
+        row += frame->stride();
+    }
+
+    return hash;
+}
+
+bool TileCacheEncoder::isTileEqual(
+    const desktop::Frame* frame, int x, int y, uint32_t slot) const
+{
+    const int bytes_per_row = kTileSize * frame->format().bytesPerPixel();
+    const uint8_t* row = frame->frameDataAtPos(x, y);
+    const uint8_t* tile_row = slots_[slot].data.get();
+
+    for (int i = 0; i < kTileSize; ++i)
+    {
+        if (memcmp(row, tile_row, bytes_per_row) != 0)
+            return false;
+
+        row += frame->stride();
+        tile_row += bytes_per_row;
+    }
+
+    return true;
+}
+
+void TileCacheEncoder::storeTile(
+    const desktop::Frame* frame, int x, int y, uint32_t slot, uint64_t hash)
+{
+    const int bytes_per_row = kTileSize * frame->format().bytesPerPixel();
+    Slot& entry = slots_[slot];
+
+    if (!entry.data)
+        entry.data = std::make_unique<uint8_t[]>(bytes_per_row * kTileSize);
+
+    const uint8_t* row = frame->frameDataAtPos(x, y);
+    uint8_t* tile_row = entry.data.get();
+
+    for (int i = 0; i < kTileSize; ++i)
+    {
+        memcpy(tile_row, row, bytes_per_row);
+        row += frame->stride();
+        tile_row += bytes_per_row;
+    }
+
+    entry.hash = hash;
+    entry.packet_number = packet_number_;
+}
+
+void TileCacheEncoder::touchSlot(uint32_t slot)
+{
+    lru_.splice(lru_.begin(), lru_, slots_[slot].lru_position);
+}
+
+uint32_t TileCacheEncoder::allocateSlot()
+{
+    if (slots_.size() < cache_size_)
+    {
+        const uint32_t slot = static_cast<uint32_t>(slots_.size());
+
+        slots_.emplace_back();
+        slots_.back().lru_position = lru_.insert(lru_.end(), slot);
+        return slot;
+    }
+
+    return lru_.back();
+}
+
+void TileCacheEncoder::reset(const desktop::PixelFormat& format)
+{
+    slots_.clear();
+    index_.clear();
+    lru_.clear();
+
+    format_ = format;
+    has_format_ = true;
+}
+
+} // namespace codec
@@ -0,0 +1,101 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__TILE_CACHE_ENCODER_H
+#define CODEC__TILE_CACHE_ENCODER_H
+
+#include "base/macros_magic.h"
+#include "desktop/pixel_format.h"
+#include "proto/desktop.pb.h"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// Keeps the index of the tiles which the client has in its tile cache (see TileCacheDecoder).
+// The tiles of the updated region which are found in the cache are sent as references, the
+// client copies them from the cache. The host keeps a copy of the pixels of each slot: the
+// checksum only finds the candidate slot, the reference is sent when the pixels are equal. The
+// host chooses the slot for each new tile, so the client does not need its own replacement
+// policy.
+class TileCacheEncoder
+{
+public:
+    // |cache_size| is the number of tiles which the client keeps.
+    explicit TileCacheEncoder(size_t cache_size);
+    ~TileCacheEncoder();
+
+    // Replaces the tiles of the updated region of |frame| which the client has with references
+    // to the cache and removes them from the updated region. The other tiles are added to the
+    // cache. Returns true if |packet| references the cached tiles.
+    bool encode(desktop::Frame* frame, proto::desktop::VideoPacket* packet);
+
+private:
+    typedef uint64_t(*HashRowFunc)(const uint8_t*, int);
+
+    struct Slot
+    {
+        uint64_t hash = 0;
+
+        // The same pixels as the client has in the slot.
+        std::unique_ptr<uint8_t[]> data;
+
+        // Number of the packet in which the tile was put into the slot.
+        int64_t packet_number = 0;
+
+        std::list<uint32_t>::iterator lru_position;
+    };
+
+    uint64_t hashTile(const desktop::Frame* frame, int x, int y) const;
+    bool isTileEqual(const desktop::Frame* frame, int x, int y, uint32_t slot) const;
+    void storeTile(const desktop::Frame* frame, int x, int y, uint32_t slot, uint64_t hash);
+
+    // Marks the slot as the most recently used one.
+    void touchSlot(uint32_t slot);
+
+    // Returns the empty slot or the least recently used one.
+    uint32_t allocateSlot();
+
+    void reset(const desktop::PixelFormat& format);
+
+    const size_t cache_size_;
+    HashRowFunc hash_row_func_;
+
+    std::vector<Slot> slots_;
+    std::unordered_map<uint64_t, uint32_t> index_;
+
+    // Slots sorted from the most recently used to the least recently used.
+    std::list<uint32_t> lru_;
+
+    int64_t packet_number_ = 0;
+    bool has_format_ = false;
+    desktop::PixelFormat format_;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCacheEncoder);
+};
+
+} // namespace codec
+
+#endif // CODEC__TILE_CACHE_ENCODER_H
@@ -0,0 +1,212 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache_decoder.h"
+#include "codec/tile_cache_encoder.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace codec {
+
+namespace {
+
+// 4x3 tiles and the partial tiles on the right and bottom edges.
+const desktop::Size kScreenSize(280, 200);
+
+// Simulates the session: the host frame is passed through the tile cache and the lossless
+// encoder to the client frame.
+class Session
+{
+public:
+    explicit Session(size_t cache_size)
+        : encoder_(cache_size),
+          host_frame_(desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB())),
+          client_frame_(desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB()))
+    {
+        // Nothing
+    }
+
+    // Draws one of the pages (windows) over the whole screen.
+    void showPage(uint32_t page)
+    {
+        std::mt19937 random(page);
+
+        for (int y = 0; y < kScreenSize.height(); ++y)
+        {
+            uint32_t* row = reinterpret_cast<uint32_t*>(host_frame_->frameDataAtPos(0, y));
+
+            for (int x = 0; x < kScreenSize.width(); ++x)
+                row[x] = random();
+        }
+
+        host_frame_->updatedRegion()->setRect(desktop::Rect::makeSize(kScreenSize));
+    }
+
+    bool sendFrame()
+    {
+        packet_.Clear();
+
+        const bool has_cached_tiles = encoder_.encode(host_frame_.get(), &packet_);
+        EXPECT_EQ(has_cached_tiles, packet_.cached_tile_size() != 0);
+
+        if (!decoder_.readTiles(packet_, client_frame_.get()))
+            return false;
+
+        // The lossless encoder delivers the rest of the updated region.
+        const desktop::Region& updated_region = host_frame_->constUpdatedRegion();
+
+        for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+            client_frame_->copyPixelsFrom(*host_frame_, it.rect().topLeft(), it.rect());
+
+        return decoder_.storeTiles(packet_, *client_frame_);
+    }
+
+    bool isClientFrameEqual() const
+    {
+        const size_t bytes_per_row =
+            kScreenSize.width() * host_frame_->format().bytesPerPixel();
+
+        for (int y = 0; y < kScreenSize.height(); ++y)
+        {
+            if (memcmp(host_frame_->frameDataAtPos(0, y),
+                       client_frame_->frameDataAtPos(0, y),
+                       bytes_per_row) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    desktop::Frame* hostFrame() const { return host_frame_.get(); }
+    const proto::desktop::VideoPacket& packet() const { return packet_; }
+
+private:
+    TileCacheEncoder encoder_;
+    TileCacheDecoder decoder_;
+
+    std::unique_ptr<desktop::Frame> host_frame_;
+    std::unique_ptr<desktop::Frame> client_frame_;
+
+    proto::desktop::VideoPacket packet_;
+};
+
+} // namespace
+
+TEST(tile_cache_test, first_frame_is_stored)
+{
+    Session session(64);
+
+    session.showPage(1);
+    ASSERT_TRUE(session.sendFrame());
+
+    EXPECT_EQ(64U, session.packet().tile_cache_size());
+    EXPECT_EQ(12, session.packet().stored_tile_size());
+    EXPECT_EQ(0, session.packet().cached_tile_size());
+    EXPECT_TRUE(session.hostFrame()->constUpdatedRegion().equals(
+        desktop::Region(desktop::Rect::makeSize(kScreenSize))));
+    EXPECT_TRUE(session.isClientFrameEqual());
+}
+
+TEST(tile_cache_test, previous_window_is_cached)
+{
+    Session session(64);
+
+    session.showPage(1);
+    ASSERT_TRUE(session.sendFrame());
+
+    session.showPage(2);
+    ASSERT_TRUE(session.sendFrame());
+    EXPECT_EQ(0, session.packet().cached_tile_size());
+
+    session.showPage(1);
+    ASSERT_TRUE(session.sendFrame());
+
+    // Only the partial tiles on the edges are encoded.
+    EXPECT_EQ(0U, session.packet().tile_cache_size());
+    EXPECT_EQ(12, session.packet().cached_tile_size());
+    EXPECT_EQ(0, session.packet().stored_tile_size());
+    desktop::Region edges(desktop::Rect::makeSize(kScreenSize));
+    edges.subtract(desktop::Rect::makeXYWH(0, 0, 256, 192));
+    EXPECT_TRUE(session.hostFrame()->constUpdatedRegion().equals(edges));
+    EXPECT_TRUE(session.isClientFrameEqual());
+}
+
+TEST(tile_cache_test, moved_tile_is_cached)
+{
+    Session session(64);
+
+    session.showPage(1);
+    ASSERT_TRUE(session.sendFrame());
+
+    desktop::Frame* frame = session.hostFrame();
+    const desktop::Rect dest_rect = desktop::Rect::makeXYWH(128, 64, 64, 64);
+
+    frame->copyPixelsFrom(*frame, desktop::Point(0, 0), dest_rect);
+    frame->updatedRegion()->setRect(dest_rect);
+    ASSERT_TRUE(session.sendFrame());
+
+    ASSERT_EQ(1, session.packet().cached_tile_size());
+    EXPECT_EQ(128, session.packet().cached_tile(0).x());
+    EXPECT_EQ(64, session.packet().cached_tile(0).y());
+    EXPECT_TRUE(frame->constUpdatedRegion().isEmpty());
+    EXPECT_TRUE(session.isClientFrameEqual());
+}
+
+TEST(tile_cache_test, small_cache)
+{
+    // The cache is smaller than a frame, the slots are reused within the packets.
+    Session session(5);
+    std::mt19937 random;
+
+    for (int i = 0; i < 50; ++i)
+    {
+        session.showPage(random() % 3);
+        ASSERT_TRUE(session.sendFrame());
+        ASSERT_TRUE(session.isClientFrameEqual());
+    }
+}
+
+TEST(tile_cache_test, invalid_slot)
+{
+    TileCacheDecoder decoder;
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    proto::desktop::VideoPacket packet;
+    packet.set_tile_cache_size(4);
+
+    proto::desktop::CacheTile* tile = packet.add_cached_tile();
+    tile->set_slot(1);
+    EXPECT_FALSE(decoder.readTiles(packet, frame.get()));
+
+    tile->set_slot(4);
+    EXPECT_FALSE(decoder.readTiles(packet, frame.get()));
+
+    packet.clear_cached_tile();
+    tile = packet.add_stored_tile();
+    tile->set_slot(0);
+    tile->set_x(kScreenSize.width() - 32);
+    EXPECT_FALSE(decoder.storeTiles(packet, *frame));
+}
+
+} // namespace codec
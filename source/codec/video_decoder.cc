@@ -17,13 +17,15 @@
 //
 
 #include "codec/video_decoder.h"
+#include "codec/video_decoder_hybrid.h"
 #include "codec/video_decoder_vpx.h"
 #include "codec/video_decoder_zstd.h"
 
 namespace codec {
 
 // static
-std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::desktop::VideoEncoding encoding)
+std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::desktop::VideoEncoding encoding,
+                                                   int thread_count)
 {
     switch (encoding)
     {
@@ -31,10 +33,15 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::desktop::VideoEncoding
             return VideoDecoderZstd::create();
 
         case proto::desktop::VIDEO_ENCODING_VP8:
-            return VideoDecoderVPX::createVP8();
+            return VideoDecoderVPX::createVP8(thread_count);
 
         case proto::desktop::VIDEO_ENCODING_VP9:
-            return VideoDecoderVPX::createVP9();
+        case proto::desktop::VIDEO_ENCODING_VP9_I444:
+        case proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS:
+            return VideoDecoderVPX::createVP9(thread_count);
+
+        case proto::desktop::VIDEO_ENCODING_HYBRID:
+            return VideoDecoderHybrid::create(thread_count);
 
         default:
             return nullptr;
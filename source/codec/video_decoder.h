@@ -34,7 +34,10 @@ class VideoDecoder
 public:
     virtual ~VideoDecoder() = default;
 
-    static std::unique_ptr<VideoDecoder> create(proto::desktop::VideoEncoding encoding);
+    // |thread_count| is the number of threads of the VP8/VP9 decoders. If 0, it is chosen by the
+    // number of processors.
+    static std::unique_ptr<VideoDecoder> create(proto::desktop::VideoEncoding encoding,
+                                                int thread_count);
 
     virtual bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame) = 0;
 };
@@ -0,0 +1,69 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_decoder_hybrid.h"
+#include "base/logging.h"
+
+namespace codec {
+
+// static
+std::unique_ptr<VideoDecoderHybrid> VideoDecoderHybrid::create(int thread_count)
+{
+    return std::unique_ptr<VideoDecoderHybrid>(new VideoDecoderHybrid(thread_count));
+}
+
+VideoDecoderHybrid::VideoDecoderHybrid(int thread_count)
+    : thread_count_(thread_count)
+{
+    // Nothing
+}
+
+bool VideoDecoderHybrid::decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame)
+{
+    for (int i = 0; i < packet.part_size(); ++i)
+    {
+        const proto::desktop::VideoPacket& part = packet.part(i);
+
+        switch (part.encoding())
+        {
+            case proto::desktop::VIDEO_ENCODING_ZSTD:
+            case proto::desktop::VIDEO_ENCODING_VP8:
+            case proto::desktop::VIDEO_ENCODING_VP9:
+                break;
+
+            default:
+                LOG(LS_WARNING) << "Unsupported encoding of the part: " << part.encoding();
+                return false;
+        }
+
+        std::unique_ptr<VideoDecoder>& decoder = decoders_[part.encoding()];
+        if (!decoder)
+        {
+            decoder = VideoDecoder::create(part.encoding(), thread_count_);
+            if (!decoder)
+                return false;
+        }
+
+        if (!decoder->decode(part, frame))
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace codec
@@ -0,0 +1,51 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_DECODER_HYBRID_H
+#define CODEC__VIDEO_DECODER_HYBRID_H
+
+#include "base/macros_magic.h"
+#include "codec/video_decoder.h"
+
+#include <map>
+
+namespace codec {
+
+// Decodes the parts of VIDEO_ENCODING_HYBRID packets into one frame. Each encoding of the parts
+// has its own decoder which keeps its state between the packets.
+class VideoDecoderHybrid : public VideoDecoder
+{
+public:
+    ~VideoDecoderHybrid() = default;
+
+    static std::unique_ptr<VideoDecoderHybrid> create(int thread_count);
+
+    bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame) override;
+
+private:
+    explicit VideoDecoderHybrid(int thread_count);
+
+    const int thread_count_;
+    std::map<proto::desktop::VideoEncoding, std::unique_ptr<VideoDecoder>> decoders_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderHybrid);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_DECODER_HYBRID_H
@@ -24,19 +24,39 @@
 #include <libyuv/convert_from.h>
 #include <libyuv/convert_argb.h>
 
+#if defined(USE_TBB)
+#include <tbb/parallel_for.h>
+#endif // defined(USE_TBB)
+
+#include <algorithm>
+#include <thread>
+
 namespace codec {
 
 namespace {
 
-bool convertImage(const proto::desktop::VideoPacket& packet,
-                  vpx_image_t* image,
-                  desktop::Frame* frame)
+// Height of the slices in which the dirty rectangles are converted to RGB. Must be even, the
+// chroma planes of I420 have half of the height.
+const int kConvertSliceHeight = 64;
+
+// The conversion is parallelized only if the dirty area is not less than this number of pixels.
+const int kMinParallelConvertArea = 256 * 256;
+
+// libvpx does not use more threads for the screen sizes we have.
+const int kMaxThreadCount = 8;
+
+int decoderThreadCount(int requested_thread_count)
 {
-    if (image->fmt != VPX_IMG_FMT_I420)
-        return false;
+    const int cpu_count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
 
-    desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
+    if (requested_thread_count > 0)
+        return std::min(requested_thread_count, cpu_count);
+
+    return std::min(cpu_count, kMaxThreadCount);
+}
 
+void convertRect(const vpx_image_t* image, const desktop::Rect& rect, desktop::Frame* frame)
+{
     uint8_t* y_data = image->planes[0];
     uint8_t* u_data = image->planes[1];
     uint8_t* v_data = image->planes[2];
@@ -44,17 +64,22 @@ bool convertImage(const proto::desktop::VideoPacket& packet,
     int y_stride = image->stride[0];
     int uv_stride = image->stride[1];
 
-    for (int i = 0; i < packet.dirty_rect_size(); ++i)
-    {
-        desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(i));
+    int y_offset = y_stride * rect.y() + rect.x();
 
-        if (!frame_rect.containsRect(rect))
-        {
-            LOG(LS_WARNING) << "The rectangle is outside the screen area";
-            return false;
-        }
+    if (image->fmt == VPX_IMG_FMT_I444)
+    {
+        int uv_offset = uv_stride * rect.y() + rect.x();
 
-        int y_offset = y_stride * rect.y() + rect.x();
+        libyuv::I444ToARGB(y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           rect.width(),
+                           rect.height());
+    }
+    else
+    {
         int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
 
         libyuv::I420ToARGB(y_data + y_offset, y_stride,
@@ -65,27 +90,25 @@ bool convertImage(const proto::desktop::VideoPacket& packet,
                            rect.width(),
                            rect.height());
     }
-
-    return true;
 }
 
 } // namespace
 
 // static
-std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP8()
+std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP8(int thread_count)
 {
     return std::unique_ptr<VideoDecoderVPX>(
-        new VideoDecoderVPX(proto::desktop::VIDEO_ENCODING_VP8));
+        new VideoDecoderVPX(proto::desktop::VIDEO_ENCODING_VP8, thread_count));
 }
 
 // static
-std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP9()
+std::unique_ptr<VideoDecoderVPX> VideoDecoderVPX::createVP9(int thread_count)
 {
     return std::unique_ptr<VideoDecoderVPX>(
-        new VideoDecoderVPX(proto::desktop::VIDEO_ENCODING_VP9));
+        new VideoDecoderVPX(proto::desktop::VIDEO_ENCODING_VP9, thread_count));
 }
 
-VideoDecoderVPX::VideoDecoderVPX(proto::desktop::VideoEncoding encoding)
+VideoDecoderVPX::VideoDecoderVPX(proto::desktop::VideoEncoding encoding, int thread_count)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
@@ -93,7 +116,7 @@ VideoDecoderVPX::VideoDecoderVPX(proto::desktop::VideoEncoding encoding)
 
     config.w = 0;
     config.h = 0;
-    config.threads = 2;
+    config.threads = decoderThreadCount(thread_count);
 
     vpx_codec_iface_t* algo;
 
@@ -154,4 +177,57 @@ bool VideoDecoderVPX::decode(const proto::desktop::VideoPacket& packet, desktop:
     return convertImage(packet, image, frame);
 }
 
+bool VideoDecoderVPX::convertImage(const proto::desktop::VideoPacket& packet,
+                                   const vpx_image_t* image,
+                                   desktop::Frame* frame)
+{
+    if (image->fmt != VPX_IMG_FMT_I420 && image->fmt != VPX_IMG_FMT_I444)
+    {
+        LOG(LS_WARNING) << "Unsupported image format: " << image->fmt;
+        return false;
+    }
+
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(frame->size());
+
+    slices_.clear();
+    int dirty_area = 0;
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(i));
+
+        if (!frame_rect.containsRect(rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        // The encoder aligns the rectangles to even coordinates, so the slices do not share the
+        // rows of the chroma planes.
+        for (int y = rect.top(); y < rect.bottom(); y += kConvertSliceHeight)
+        {
+            slices_.emplace_back(desktop::Rect::makeLTRB(
+                rect.left(), y, rect.right(), std::min(y + kConvertSliceHeight, rect.bottom())));
+        }
+
+        dirty_area += rect.width() * rect.height();
+    }
+
+#if defined(USE_TBB)
+    if (dirty_area >= kMinParallelConvertArea)
+    {
+        tbb::parallel_for(size_t(0), slices_.size(), [&](size_t index)
+        {
+            convertRect(image, slices_[index], frame);
+        });
+        return true;
+    }
+#endif // defined(USE_TBB)
+
+    for (const auto& slice : slices_)
+        convertRect(image, slice, frame);
+
+    return true;
+}
+
 } // namespace codec
@@ -22,11 +22,14 @@
 #include "base/macros_magic.h"
 #include "codec/scoped_vpx_codec.h"
 #include "codec/video_decoder.h"
+#include "desktop/desktop_geometry.h"
 
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_decoder.h>
 #include <vpx/vp8dx.h>
 
+#include <vector>
+
 namespace codec {
 
 class VideoDecoderVPX : public VideoDecoder
@@ -34,15 +37,24 @@ class VideoDecoderVPX : public VideoDecoder
 public:
     ~VideoDecoderVPX() = default;
 
-    static std::unique_ptr<VideoDecoderVPX> createVP8();
-    static std::unique_ptr<VideoDecoderVPX> createVP9();
+    // |thread_count| is the number of threads of libvpx. If 0, it is chosen by the number of
+    // processors.
+    static std::unique_ptr<VideoDecoderVPX> createVP8(int thread_count);
+    static std::unique_ptr<VideoDecoderVPX> createVP9(int thread_count);
 
     bool decode(const proto::desktop::VideoPacket& packet, desktop::Frame* frame) override;
 
 private:
-    explicit VideoDecoderVPX(proto::desktop::VideoEncoding encoding);
+    VideoDecoderVPX(proto::desktop::VideoEncoding encoding, int thread_count);
+
+    // Converts the dirty rectangles of |image| to RGB. Large areas are converted in parallel
+    // slices.
+    bool convertImage(const proto::desktop::VideoPacket& packet,
+                      const vpx_image_t* image,
+                      desktop::Frame* frame);
 
     ScopedVpxCodec codec_;
+    std::vector<desktop::Rect> slices_;
 
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderVPX);
 };
@@ -22,8 +22,71 @@
 #include "codec/video_util.h"
 #include "desktop/desktop_frame_aligned.h"
 
+#if defined(USE_TBB)
+#include <tbb/parallel_for.h>
+#endif // defined(USE_TBB)
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace codec {
 
+namespace {
+
+// Decompresses the rectangle |rect| of |frame| from |input|. The stream must be initialized.
+bool decompressRect(ZSTD_DStream* stream,
+                    ZSTD_inBuffer* input,
+                    const desktop::Rect& rect,
+                    desktop::Frame* frame)
+{
+    uint8_t* output_data = frame->frameDataAtPos(rect.x(), rect.y());
+    const size_t output_size = rect.width() * frame->format().bytesPerPixel();
+
+    ZSTD_outBuffer output = { output_data, output_size, 0 };
+    int row_y = 0;
+
+    while (row_y < rect.height())
+    {
+        const size_t input_pos = input->pos;
+        const size_t output_pos = output.pos;
+
+        size_t ret = ZSTD_decompressStream(stream, &output, input);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        // If we completely unpacked the row in the rectangle.
+        if (output.pos == output.size)
+        {
+            ++row_y;
+            output_data += frame->stride();
+            output.dst = output_data;
+            output.pos = 0;
+        }
+        else if (input->pos == input_pos && output.pos == output_pos)
+        {
+            LOG(LS_WARNING) << "Not enough data to decompress the rectangle";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+size_t tileThreadCount()
+{
+#if defined(USE_TBB)
+    return std::max(std::thread::hardware_concurrency(), 1U);
+#else // defined(USE_TBB)
+    return 1;
+#endif // defined(USE_*)
+}
+
+} // namespace
+
 VideoDecoderZstd::VideoDecoderZstd()
     : stream_(ZSTD_createDStream())
 {
@@ -42,26 +105,59 @@ bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
     if (packet.has_format())
     {
         const proto::desktop::VideoPacketFormat& format = packet.format();
+        const desktop::PixelFormat source_format =
+            VideoUtil::fromVideoPixelFormat(format.pixel_format());
 
-        source_frame_ = desktop::FrameAligned::create(
-            desktop::Size(format.screen_rect().width(), format.screen_rect().height()),
-            VideoUtil::fromVideoPixelFormat(format.pixel_format()), 32);
+        if (source_format == target_frame->format())
+        {
+            // The pixels are decompressed directly into the target frame.
+            source_frame_.reset();
+            translator_.reset();
+        }
+        else
+        {
+            source_frame_ = desktop::FrameAligned::create(
+                desktop::Size(format.screen_rect().width(), format.screen_rect().height()),
+                source_format, 32);
 
-        translator_ = PixelTranslator::create(source_frame_->format(), target_frame->format());
-    }
+            translator_ = PixelTranslator::create(source_format, target_frame->format());
+            if (!source_frame_ || !translator_)
+            {
+                LOG(LS_WARNING) << "Unsupported pixel format";
+                has_format_ = false;
+                return false;
+            }
 
-    DCHECK(source_frame_->size() == target_frame->size());
+            DCHECK(source_frame_->size() == target_frame->size());
+        }
+
+        has_format_ = true;
+    }
 
-    if (!source_frame_ || !translator_)
+    if (!has_format_)
     {
         LOG(LS_WARNING) << "A packet with image information was not received";
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    // The encoder restarts the continuous stream when the screen format changes, even if the
+    // packet itself is tiled.
+    if (packet.has_format())
+    {
+        size_t ret = ZSTD_DCtx_reset(stream_.get(), ZSTD_reset_session_only);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+
+    if (packet.tile_size_size() != 0)
+        return decodeTiles(packet, target_frame);
+
+    if (!packet.continuous_stream())
+    {
+        size_t ret = ZSTD_initDStream(stream_.get());
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
 
-    desktop::Rect frame_rect = desktop::Rect::makeSize(source_frame_->size());
+    desktop::Rect frame_rect = desktop::Rect::makeSize(target_frame->size());
     ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
 
     for (int i = 0; i < packet.dirty_rect_size(); ++i)
@@ -74,39 +170,111 @@ bool VideoDecoderZstd::decode(const proto::desktop::VideoPacket& packet,
             return false;
         }
 
-        uint8_t* output_data = source_frame_->frameDataAtPos(rect.x(), rect.y());
-        const size_t output_size = rect.width() * source_frame_->format().bytesPerPixel();
+        if (!decompressRectToFrame(stream_.get(), &input, rect, target_frame))
+            return false;
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstd::decodeTiles(const proto::desktop::VideoPacket& packet,
+                                   desktop::Frame* target_frame)
+{
+    const int tile_count = packet.tile_size_size();
+
+    if (tile_count != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Number of tiles does not match the number of rectangles";
+        return false;
+    }
 
-        ZSTD_outBuffer output = { output_data, output_size, 0 };
-        int row_y = 0;
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(target_frame->size());
+    const std::string& data = packet.data();
 
-        while (row_y < rect.height())
+    // Offset of each tile in the packet data.
+    std::vector<size_t> tile_offsets(tile_count);
+    size_t offset = 0;
+
+    for (int i = 0; i < tile_count; ++i)
+    {
+        if (!frame_rect.containsRect(VideoUtil::fromVideoRect(packet.dirty_rect(i))))
         {
-            ret = ZSTD_decompressStream(stream_.get(), &output, &input);
-            if (ZSTD_isError(ret))
-            {
-                LOG(LS_WARNING) << "ZSTD_decompressStream failed: " << ZSTD_getErrorName(ret);
-                return false;
-            }
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
 
-            // If we completely unpacked the row in the rectangle.
-            if (output.pos == output.size)
+        if (packet.tile_size(i) > data.size() - offset)
+        {
+            LOG(LS_WARNING) << "The tile is outside the packet data";
+            return false;
+        }
+
+        tile_offsets[i] = offset;
+        offset += packet.tile_size(i);
+    }
+
+    if (tile_streams_.empty())
+    {
+        const size_t thread_count = tileThreadCount();
+
+        for (size_t i = 0; i < thread_count; ++i)
+            tile_streams_.emplace_back(ZSTD_createDStream());
+    }
+
+    std::atomic_int next_tile = 0;
+    std::atomic_bool has_error = false;
+
+    // Each thread takes the next compressed tile until all tiles are decompressed. The tiles do
+    // not intersect, so they can be written to the frames at the same time.
+    auto decompress_tiles = [&](ZSTD_DStream* stream)
+    {
+        for (int index = next_tile++; index < tile_count && !has_error; index = next_tile++)
+        {
+            const desktop::Rect rect = VideoUtil::fromVideoRect(packet.dirty_rect(index));
+
+            size_t ret = ZSTD_initDStream(stream);
+            DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+            ZSTD_inBuffer input =
+                { data.data() + tile_offsets[index], packet.tile_size(index), 0 };
+
+            if (!decompressRectToFrame(stream, &input, rect, target_frame))
             {
-                ++row_y;
-                output_data += source_frame_->stride();
-                output.dst = output_data;
-                output.pos = 0;
+                has_error = true;
+                return;
             }
         }
+    };
 
-        translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
-                               source_frame_->stride(),
-                               target_frame->frameDataAtPos(rect.topLeft()),
-                               target_frame->stride(),
-                               rect.width(),
-                               rect.height());
-    }
+#if defined(USE_TBB)
+    tbb::parallel_for(size_t(0), tile_streams_.size(), [&](size_t thread_index)
+    {
+        decompress_tiles(tile_streams_[thread_index].get());
+    });
+#else // defined(USE_TBB)
+    decompress_tiles(tile_streams_.front().get());
+#endif // defined(USE_*)
+
+    return !has_error;
+}
+
+bool VideoDecoderZstd::decompressRectToFrame(ZSTD_DStream* stream,
+                                             ZSTD_inBuffer* input,
+                                             const desktop::Rect& rect,
+                                             desktop::Frame* target_frame)
+{
+    if (!translator_)
+        return decompressRect(stream, input, rect, target_frame);
+
+    if (!decompressRect(stream, input, rect, source_frame_.get()))
+        return false;
 
+    translator_->translate(source_frame_->frameDataAtPos(rect.topLeft()),
+                           source_frame_->stride(),
+                           target_frame->frameDataAtPos(rect.topLeft()),
+                           target_frame->stride(),
+                           rect.width(),
+                           rect.height());
     return true;
 }
 
@@ -22,6 +22,9 @@
 #include "base/macros_magic.h"
 #include "codec/scoped_zstd_stream.h"
 #include "codec/video_decoder.h"
+#include "desktop/desktop_geometry.h"
+
+#include <vector>
 
 namespace codec {
 
@@ -39,10 +42,27 @@ public:
 private:
     VideoDecoderZstd();
 
+    // Decodes a packet in which each rectangle is compressed as an independent frame. The tiles
+    // are decompressed in parallel.
+    bool decodeTiles(const proto::desktop::VideoPacket& packet, desktop::Frame* target_frame);
+
     ScopedZstdDStream stream_;
 
+    // Streams of the threads that decompress the tiles.
+    std::vector<ScopedZstdDStream> tile_streams_;
+
+    // Decompresses the rectangle |rect| into |target_frame|. If the pixel formats differ, the
+    // rectangle is decompressed into |source_frame_| and then translated.
+    bool decompressRectToFrame(ZSTD_DStream* stream,
+                               ZSTD_inBuffer* input,
+                               const desktop::Rect& rect,
+                               desktop::Frame* target_frame);
+
+    // The translator and the source frame are null if the host sends the pixels in the format
+    // of the target frame.
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<desktop::Frame> source_frame_;
+    bool has_format_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstd);
 };
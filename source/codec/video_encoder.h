@@ -24,6 +24,7 @@
 
 namespace desktop {
 class Frame;
+class Region;
 } // namespace desktop
 
 namespace codec {
@@ -35,6 +36,15 @@ public:
 
     virtual void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) = 0;
 
+    // Sets the number of bytes which are waiting to be sent to the client. The encoders which
+    // control the bitrate use it to estimate the throughput of the channel.
+    virtual void setPendingBytes(int64_t /* pending_bytes */) {}
+
+    // Called when the screen has not changed for a while. Adds to |region| the areas which were
+    // encoded with reduced quality and makes the next encode() call send them in the best
+    // quality. Returns false if there is nothing to refresh.
+    virtual bool prepareRefresh(desktop::Region* /* region */) { return false; }
+
 protected:
     void fillPacketInfo(proto::desktop::VideoEncoding encoding,
                         const desktop::Frame* frame,
@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_hybrid.h"
+#include "base/logging.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+
+namespace codec {
+
+namespace {
+
+// Shares the pixels of another frame. Each encoder gets a view with its own updated region.
+class FrameView : public desktop::Frame
+{
+public:
+    FrameView(const desktop::Frame* frame, const desktop::Region& updated_region)
+        : Frame(frame->size(), frame->format(), frame->stride(), frame->frameData())
+    {
+        setTopLeft(frame->topLeft());
+        *updatedRegion() = updated_region;
+    }
+
+private:
+    DISALLOW_COPY_AND_ASSIGN(FrameView);
+};
+
+} // namespace
+
+VideoEncoderHybrid::VideoEncoderHybrid(VideoEncoderZstd* lossless_encoder,
+                                       VideoEncoderVPX* lossy_encoder)
+    : lossless_encoder_(lossless_encoder),
+      lossy_encoder_(lossy_encoder)
+{
+    // Nothing
+}
+
+VideoEncoderHybrid::~VideoEncoderHybrid() = default;
+
+// static
+VideoEncoderHybrid* VideoEncoderHybrid::create(const desktop::PixelFormat& target_format,
+                                               int compression_ratio,
+                                               uint32_t video_features,
+                                               uint32_t thread_count,
+                                               proto::desktop::VideoQuality quality)
+{
+    return new VideoEncoderHybrid(
+        VideoEncoderZstd::create(target_format, compression_ratio, video_features),
+        VideoEncoderVPX::createVP9(thread_count, quality));
+}
+
+void VideoEncoderHybrid::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
+{
+    fillPacketInfo(proto::desktop::VIDEO_ENCODING_HYBRID, frame, packet);
+
+    if (packet->has_format())
+    {
+        // The previous areas of the lossy encoder are outside the new screen.
+        lossy_region_.clear();
+        refresh_ = false;
+    }
+
+    desktop::Region lossy_region;
+    desktop::Region lossless_region;
+
+    classifier_.classify(frame, &lossy_region, &lossless_region);
+
+    if (refresh_)
+    {
+        // The static screen is sent again without losses.
+        lossless_region.addRegion(lossy_region);
+        lossy_region.clear();
+        lossy_region_.clear();
+        refresh_ = false;
+    }
+
+    // The lossy part goes first. The lossless part can overwrite the pixels which the VP9 encoder
+    // adds around its rectangles.
+    if (!lossy_region.isEmpty())
+    {
+        FrameView lossy_frame(frame, lossy_region);
+        proto::desktop::VideoPacket* part = packet->add_part();
+
+        lossy_encoder_->encode(&lossy_frame, part);
+
+        // The rectangles of the part include the padding added by the encoder.
+        for (int i = 0; i < part->dirty_rect_size(); ++i)
+            lossy_region_.addRect(VideoUtil::fromVideoRect(part->dirty_rect(i)));
+    }
+
+    if (!lossless_region.isEmpty())
+    {
+        FrameView lossless_frame(frame, lossless_region);
+        lossless_encoder_->encode(&lossless_frame, packet->add_part());
+
+        // The lossless encoder has sent these areas again.
+        lossy_region_.subtract(lossless_region);
+    }
+}
+
+void VideoEncoderHybrid::setPendingBytes(int64_t pending_bytes)
+{
+    lossy_encoder_->setPendingBytes(pending_bytes);
+}
+
+bool VideoEncoderHybrid::prepareRefresh(desktop::Region* region)
+{
+    if (lossy_region_.isEmpty())
+        return false;
+
+    region->addRegion(lossy_region_);
+    refresh_ = true;
+    return true;
+}
+
+} // namespace codec
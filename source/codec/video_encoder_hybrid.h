@@ -0,0 +1,71 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_ENCODER_HYBRID_H
+#define CODEC__VIDEO_ENCODER_HYBRID_H
+
+#include "codec/region_classifier.h"
+#include "codec/video_encoder.h"
+#include "desktop/pixel_format.h"
+
+#include <memory>
+
+namespace codec {
+
+class VideoEncoderVPX;
+class VideoEncoderZstd;
+
+// Encodes the areas of the screen which change often and have many colors with VP9 and the other
+// areas with Zstd. Each packet contains a part for each encoder which has something to send.
+class VideoEncoderHybrid : public VideoEncoder
+{
+public:
+    ~VideoEncoderHybrid();
+
+    // |target_format|, |compression_ratio| and |video_features| configure the Zstd encoder,
+    // |thread_count| and |quality| configure the VP9 encoder.
+    static VideoEncoderHybrid* create(const desktop::PixelFormat& target_format,
+                                      int compression_ratio,
+                                      uint32_t video_features,
+                                      uint32_t thread_count,
+                                      proto::desktop::VideoQuality quality);
+
+    void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
+    void setPendingBytes(int64_t pending_bytes) override;
+    bool prepareRefresh(desktop::Region* region) override;
+
+private:
+    VideoEncoderHybrid(VideoEncoderZstd* lossless_encoder, VideoEncoderVPX* lossy_encoder);
+
+    std::unique_ptr<VideoEncoderZstd> lossless_encoder_;
+    std::unique_ptr<VideoEncoderVPX> lossy_encoder_;
+
+    RegionClassifier classifier_;
+
+    // Areas which were sent by the lossy encoder since the last refresh.
+    desktop::Region lossy_region_;
+
+    // If true, the next frame is sent by the lossless encoder only.
+    bool refresh_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderHybrid);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_ENCODER_HYBRID_H
@@ -22,8 +22,14 @@
 #include "desktop/desktop_frame.h"
 
 #include <libyuv/convert.h>
+#include <libyuv/convert_argb.h>
 #include <libyuv/convert_from_argb.h>
 
+#if defined(USE_TBB)
+#include <tbb/parallel_for.h>
+#endif // defined(USE_TBB)
+
+#include <algorithm>
 #include <thread>
 
 namespace codec {
@@ -33,13 +39,64 @@ namespace {
 // Defines the dimension of a macro block. This is used to compute the active map for the encoder.
 const int kMacroBlockSize = 16;
 
-// Magic encoder profile numbers for I444 input formats.
+// Magic encoder profile numbers for I420 and I444 input formats.
 const int kVp9I420ProfileNumber = 0;
+const int kVp9I444ProfileNumber = 1;
 
 // Magic encoder constant for adaptive quantization strategy.
 const int kVp9AqModeCyclicRefresh = 3;
 
-void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size& size)
+// Each encoder thread gets at least this number of pixels of the screen. More threads do not
+// speed up the encoding of smaller screens.
+const int kMinPixelsPerThread = 640 * 360;
+
+// Maximum number of threads used by libvpx.
+const int kMaxThreadCount = 16;
+
+// VP9 does not allow tiles narrower than 256 pixels.
+const int kMinTileWidth = 256;
+
+// Maximum log2 of the number of VP8 token partitions.
+const int kMaxTokenPartitions = 3;
+
+// Height of the slices in which the updated rectangles are converted to YUV. Must be even, the
+// chroma planes have half of the height.
+const int kConvertSliceHeight = 64;
+
+// The conversion is parallelized only if the updated area is not less than this number of
+// pixels.
+const int kMinParallelConvertArea = 256 * 256;
+
+int encoderThreadCount(uint32_t requested_thread_count, const desktop::Size& size)
+{
+    const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+
+    // Going to multiple threads on low end windows systems can really hurt performance.
+    // http://crbug.com/99179
+    if (cpu_count <= 2)
+        return 1;
+
+    if (requested_thread_count)
+        return std::clamp(static_cast<int>(requested_thread_count), 1, cpu_count);
+
+    const int size_limit = std::max(size.width() * size.height() / kMinPixelsPerThread, 1);
+    return std::min({ cpu_count, size_limit, kMaxThreadCount });
+}
+
+// Returns the smallest log2 value which is not less than |value|.
+int log2Ceil(int value)
+{
+    int result = 0;
+
+    while ((1 << result) < value)
+        ++result;
+
+    return result;
+}
+
+void setCommonCodecParameters(vpx_codec_enc_cfg_t* config,
+                              const desktop::Size& size,
+                              int thread_count)
 {
     // Use millisecond granularity time base.
     config->g_timebase.num = 1;
@@ -58,14 +115,20 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size&
     config->kf_min_dist = 10000;
     config->kf_max_dist = 10000;
 
-    // Using 2 threads gives a great boost in performance for most systems with
-    // adequate processing power. NB: Going to multiple threads on low end
-    // windows systems can really hurt performance.
-    // http://crbug.com/99179
-    config->g_threads = (std::thread::hardware_concurrency() > 2) ? 2 : 1;
+    config->g_threads = thread_count;
+}
+
+void setRateParameters(vpx_codec_enc_cfg_t* config, const VpxRateController::Settings& settings)
+{
+    config->rc_target_bitrate = settings.bitrate;
+
+    // Clamping the quantizer constrains the worst-case quality and CPU usage.
+    config->rc_min_quantizer = settings.min_quantizer;
+    config->rc_max_quantizer = settings.max_quantizer;
 }
 
 void createImage(const desktop::Size& size,
+                 bool i444,
                  std::unique_ptr<vpx_image_t>* out_image,
                  std::unique_ptr<uint8_t[]>* out_image_buffer)
 {
@@ -76,9 +139,19 @@ void createImage(const desktop::Size& size,
     image->d_w = image->w = size.width();
     image->d_h = image->h = size.height();
 
-    image->fmt = VPX_IMG_FMT_YV12;
-    image->x_chroma_shift = 1;
-    image->y_chroma_shift = 1;
+    if (i444)
+    {
+        // The chroma planes have the same size as the luma plane.
+        image->fmt = VPX_IMG_FMT_I444;
+        image->x_chroma_shift = 0;
+        image->y_chroma_shift = 0;
+    }
+    else
+    {
+        image->fmt = VPX_IMG_FMT_YV12;
+        image->x_chroma_shift = 1;
+        image->y_chroma_shift = 1;
+    }
 
     // libyuv's fast-path requires 16-byte aligned pointers and strides, so pad the Y, U and V
     // planes' strides to multiples of 16 bytes.
@@ -130,23 +203,140 @@ desktop::Rect alignRect(const desktop::Rect& rect)
     return desktop::Rect::makeLTRB(x, y, right, bottom);
 }
 
+void convertRectToI444(const desktop::Frame* frame,
+                       const desktop::Rect& rect,
+                       uint8_t* y_data, int y_stride,
+                       uint8_t* u_data, uint8_t* v_data, int uv_stride)
+{
+    const int bits_per_pixel = frame->format().bitsPerPixel();
+
+    if (bits_per_pixel == 32)
+    {
+        libyuv::ARGBToI444(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           y_data, y_stride,
+                           u_data, uv_stride,
+                           v_data, uv_stride,
+                           rect.width(),
+                           rect.height());
+    }
+    else if (bits_per_pixel == 16)
+    {
+        // libyuv has no direct conversion from RGB565 to I444. The rectangle is expanded to ARGB
+        // first.
+        const int argb_stride = rect.width() * 4;
+        std::unique_ptr<uint8_t[]> argb_buffer =
+            std::make_unique<uint8_t[]>(argb_stride * rect.height());
+
+        libyuv::RGB565ToARGB(frame->frameDataAtPos(rect.topLeft()),
+                             frame->stride(),
+                             argb_buffer.get(),
+                             argb_stride,
+                             rect.width(),
+                             rect.height());
+
+        libyuv::ARGBToI444(argb_buffer.get(),
+                           argb_stride,
+                           y_data, y_stride,
+                           u_data, uv_stride,
+                           v_data, uv_stride,
+                           rect.width(),
+                           rect.height());
+    }
+    else
+    {
+        NOTREACHED();
+    }
+}
+
+void convertRect(const desktop::Frame* frame, const desktop::Rect& rect, vpx_image_t* image)
+{
+    const int y_stride = image->stride[0];
+    const int uv_stride = image->stride[1];
+
+    const int y_offset = y_stride * rect.y() + rect.x();
+    const int uv_offset =
+        uv_stride * (rect.y() >> image->y_chroma_shift) + (rect.x() >> image->x_chroma_shift);
+
+    uint8_t* y_data = image->planes[0] + y_offset;
+    uint8_t* u_data = image->planes[1] + uv_offset;
+    uint8_t* v_data = image->planes[2] + uv_offset;
+
+    if (image->fmt == VPX_IMG_FMT_I444)
+    {
+        convertRectToI444(frame, rect, y_data, y_stride, u_data, v_data, uv_stride);
+        return;
+    }
+
+    const int bits_per_pixel = frame->format().bitsPerPixel();
+
+    if (bits_per_pixel == 32)
+    {
+        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           y_data, y_stride,
+                           u_data, uv_stride,
+                           v_data, uv_stride,
+                           rect.width(),
+                           rect.height());
+    }
+    else if (bits_per_pixel == 16)
+    {
+        libyuv::RGB565ToI420(frame->frameDataAtPos(rect.topLeft()),
+                             frame->stride(),
+                             y_data, y_stride,
+                             u_data, uv_stride,
+                             v_data, uv_stride,
+                             rect.width(),
+                             rect.height());
+    }
+    else
+    {
+        NOTREACHED();
+    }
+}
+
 } // namespace
 
 // static
-VideoEncoderVPX* VideoEncoderVPX::createVP8()
+VideoEncoderVPX* VideoEncoderVPX::createVP8(uint32_t thread_count,
+                                            proto::desktop::VideoQuality quality)
+{
+    return new VideoEncoderVPX(proto::desktop::VIDEO_ENCODING_VP8, thread_count, quality);
+}
+
+// static
+VideoEncoderVPX* VideoEncoderVPX::createVP9(uint32_t thread_count,
+                                            proto::desktop::VideoQuality quality)
+{
+    return new VideoEncoderVPX(proto::desktop::VIDEO_ENCODING_VP9, thread_count, quality);
+}
+
+// static
+VideoEncoderVPX* VideoEncoderVPX::createVP9I444(uint32_t thread_count,
+                                                proto::desktop::VideoQuality quality)
 {
-    return new VideoEncoderVPX(proto::desktop::VIDEO_ENCODING_VP8);
+    return new VideoEncoderVPX(proto::desktop::VIDEO_ENCODING_VP9_I444, thread_count, quality);
 }
 
 // static
-VideoEncoderVPX* VideoEncoderVPX::createVP9()
+VideoEncoderVPX* VideoEncoderVPX::createVP9Lossless(uint32_t thread_count)
 {
-    return new VideoEncoderVPX(proto::desktop::VIDEO_ENCODING_VP9);
+    return new VideoEncoderVPX(proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS, thread_count,
+                               proto::desktop::VIDEO_QUALITY_HIGH);
 }
 
-VideoEncoderVPX::VideoEncoderVPX(proto::desktop::VideoEncoding encoding)
-    : encoding_(encoding)
+VideoEncoderVPX::VideoEncoderVPX(proto::desktop::VideoEncoding encoding,
+                                 uint32_t thread_count,
+                                 proto::desktop::VideoQuality quality)
+    : encoding_(encoding),
+      lossless_(encoding == proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS),
+      i444_(encoding == proto::desktop::VIDEO_ENCODING_VP9_I444 ||
+            encoding == proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS),
+      requested_thread_count_(thread_count),
+      quality_(quality)
 {
+    memset(&config_, 0, sizeof(config_));
     memset(&active_map_, 0, sizeof(active_map_));
     memset(&image_, 0, sizeof(image_));
 }
@@ -166,29 +356,22 @@ void VideoEncoderVPX::createVp8Codec(const desktop::Size& size)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
-    vpx_codec_enc_cfg_t config = { 0 };
-
     // Configure the encoder.
     vpx_codec_iface_t* algo = vpx_codec_vp8_cx();
 
-    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config, 0);
+    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
-    // Adjust default target bit-rate to account for actual desktop size.
-    config.rc_target_bitrate = size.width() * size.height() *
-        config.rc_target_bitrate / config.g_w / config.g_h;
+    const int thread_count = encoderThreadCount(requested_thread_count_, size);
 
-    setCommonCodecParameters(&config, size);
+    setCommonCodecParameters(&config_, size, thread_count);
+    setRateParameters(&config_, settings_);
 
     // Value of 2 means using the real time profile. This is basically a redundant option since we
     // explicitly select real time mode when doing encoding.
-    config.g_profile = 2;
-
-    // Clamping the quantizer constrains the worst-case quality and CPU usage.
-    config.rc_min_quantizer = 20;
-    config.rc_max_quantizer = 30;
+    config_.g_profile = 2;
 
-    ret = vpx_codec_enc_init(codec_.get(), algo, &config, 0);
+    ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Value of 16 will have the smallest CPU load. This turns off subpixel motion search.
@@ -202,38 +385,54 @@ void VideoEncoderVPX::createVp8Codec(const desktop::Size& size)
     // inter-prediction mode.
     ret = vpx_codec_control(codec_.get(), VP8E_SET_NOISE_SENSITIVITY, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    // The threads of VP8 encoder work on separate token partitions.
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_TOKEN_PARTITIONS,
+                            std::min(log2Ceil(thread_count), kMaxTokenPartitions));
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    LOG(LS_INFO) << "VP8 encoder threads: " << thread_count;
 }
 
 void VideoEncoderVPX::createVp9Codec(const desktop::Size& size)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
-    vpx_codec_enc_cfg_t config = { 0 };
-
     // Configure the encoder.
     vpx_codec_iface_t* algo = vpx_codec_vp9_cx();
 
-    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config, 0);
+    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
-    setCommonCodecParameters(&config, size);
+    const int thread_count = encoderThreadCount(requested_thread_count_, size);
+
+    setCommonCodecParameters(&config_, size, thread_count);
 
-    // Configure VP9 for I420 source frames.
-    config.g_profile = kVp9I420ProfileNumber;
-    config.rc_min_quantizer = 20;
-    config.rc_max_quantizer = 30;
-    config.rc_end_usage = VPX_CBR;
+    // Configure VP9 for I420 or I444 source frames.
+    config_.g_profile = i444_ ? kVp9I444ProfileNumber : kVp9I420ProfileNumber;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config.rc_target_bitrate = 500;
+    if (lossless_)
+    {
+        // The quantizer must be zero in the lossless mode. The bitrate is not limited.
+        config_.rc_min_quantizer = 0;
+        config_.rc_max_quantizer = 0;
+        config_.rc_end_usage = VPX_VBR;
+    }
+    else
+    {
+        setRateParameters(&config_, settings_);
+        config_.rc_end_usage = VPX_CBR;
+    }
 
-    ret = vpx_codec_enc_init(codec_.get(), algo, &config, 0);
+    ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Request the lowest-CPU usage that VP9 supports, which depends on whether we are encoding
     // lossy or lossless.
-    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, 6);
+    ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, lossless_ ? 5 : 6);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_LOSSLESS, lossless_ ? 1 : 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     ret = vpx_codec_control(codec_.get(), VP9E_SET_TUNE_CONTENT, VP9E_CONTENT_SCREEN);
@@ -245,8 +444,24 @@ void VideoEncoderVPX::createVp9Codec(const desktop::Size& size)
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Set cyclic refresh (aka "top-off") only for lossy encoding.
-    ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE, kVp9AqModeCyclicRefresh);
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE,
+                            lossless_ ? 0 : kVp9AqModeCyclicRefresh);
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    // Tile columns are encoded in parallel. The value is log2 of the number of columns.
+    const int tile_columns = std::min(log2Ceil(thread_count),
+                                      log2Ceil(size.width() / kMinTileWidth + 1) - 1);
+
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS, std::max(tile_columns, 0));
+    DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    // Row based multi-threading lets more threads work inside the tiles.
+    ret = vpx_codec_control(codec_.get(), VP9E_SET_ROW_MT, thread_count > 1 ? 1 : 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    LOG(LS_INFO) << "VP9 encoder threads: " << thread_count
+                 << " (tile columns: " << (1 << std::max(tile_columns, 0))
+                 << ", I444: " << i444_ << ", lossless: " << lossless_ << ")";
 }
 
 void VideoEncoderVPX::setActiveMap(const desktop::Rect& rect)
@@ -272,7 +487,7 @@ void VideoEncoderVPX::setActiveMap(const desktop::Rect& rect)
 void VideoEncoderVPX::prepareImageAndActiveMap(
     const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
 {
-    const int padding = ((encoding_ == proto::desktop::VIDEO_ENCODING_VP9) ? 8 : 3);
+    const int padding = ((encoding_ != proto::desktop::VIDEO_ENCODING_VP8) ? 8 : 3);
     desktop::Region updated_region;
 
     for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
@@ -297,49 +512,40 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
 
     memset(active_map_.active_map, 0, active_map_size_);
 
-    const int y_stride = image_->stride[0];
-    const int uv_stride = image_->stride[1];
-    uint8_t* y_data = image_->planes[0];
-    uint8_t* u_data = image_->planes[1];
-    uint8_t* v_data = image_->planes[2];
-
-    const int bits_per_pixel = frame->format().bitsPerPixel();
+    slices_.clear();
+    int updated_area = 0;
 
     for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
     {
         const desktop::Rect& rect = it.rect();
 
-        const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
-
-        if (bits_per_pixel == 32)
-        {
-            libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               y_data + y_offset, y_stride,
-                               u_data + uv_offset, uv_stride,
-                               v_data + uv_offset, uv_stride,
-                               rect.width(),
-                               rect.height());
-        }
-        else if (bits_per_pixel == 16)
-        {
-            libyuv::RGB565ToI420(frame->frameDataAtPos(rect.topLeft()),
-                                 frame->stride(),
-                                 y_data + y_offset, y_stride,
-                                 u_data + uv_offset, uv_stride,
-                                 v_data + uv_offset, uv_stride,
-                                 rect.width(),
-                                 rect.height());
-        }
-        else
+        // The rectangles are aligned to even coordinates, so each slice starts on an even row and
+        // the slices do not share the rows of the chroma planes.
+        for (int y = rect.top(); y < rect.bottom(); y += kConvertSliceHeight)
         {
-            NOTREACHED();
+            slices_.emplace_back(desktop::Rect::makeLTRB(
+                rect.left(), y, rect.right(), std::min(y + kConvertSliceHeight, rect.bottom())));
         }
 
+        updated_area += rect.width() * rect.height();
+
         VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
         setActiveMap(rect);
     }
+
+#if defined(USE_TBB)
+    if (updated_area >= kMinParallelConvertArea)
+    {
+        tbb::parallel_for(size_t(0), slices_.size(), [&](size_t index)
+        {
+            convertRect(frame, slices_[index], image_.get());
+        });
+        return;
+    }
+#endif // defined(USE_TBB)
+
+    for (const auto& slice : slices_)
+        convertRect(frame, slice, image_.get());
 }
 
 void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
@@ -350,24 +556,57 @@ void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::desktop::VideoP
     {
         const desktop::Size& screen_size = frame->size();
 
-        createImage(screen_size, &image_, &image_buffer_);
+        createImage(screen_size, i444_, &image_, &image_buffer_);
         createActiveMap(screen_size);
 
+        rate_controller_ = std::make_unique<VpxRateController>(
+            quality_, screen_size, VpxRateController::Clock::now());
+        settings_ = rate_controller_->settings();
+
+        // The whole screen is sent with the first frame.
+        lossy_region_.clear();
+        refresh_ = false;
+
         if (encoding_ == proto::desktop::VIDEO_ENCODING_VP8)
         {
             createVp8Codec(screen_size);
         }
         else
         {
-            DCHECK_EQ(encoding_, proto::desktop::VIDEO_ENCODING_VP9);
             createVp9Codec(screen_size);
         }
     }
 
+    // The lossless encoder does not need the rate control and the refresh of a static screen.
+    if (!lossless_)
+    {
+        rate_controller_->setPendingBytes(pending_bytes_);
+
+        if (refresh_)
+        {
+            applySettings(rate_controller_->refreshSettings());
+        }
+        else
+        {
+            rate_controller_->update(VpxRateController::Clock::now());
+            applySettings(rate_controller_->settings());
+        }
+    }
+
     // Convert the updated capture data ready for encode.
     // Update active map based on updated region.
     prepareImageAndActiveMap(frame, packet);
 
+    if (refresh_)
+    {
+        lossy_region_.clear();
+        refresh_ = false;
+    }
+    else if (!lossless_)
+    {
+        lossy_region_.addRegion(frame->constUpdatedRegion());
+    }
+
     // Apply active map to the encoder.
     vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
     DCHECK_EQ(ret, VPX_CODEC_OK);
@@ -388,9 +627,38 @@ void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::desktop::VideoP
         if (pkt->kind == VPX_CODEC_CX_FRAME_PKT)
         {
             packet->set_data(pkt->data.frame.buf, pkt->data.frame.sz);
+            rate_controller_->onPacketEncoded(pkt->data.frame.sz);
             break;
         }
     }
 }
 
+void VideoEncoderVPX::setPendingBytes(int64_t pending_bytes)
+{
+    pending_bytes_ = pending_bytes;
+}
+
+bool VideoEncoderVPX::prepareRefresh(desktop::Region* region)
+{
+    if (lossy_region_.isEmpty())
+        return false;
+
+    region->addRegion(lossy_region_);
+    refresh_ = true;
+    return true;
+}
+
+void VideoEncoderVPX::applySettings(const VpxRateController::Settings& settings)
+{
+    if (settings == settings_)
+        return;
+
+    setRateParameters(&config_, settings);
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    DCHECK_EQ(ret, VPX_CODEC_OK);
+
+    settings_ = settings;
+}
+
 } // namespace codec
@@ -22,11 +22,15 @@
 #include "base/macros_magic.h"
 #include "codec/scoped_vpx_codec.h"
 #include "codec/video_encoder.h"
+#include "codec/vpx_rate_controller.h"
+#include "desktop/desktop_region.h"
 
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
 
+#include <vector>
+
 namespace codec {
 
 class VideoEncoderVPX : public VideoEncoder
@@ -34,13 +38,28 @@ class VideoEncoderVPX : public VideoEncoder
 public:
     ~VideoEncoderVPX() = default;
 
-    static VideoEncoderVPX* createVP8();
-    static VideoEncoderVPX* createVP9();
+    // |thread_count| limits the number of threads of the encoder. If 0, then the number is
+    // chosen automatically. |quality| selects the limits of the bitrate and the quantizer.
+    static VideoEncoderVPX* createVP8(uint32_t thread_count,
+                                      proto::desktop::VideoQuality quality);
+    static VideoEncoderVPX* createVP9(uint32_t thread_count,
+                                      proto::desktop::VideoQuality quality);
+
+    // VP9 profile 1 with full chroma resolution. The colored text stays sharp.
+    static VideoEncoderVPX* createVP9I444(uint32_t thread_count,
+                                          proto::desktop::VideoQuality quality);
+
+    // Lossless VP9 profile 1. The bitrate and the quantizer are not controlled.
+    static VideoEncoderVPX* createVP9Lossless(uint32_t thread_count);
 
     void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
+    void setPendingBytes(int64_t pending_bytes) override;
+    bool prepareRefresh(desktop::Region* region) override;
 
 private:
-    VideoEncoderVPX(proto::desktop::VideoEncoding encoding);
+    VideoEncoderVPX(proto::desktop::VideoEncoding encoding,
+                    uint32_t thread_count,
+                    proto::desktop::VideoQuality quality);
 
     void createActiveMap(const desktop::Size& size);
     void createVp8Codec(const desktop::Size& size);
@@ -48,9 +67,27 @@ private:
     void prepareImageAndActiveMap(const desktop::Frame* frame, proto::desktop::VideoPacket* packet);
     void setActiveMap(const desktop::Rect& rect);
 
+    // Reconfigures the encoder if |settings| differ from the current ones.
+    void applySettings(const VpxRateController::Settings& settings);
+
     const proto::desktop::VideoEncoding encoding_;
+    const bool lossless_;
+    const bool i444_;
+    const uint32_t requested_thread_count_;
+    const proto::desktop::VideoQuality quality_;
 
     ScopedVpxCodec codec_ = nullptr;
+    vpx_codec_enc_cfg_t config_;
+
+    std::unique_ptr<VpxRateController> rate_controller_;
+    VpxRateController::Settings settings_;
+    int64_t pending_bytes_ = 0;
+
+    // Areas which were encoded with reduced quality since the last refresh.
+    desktop::Region lossy_region_;
+
+    // If true, the next frame is encoded with the refresh settings.
+    bool refresh_ = false;
 
     size_t active_map_size_ = 0;
 
@@ -61,6 +98,9 @@ private:
     std::unique_ptr<vpx_image_t> image_;
     std::unique_ptr<uint8_t[]> image_buffer_;
 
+    // Parts of the updated rectangles which are converted to YUV in parallel.
+    std::vector<desktop::Rect> slices_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderVPX);
 };
 
@@ -22,68 +22,259 @@
 #include "codec/video_util.h"
 #include "desktop/desktop_frame.h"
 
+#if defined(USE_TBB)
+#include <tbb/parallel_for.h>
+#endif // defined(USE_TBB)
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 namespace codec {
 
 namespace {
 
-// Retrieves a pointer to the output buffer in |update| used for storing the
-// encoded rectangle data. Will resize the buffer to |size|.
-uint8_t* outputBuffer(proto::desktop::VideoPacket* packet, size_t size)
+// Maximum width and height of a tile.
+const int kTileSize = 256;
+
+// Tiles are used only if the updated area is not less than this number of pixels. Small updates
+// are compressed faster in one frame.
+const int kMinTiledArea = kTileSize * kTileSize * 4;
+
+// Size of the window (log2) of the continuous stream. The window keeps the data of the previous
+// frames which the compressor can refer to. Must not exceed the default limit of the decoder (27).
+const int kStreamWindowLog = 25;
+
+// Passes |input_size| bytes of |input_data| to |stream| with the |directive|. The compressed data
+// is written to |output| which points to |buffer|. The buffer grows if it is not enough.
+bool compressData(ZSTD_CStream* stream,
+                  ZSTD_EndDirective directive,
+                  const uint8_t* input_data,
+                  size_t input_size,
+                  std::string* buffer,
+                  ZSTD_outBuffer* output)
+{
+    ZSTD_inBuffer input = { input_data, input_size, 0 };
+
+    for (;;)
+    {
+        size_t ret = ZSTD_compressStream2(stream, output, &input, directive);
+        if (ZSTD_isError(ret))
+        {
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            return false;
+        }
+
+        // When the frame is ended or flushed, the stream returns the number of bytes it still
+        // has to write.
+        if (directive == ZSTD_e_continue ? input.pos == input.size : !ret)
+            return true;
+
+        if (output->pos == output->size)
+        {
+            buffer->resize(buffer->size() + buffer->size() / 2 + 1);
+            output->dst = buffer->data();
+            output->size = buffer->size();
+        }
+    }
+}
+
+// Passes the pixels of |rect| to |stream| in the target pixel format. If |translator| is null,
+// then the frame already has the target format and its rows are passed without copying.
+// Otherwise, the rectangle is translated to |translate_buffer| first.
+bool compressRect(ZSTD_CStream* stream,
+                  PixelTranslator* translator,
+                  const desktop::PixelFormat& target_format,
+                  const desktop::Frame* frame,
+                  const desktop::Rect& rect,
+                  std::unique_ptr<uint8_t[], base::AlignedFreeDeleter>* translate_buffer,
+                  size_t* translate_buffer_size,
+                  std::string* buffer,
+                  ZSTD_outBuffer* output)
+{
+    const int stride = rect.width() * target_format.bytesPerPixel();
+
+    if (!translator)
+    {
+        for (int y = rect.top(); y < rect.bottom(); ++y)
+        {
+            if (!compressData(stream, ZSTD_e_continue, frame->frameDataAtPos(rect.left(), y),
+                              stride, buffer, output))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const size_t data_size = stride * rect.height();
+
+    if (*translate_buffer_size < data_size)
+    {
+        translate_buffer->reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
+        *translate_buffer_size = data_size;
+    }
+
+    translator->translate(frame->frameDataAtPos(rect.topLeft()),
+                          frame->stride(),
+                          translate_buffer->get(),
+                          stride,
+                          rect.width(),
+                          rect.height());
+
+    return compressData(stream, ZSTD_e_continue, translate_buffer->get(), data_size,
+                        buffer, output);
+}
+
+size_t tileThreadCount()
 {
-    packet->mutable_data()->resize(size);
-    return reinterpret_cast<uint8_t*>(packet->mutable_data()->data());
+#if defined(USE_TBB)
+    return std::max(std::thread::hardware_concurrency(), 1U);
+#else // defined(USE_TBB)
+    return 1;
+#endif // defined(USE_*)
 }
 
 } // namespace
 
+struct VideoEncoderZstd::TileContext
+{
+    ScopedZstdCStream stream { ZSTD_createCStream() };
+    std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer;
+    size_t translate_buffer_size = 0;
+};
+
 VideoEncoderZstd::VideoEncoderZstd(const desktop::PixelFormat& target_format,
-                                   int compression_ratio)
+                                   int compression_ratio,
+                                   uint32_t video_features)
     : target_format_(target_format),
       compress_ratio_(compression_ratio),
       stream_(ZSTD_createCStream())
 {
-    // Nothing
+    if (video_features & proto::desktop::VIDEO_FEATURE_ZSTD_CONTEXT)
+    {
+        continuous_stream_ = true;
+
+        ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_compressionLevel, compress_ratio_);
+        ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_windowLog, kStreamWindowLog);
+    }
+
+    if (video_features & proto::desktop::VIDEO_FEATURE_ZSTD_TILES)
+    {
+        const size_t thread_count = tileThreadCount();
+
+        for (size_t i = 0; i < thread_count; ++i)
+            tile_contexts_.emplace_back(std::make_unique<TileContext>());
+    }
 }
 
+VideoEncoderZstd::~VideoEncoderZstd() = default;
+
 // static
 VideoEncoderZstd* VideoEncoderZstd::create(const desktop::PixelFormat& target_format,
-                                           int compression_ratio)
+                                           int compression_ratio,
+                                           uint32_t video_features)
 {
     if (compression_ratio > ZSTD_maxCLevel())
         compression_ratio = ZSTD_maxCLevel();
     else if (compression_ratio < 1)
         compression_ratio = 1;
 
-    return new VideoEncoderZstd(target_format, compression_ratio);
+    return new VideoEncoderZstd(target_format, compression_ratio, video_features);
 }
 
-void VideoEncoderZstd::compressPacket(proto::desktop::VideoPacket* packet,
-                                      const uint8_t* input_data,
-                                      size_t input_size)
+void VideoEncoderZstd::encodeTiles(const desktop::Frame* frame,
+                                   proto::desktop::VideoPacket* packet)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    tiles_.clear();
 
-    const size_t output_size = ZSTD_compressBound(input_size);
-    uint8_t* output_data = outputBuffer(packet, output_size);
+    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
 
-    ZSTD_inBuffer input = { input_data, input_size, 0 };
-    ZSTD_outBuffer output = { output_data, output_size, 0 };
+        for (int y = rect.top(); y < rect.bottom(); y += kTileSize)
+        {
+            for (int x = rect.left(); x < rect.right(); x += kTileSize)
+            {
+                desktop::Rect tile = desktop::Rect::makeLTRB(
+                    x, y,
+                    std::min(x + kTileSize, rect.right()),
+                    std::min(y + kTileSize, rect.bottom()));
+
+                tiles_.emplace_back(tile);
+            }
+        }
+    }
 
-    while (input.pos < input.size)
+    const size_t tile_count = tiles_.size();
+
+    if (tile_data_.size() < tile_count)
+        tile_data_.resize(tile_count);
+
+    std::atomic_size_t next_tile = 0;
+    std::atomic_bool has_error = false;
+
+    // Each thread takes the next uncompressed tile until all tiles are compressed.
+    auto compress_tiles = [&](TileContext* context)
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
-        if (ZSTD_isError(ret))
+        for (size_t index = next_tile++; index < tile_count; index = next_tile++)
         {
-            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
-            return;
+            const desktop::Rect& tile = tiles_[index];
+            const size_t tile_size =
+                tile.width() * tile.height() * target_format_.bytesPerPixel();
+
+            size_t ret = ZSTD_initCStream(context->stream.get(), compress_ratio_);
+            DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+            std::string* buffer = &tile_data_[index];
+            buffer->resize(ZSTD_compressBound(tile_size));
+
+            ZSTD_outBuffer output = { buffer->data(), buffer->size(), 0 };
+
+            if (!compressRect(context->stream.get(), translator_.get(), target_format_, frame,
+                              tile, &context->translate_buffer, &context->translate_buffer_size,
+                              buffer, &output) ||
+                !compressData(context->stream.get(), ZSTD_e_end, nullptr, 0, buffer, &output))
+            {
+                has_error = true;
+            }
+
+            buffer->resize(output.pos);
         }
+    };
+
+#if defined(USE_TBB)
+    tbb::parallel_for(size_t(0), tile_contexts_.size(), [&](size_t thread_index)
+    {
+        compress_tiles(tile_contexts_[thread_index].get());
+    });
+#else // defined(USE_TBB)
+    compress_tiles(tile_contexts_.front().get());
+#endif // defined(USE_*)
+
+    // The rectangles are added only with the data of all the tiles. The client rejects a packet
+    // without it.
+    if (has_error)
+    {
+        LOG(LS_WARNING) << "Unable to compress tiles";
+        return;
     }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    size_t data_size = 0;
+    for (size_t i = 0; i < tile_count; ++i)
+        data_size += tile_data_[i].size();
+
+    std::string* data = packet->mutable_data();
+    data->clear();
+    data->reserve(data_size);
 
-    packet->mutable_data()->resize(output.pos);
+    for (size_t i = 0; i < tile_count; ++i)
+    {
+        VideoUtil::toVideoRect(tiles_[i], packet->add_dirty_rect());
+        data->append(tile_data_[i]);
+        packet->add_tile_size(static_cast<uint32_t>(tile_data_[i].size()));
+    }
 }
 
 void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet)
@@ -96,7 +287,12 @@ void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::Video
             target_format_, packet->mutable_format()->mutable_pixel_format());
     }
 
-    if (!translator_)
+    if (frame->format() == target_format_)
+    {
+        // The rows of the frame are compressed without translation.
+        translator_.reset();
+    }
+    else if (!translator_)
     {
         translator_ = PixelTranslator::create(frame->format(), target_format_);
         if (!translator_)
@@ -106,6 +302,28 @@ void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::Video
         }
     }
 
+    // The continuous stream is restarted when the screen format changes. The decoder does the same
+    // for both tiled and non-tiled packets.
+    if (continuous_stream_ && packet->has_format())
+    {
+        ZSTD_CCtx_reset(stream_.get(), ZSTD_reset_session_only);
+        restart_stream_ = false;
+    }
+
+    if (!tile_contexts_.empty())
+    {
+        int updated_area = 0;
+
+        for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+            updated_area += it.rect().width() * it.rect().height();
+
+        if (updated_area >= kMinTiledArea)
+        {
+            encodeTiles(frame, packet);
+            return;
+        }
+    }
+
     size_t data_size = 0;
 
     for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
@@ -116,31 +334,64 @@ void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::desktop::Video
         VideoUtil::toVideoRect(rect, packet->add_dirty_rect());
     }
 
-    if (translate_buffer_size_ < data_size)
+    ZSTD_EndDirective end_directive = ZSTD_e_end;
+
+    if (!continuous_stream_)
     {
-        translate_buffer_.reset(static_cast<uint8_t*>(base::alignedAlloc(data_size, 32)));
-        translate_buffer_size_ = data_size;
+        size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
     }
+    else if (restart_stream_)
+    {
+        // The stream was reset after an error. The packet is not marked as continuous, so the
+        // decoder also starts a new stream with it.
+        restart_stream_ = false;
+    }
+    else
+    {
+        packet->set_continuous_stream(true);
+
+        // The frame is never ended. We only flush the data so that the decoder can decompress
+        // the packet completely while keeping the window of the previous packets.
+        end_directive = ZSTD_e_flush;
+    }
+
+    std::string* buffer = packet->mutable_data();
+    buffer->resize(ZSTD_compressBound(data_size));
 
-    uint8_t* translate_pos = translate_buffer_.get();
+    ZSTD_outBuffer output = { buffer->data(), buffer->size(), 0 };
 
     for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
     {
-        const desktop::Rect& rect = it.rect();
-        const int stride = rect.width() * target_format_.bytesPerPixel();
-
-        translator_->translate(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               translate_pos,
-                               stride,
-                               rect.width(),
-                               rect.height());
+        if (!compressRect(stream_.get(), translator_.get(), target_format_, frame, it.rect(),
+                          &translate_buffer_, &translate_buffer_size_, buffer, &output))
+        {
+            discardPacket(packet);
+            return;
+        }
+    }
 
-        translate_pos += rect.height() * stride;
+    if (!compressData(stream_.get(), end_directive, nullptr, 0, buffer, &output))
+    {
+        discardPacket(packet);
+        return;
     }
 
-    // Compress data with using Zstd compressor.
-    compressPacket(packet, translate_buffer_.get(), data_size);
+    buffer->resize(output.pos);
+}
+
+void VideoEncoderZstd::discardPacket(proto::desktop::VideoPacket* packet)
+{
+    packet->clear_dirty_rect();
+    packet->clear_data();
+    packet->clear_continuous_stream();
+
+    // The stream may have stopped in the middle of a block.
+    if (continuous_stream_)
+    {
+        ZSTD_CCtx_reset(stream_.get(), ZSTD_reset_session_only);
+        restart_stream_ = true;
+    }
 }
 
 } // namespace codec
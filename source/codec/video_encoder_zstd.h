@@ -22,8 +22,11 @@
 #include "base/aligned_memory.h"
 #include "codec/scoped_zstd_stream.h"
 #include "codec/video_encoder.h"
+#include "desktop/desktop_geometry.h"
 #include "desktop/pixel_format.h"
 
+#include <vector>
+
 namespace codec {
 
 class PixelTranslator;
@@ -31,27 +34,54 @@ class PixelTranslator;
 class VideoEncoderZstd : public VideoEncoder
 {
 public:
-    ~VideoEncoderZstd() = default;
+    ~VideoEncoderZstd();
 
-    static VideoEncoderZstd* create(
-        const desktop::PixelFormat& target_format, int compression_ratio);
+    // |video_features| contains a set of flags from proto::desktop::VideoFeatures enabled for
+    // the session.
+    static VideoEncoderZstd* create(const desktop::PixelFormat& target_format,
+                                    int compression_ratio,
+                                    uint32_t video_features);
 
     void encode(const desktop::Frame* frame, proto::desktop::VideoPacket* packet) override;
 
 private:
-    VideoEncoderZstd(const desktop::PixelFormat& target_format, int compression_ratio);
-    void compressPacket(proto::desktop::VideoPacket* packet,
-                        const uint8_t* input_data,
-                        size_t input_size);
+    struct TileContext;
+
+    VideoEncoderZstd(const desktop::PixelFormat& target_format,
+                     int compression_ratio,
+                     uint32_t video_features);
+
+    // Splits the updated region into tiles and compresses each of them into an independent Zstd
+    // frame. The tiles are compressed in parallel. Used for large updates only, the continuous
+    // stream is not affected by the tiled packets.
+    void encodeTiles(const desktop::Frame* frame, proto::desktop::VideoPacket* packet);
+
+    // Removes the changes from |packet| after a compression error. The continuous stream is reset
+    // and the next packet starts it again.
+    void discardPacket(proto::desktop::VideoPacket* packet);
 
     // Client's pixel format
     desktop::PixelFormat target_format_;
     int compress_ratio_;
     ScopedZstdCStream stream_;
+
+    // If true, |stream_| is not restarted between packets and keeps the previous frames.
+    bool continuous_stream_ = false;
+
+    // If true, the next non-tiled packet is sent as a complete Zstd frame, so that the decoder
+    // restarts its stream too.
+    bool restart_stream_ = false;
+
+    // Null if the frames already have the target pixel format.
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<uint8_t[], base::AlignedFreeDeleter> translate_buffer_;
     size_t translate_buffer_size_ = 0;
 
+    // Contexts of the threads that compress the tiles. Empty if the tiles are disabled.
+    std::vector<std::unique_ptr<TileContext>> tile_contexts_;
+    std::vector<desktop::Rect> tiles_;
+    std::vector<std::string> tile_data_;
+
     DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstd);
 };
 
@@ -0,0 +1,180 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/vpx_rate_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace codec {
+
+namespace {
+
+// The bitrate is never reduced below this value (kilobits per second).
+const int kMinBitrate = 100;
+
+// The bitrate is changed not more often than once per period.
+const std::chrono::milliseconds kMeasurementPeriod(500);
+
+// The bitrate grows by this factor per period while the channel keeps up.
+const double kIncreaseFactor = 1.2;
+
+// When the channel queue grows, the bitrate is reduced to this fraction of the measured
+// throughput.
+const double kDecreaseFactor = 0.8;
+
+// The bitrate grows only if the encoder has produced at least this fraction of the target
+// bitrate. Otherwise the screen changes too little to tell whether the channel can take more.
+const double kMinBudgetUsage = 0.5;
+
+// If the channel has less than this fraction of the high limit of the queue, the bitrate can
+// grow.
+const int64_t kLowPendingBytesDivider = 8;
+
+} // namespace
+
+bool VpxRateController::Settings::operator==(const Settings& other) const
+{
+    return bitrate == other.bitrate &&
+           min_quantizer == other.min_quantizer &&
+           max_quantizer == other.max_quantizer;
+}
+
+bool VpxRateController::Settings::operator!=(const Settings& other) const
+{
+    return !(*this == other);
+}
+
+VpxRateController::VpxRateController(proto::desktop::VideoQuality quality,
+                                     const desktop::Size& screen_size,
+                                     const Clock::time_point& time)
+    : profile_(profileFor(quality)),
+      min_bitrate_(kMinBitrate),
+      max_bitrate_(std::max(static_cast<int>(
+          static_cast<int64_t>(screen_size.width()) * screen_size.height() *
+          profile_.max_bitrate_per_megapixel / (1000 * 1000)), kMinBitrate)),
+      period_start_(time)
+{
+    // Start from a quarter of the limit. The first periods adjust it to the channel.
+    settings_.bitrate = std::max(max_bitrate_ / 4, min_bitrate_);
+    settings_.min_quantizer = profile_.min_quantizer;
+    settings_.max_quantizer = maxQuantizerFor(settings_.bitrate);
+}
+
+void VpxRateController::onPacketEncoded(size_t packet_size)
+{
+    period_encoded_bytes_ += static_cast<int64_t>(packet_size);
+}
+
+void VpxRateController::setPendingBytes(int64_t pending_bytes)
+{
+    pending_bytes_ = std::max(pending_bytes, int64_t(0));
+}
+
+bool VpxRateController::update(const Clock::time_point& time)
+{
+    const int64_t period_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(time - period_start_).count();
+
+    if (period_ms < kMeasurementPeriod.count())
+        return false;
+
+    // Bits per millisecond are kilobits per second.
+    const int64_t sent_bytes = std::max(
+        period_encoded_bytes_ + period_start_pending_bytes_ - pending_bytes_, int64_t(0));
+    const int64_t throughput = sent_bytes * 8 / period_ms;
+    const int64_t encoded_bitrate = period_encoded_bytes_ * 8 / period_ms;
+
+    const Settings previous_settings = settings_;
+    int bitrate = settings_.bitrate;
+
+    if (pending_bytes_ > profile_.high_pending_bytes)
+    {
+        // The channel does not keep up with the encoder. If nothing was sent during the period,
+        // the throughput is unknown and the bitrate is halved.
+        if (throughput > 0)
+            bitrate = static_cast<int>(std::min<int64_t>(bitrate, throughput) * kDecreaseFactor);
+        else
+            bitrate /= 2;
+    }
+    else if (pending_bytes_ < profile_.high_pending_bytes / kLowPendingBytesDivider &&
+             encoded_bitrate >= bitrate * kMinBudgetUsage)
+    {
+        bitrate = static_cast<int>(bitrate * kIncreaseFactor);
+    }
+
+    settings_.bitrate = std::clamp(bitrate, min_bitrate_, max_bitrate_);
+    settings_.max_quantizer = maxQuantizerFor(settings_.bitrate);
+
+    period_start_ = time;
+    period_encoded_bytes_ = 0;
+    period_start_pending_bytes_ = pending_bytes_;
+
+    return settings_ != previous_settings;
+}
+
+VpxRateController::Settings VpxRateController::refreshSettings() const
+{
+    Settings settings;
+
+    // The quantizer is fixed, the bitrate does not limit the quality of the refresh.
+    settings.bitrate = max_bitrate_;
+    settings.min_quantizer = profile_.refresh_quantizer;
+    settings.max_quantizer = profile_.refresh_quantizer;
+
+    return settings;
+}
+
+// static
+const VpxRateController::Profile& VpxRateController::profileFor(
+    proto::desktop::VideoQuality quality)
+{
+    // Quantizers are in the range of libvpx configuration (0-63).
+    static const Profile kBalanced = { 4000, 4, 30, 52, 4, 1024 * 1024 };
+    static const Profile kLowLatency = { 2000, 10, 40, 56, 8, 256 * 1024 };
+    static const Profile kHigh = { 8000, 2, 20, 40, 0, 4 * 1024 * 1024 };
+
+    switch (quality)
+    {
+        case proto::desktop::VIDEO_QUALITY_LOW_LATENCY:
+            return kLowLatency;
+
+        case proto::desktop::VIDEO_QUALITY_HIGH:
+            return kHigh;
+
+        default:
+            return kBalanced;
+    }
+}
+
+int VpxRateController::maxQuantizerFor(int bitrate) const
+{
+    if (max_bitrate_ <= min_bitrate_)
+        return profile_.best_max_quantizer;
+
+    // The position of the bitrate between the limits on a logarithmic scale.
+    const double position = std::log(static_cast<double>(bitrate) / min_bitrate_) /
+        std::log(static_cast<double>(max_bitrate_) / min_bitrate_);
+
+    const int range = profile_.worst_max_quantizer - profile_.best_max_quantizer;
+
+    return profile_.worst_max_quantizer -
+        static_cast<int>(std::lround(range * std::clamp(position, 0.0, 1.0)));
+}
+
+} // namespace codec
@@ -0,0 +1,115 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VPX_RATE_CONTROLLER_H
+#define CODEC__VPX_RATE_CONTROLLER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+
+namespace codec {
+
+// Chooses the target bitrate and the quantizer range of the VP8/VP9 encoder. The bandwidth of the
+// channel is estimated from the size of the encoded packets and the number of bytes waiting to be
+// sent. While the queue of the channel grows, the bitrate is reduced to the measured throughput.
+// When the queue is empty and the encoder uses its budget, the bitrate grows up to the limit of
+// the quality profile.
+class VpxRateController
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    VpxRateController(proto::desktop::VideoQuality quality,
+                      const desktop::Size& screen_size,
+                      const Clock::time_point& time);
+    ~VpxRateController() = default;
+
+    struct Settings
+    {
+        // Target bitrate in kilobits per second.
+        int bitrate = 0;
+
+        int min_quantizer = 0;
+        int max_quantizer = 0;
+
+        bool operator==(const Settings& other) const;
+        bool operator!=(const Settings& other) const;
+    };
+
+    // Called after each encoded packet.
+    void onPacketEncoded(size_t packet_size);
+
+    // Sets the number of bytes which are waiting to be sent to the client.
+    void setPendingBytes(int64_t pending_bytes);
+
+    // Updates the settings if the measurement period has passed. Returns true if the settings
+    // have changed.
+    bool update(const Clock::time_point& time);
+
+    const Settings& settings() const { return settings_; }
+
+    // Settings for encoding the areas of a static screen again in the best quality.
+    Settings refreshSettings() const;
+
+private:
+    struct Profile
+    {
+        // Maximum bitrate for one megapixel of the screen.
+        int max_bitrate_per_megapixel;
+
+        int min_quantizer;
+
+        // The maximum quantizer is chosen in this range depending on the bitrate.
+        int best_max_quantizer;
+        int worst_max_quantizer;
+
+        // Quantizer of the static screen refresh.
+        int refresh_quantizer;
+
+        // If the channel has more bytes in the queue, the bitrate is reduced.
+        int64_t high_pending_bytes;
+    };
+
+    static const Profile& profileFor(proto::desktop::VideoQuality quality);
+
+    int maxQuantizerFor(int bitrate) const;
+
+    const Profile& profile_;
+    const int min_bitrate_;
+    const int max_bitrate_;
+
+    Settings settings_;
+
+    // Start of the current measurement period.
+    Clock::time_point period_start_;
+
+    // Bytes encoded and bytes waiting in the channel queue since the start of the period.
+    int64_t period_encoded_bytes_ = 0;
+    int64_t period_start_pending_bytes_ = 0;
+
+    int64_t pending_bytes_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(VpxRateController);
+};
+
+} // namespace codec
+
+#endif // CODEC__VPX_RATE_CONTROLLER_H
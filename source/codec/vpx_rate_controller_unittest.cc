@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/vpx_rate_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace codec {
+
+namespace {
+
+const desktop::Size kScreenSize(1920, 1080);
+const std::chrono::milliseconds kPeriod(500);
+
+// Encodes |bitrate| kilobits per second during the period.
+size_t packetSizeFor(int bitrate)
+{
+    return static_cast<size_t>(bitrate) * kPeriod.count() / 8;
+}
+
+} // namespace
+
+TEST(vpx_rate_controller_test, grows_while_channel_keeps_up)
+{
+    VpxRateController::Clock::time_point time = VpxRateController::Clock::now();
+    VpxRateController controller(proto::desktop::VIDEO_QUALITY_BALANCED, kScreenSize, time);
+
+    const VpxRateController::Settings initial = controller.settings();
+
+    for (int i = 0; i < 50; ++i)
+    {
+        controller.onPacketEncoded(packetSizeFor(controller.settings().bitrate));
+        controller.setPendingBytes(0);
+
+        time += kPeriod;
+        controller.update(time);
+    }
+
+    const VpxRateController::Settings& settings = controller.settings();
+
+    EXPECT_GT(settings.bitrate, initial.bitrate);
+    EXPECT_LT(settings.max_quantizer, initial.max_quantizer);
+    EXPECT_GE(settings.max_quantizer, settings.min_quantizer);
+
+    // The bitrate stops at the limit of the profile.
+    controller.onPacketEncoded(packetSizeFor(settings.bitrate));
+    time += kPeriod;
+    EXPECT_FALSE(controller.update(time));
+}
+
+TEST(vpx_rate_controller_test, does_not_grow_on_static_screen)
+{
+    VpxRateController::Clock::time_point time = VpxRateController::Clock::now();
+    VpxRateController controller(proto::desktop::VIDEO_QUALITY_BALANCED, kScreenSize, time);
+
+    const int initial_bitrate = controller.settings().bitrate;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        controller.onPacketEncoded(100);
+
+        time += kPeriod;
+        EXPECT_FALSE(controller.update(time));
+    }
+
+    EXPECT_EQ(controller.settings().bitrate, initial_bitrate);
+}
+
+TEST(vpx_rate_controller_test, drops_to_throughput_when_queue_grows)
+{
+    VpxRateController::Clock::time_point time = VpxRateController::Clock::now();
+    VpxRateController controller(proto::desktop::VIDEO_QUALITY_BALANCED, kScreenSize, time);
+
+    const VpxRateController::Settings initial = controller.settings();
+    const int throughput = initial.bitrate / 4;
+
+    // The encoder produces the target bitrate, but the channel sends only a quarter of the
+    // initial bitrate.
+    int64_t pending_bytes = 0;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const size_t packet_size = packetSizeFor(controller.settings().bitrate);
+
+        pending_bytes += static_cast<int64_t>(packet_size) -
+                         static_cast<int64_t>(packetSizeFor(throughput));
+        ASSERT_GT(pending_bytes, 0);
+
+        controller.onPacketEncoded(packet_size);
+        controller.setPendingBytes(pending_bytes);
+
+        time += kPeriod;
+        controller.update(time);
+    }
+
+    const VpxRateController::Settings& settings = controller.settings();
+
+    EXPECT_LE(settings.bitrate, throughput);
+    EXPECT_GT(settings.max_quantizer, initial.max_quantizer);
+}
+
+TEST(vpx_rate_controller_test, waits_for_measurement_period)
+{
+    VpxRateController::Clock::time_point time = VpxRateController::Clock::now();
+    VpxRateController controller(proto::desktop::VIDEO_QUALITY_LOW_LATENCY, kScreenSize, time);
+
+    controller.onPacketEncoded(packetSizeFor(controller.settings().bitrate * 4));
+    EXPECT_FALSE(controller.update(time + kPeriod / 2));
+    EXPECT_TRUE(controller.update(time + kPeriod));
+}
+
+TEST(vpx_rate_controller_test, refresh_uses_best_quality)
+{
+    VpxRateController controller(
+        proto::desktop::VIDEO_QUALITY_HIGH, kScreenSize, VpxRateController::Clock::now());
+
+    const VpxRateController::Settings refresh = controller.refreshSettings();
+
+    EXPECT_EQ(refresh.min_quantizer, refresh.max_quantizer);
+    EXPECT_LE(refresh.max_quantizer, controller.settings().min_quantizer);
+    EXPECT_GE(refresh.bitrate, controller.settings().bitrate);
+}
+
+} // namespace codec
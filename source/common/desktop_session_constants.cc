@@ -25,15 +25,25 @@ const char kSelectScreenExtension[] = "select_screen";
 const char kPowerControlExtension[] = "power_control";
 const char kRemoteUpdateExtension[] = "remote_update";
 const char kSystemInfoExtension[] = "system_info";
+const char kFrameAckExtension[] = "frame_ack";
 
 const char kSupportedExtensionsForManage[] =
-    "select_screen;power_control;remote_update;system_info";
+    "select_screen;power_control;remote_update;system_info;frame_ack";
 
 const char kSupportedExtensionsForView[] =
-    "select_screen;system_info";
+    "select_screen;system_info;frame_ack";
 
 const uint32_t kSupportedVideoEncodings =
     proto::desktop::VIDEO_ENCODING_VP8 | proto::desktop::VIDEO_ENCODING_VP9 |
-    proto::desktop::VIDEO_ENCODING_ZSTD;
+    proto::desktop::VIDEO_ENCODING_VP9_I444 | proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS |
+    proto::desktop::VIDEO_ENCODING_ZSTD | proto::desktop::VIDEO_ENCODING_HYBRID;
+
+const uint32_t kSupportedVideoFeatures =
+    proto::desktop::VIDEO_FEATURE_ZSTD_TILES | proto::desktop::VIDEO_FEATURE_ZSTD_CONTEXT |
+    proto::desktop::VIDEO_FEATURE_FRAME_ACK | proto::desktop::VIDEO_FEATURE_COPY_RECT |
+    proto::desktop::VIDEO_FEATURE_TILE_CACHE;
+
+const uint32_t kMinScaleFactor = 10;
+const uint32_t kMaxScaleFactor = 100;
 
 } // namespace common
@@ -27,11 +27,18 @@ extern const char kSelectScreenExtension[];
 extern const char kPowerControlExtension[];
 extern const char kRemoteUpdateExtension[];
 extern const char kSystemInfoExtension[];
+extern const char kFrameAckExtension[];
 
 extern const char kSupportedExtensionsForManage[];
 extern const char kSupportedExtensionsForView[];
 
 extern const uint32_t kSupportedVideoEncodings;
+extern const uint32_t kSupportedVideoFeatures;
+
+// Range of proto::desktop::Config::scale_factor. If the factor is less than the maximum, the host
+// scales the screen down before encoding.
+extern const uint32_t kMinScaleFactor;
+extern const uint32_t kMaxScaleFactor;
 
 } // namespace common
 
@@ -27,19 +27,31 @@
 
 namespace common {
 
-static QByteArray serializeMessage(const google::protobuf::MessageLite& message)
+// Serializes the message into |buffer|. The memory of the buffer is reused if it is not shared
+// with other buffers.
+static bool serializeMessage(const google::protobuf::MessageLite& message, QByteArray* buffer)
 {
-    size_t size = message.ByteSizeLong();
+    const int size = static_cast<int>(message.ByteSizeLong());
     if (!size)
     {
         LOG(LS_WARNING) << "Empty messages are not allowed";
-        return QByteArray();
+        buffer->clear();
+        return false;
     }
 
-    QByteArray buffer;
-    buffer.resize(size);
+    if (buffer->capacity() < size)
+        buffer->reserve(size);
+
+    buffer->resize(size);
+
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer->data()));
+    return true;
+}
 
-    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(buffer.data()));
+static QByteArray serializeMessage(const google::protobuf::MessageLite& message)
+{
+    QByteArray buffer;
+    serializeMessage(message, &buffer);
     return buffer;
 }
 
@@ -52,8 +52,11 @@ void ComputerDialogDesktop::restoreSettings(
 {
     QComboBox* combo_codec = ui.combo_codec;
     combo_codec->addItem(QLatin1String("VP9"), proto::desktop::VIDEO_ENCODING_VP9);
+    combo_codec->addItem(QLatin1String("VP9 (4:4:4)"), proto::desktop::VIDEO_ENCODING_VP9_I444);
+    combo_codec->addItem(tr("VP9 (lossless)"), proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS);
     combo_codec->addItem(QLatin1String("VP8"), proto::desktop::VIDEO_ENCODING_VP8);
     combo_codec->addItem(QLatin1String("ZSTD"), proto::desktop::VIDEO_ENCODING_ZSTD);
+    combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::desktop::VIDEO_ENCODING_HYBRID);
 
     QComboBox* combo_color_depth = ui.combo_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
@@ -128,7 +131,8 @@ void ComputerDialogDesktop::saveSettings(proto::desktop::Config* config)
 
     config->set_video_encoding(video_encoding);
 
-    if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD)
+    if (video_encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+        video_encoding == proto::desktop::VIDEO_ENCODING_HYBRID)
     {
         desktop::PixelFormat pixel_format;
 
@@ -188,8 +192,11 @@ void ComputerDialogDesktop::saveSettings(proto::desktop::Config* config)
 
 void ComputerDialogDesktop::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::desktop::VIDEO_ENCODING_ZSTD);
+    const int encoding = ui.combo_codec->itemData(item_index).toInt();
+
+    // The hybrid encoding sends the text and the user interface with Zstd.
+    bool has_pixel_format = (encoding == proto::desktop::VIDEO_ENCODING_ZSTD ||
+                             encoding == proto::desktop::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
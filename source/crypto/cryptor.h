@@ -31,6 +31,10 @@ public:
 
     virtual size_t decryptedDataSize(size_t in_size) = 0;
     virtual bool decrypt(const char* in, size_t in_size, char* out) = 0;
+
+    // Encrypts the data in place. |buffer| has the size encryptedDataSize(|in_size|) and the data
+    // to encrypt is located at its end. The encrypted data occupies the whole buffer.
+    virtual bool encryptInPlace(char* buffer, size_t in_size) = 0;
 };
 
 } // namespace crypto
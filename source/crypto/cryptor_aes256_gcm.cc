@@ -204,4 +204,11 @@ bool CryptorAes256Gcm::decrypt(const char* in, size_t in_size, char* out)
     return true;
 }
 
+bool CryptorAes256Gcm::encryptInPlace(char* buffer, size_t in_size)
+{
+    // The tag is placed before the encrypted data, the cipher itself allows the same input and
+    // output.
+    return encrypt(buffer + kTagSize, in_size, buffer);
+}
+
 } // namespace crypto
@@ -42,6 +42,8 @@ public:
     size_t decryptedDataSize(size_t in_size) override;
     bool decrypt(const char* in, size_t in_size, char* out) override;
 
+    bool encryptInPlace(char* buffer, size_t in_size) override;
+
 protected:
     CryptorAes256Gcm(EVP_CIPHER_CTX_ptr encrypt_ctx,
                      EVP_CIPHER_CTX_ptr decrypt_ctx,
@@ -204,4 +204,11 @@ bool CryptorChaCha20Poly1305::decrypt(const char* in, size_t in_size, char* out)
     return true;
 }
 
+bool CryptorChaCha20Poly1305::encryptInPlace(char* buffer, size_t in_size)
+{
+    // The tag is placed before the encrypted data, the cipher itself allows the same input and
+    // output.
+    return encrypt(buffer + kTagSize, in_size, buffer);
+}
+
 } // namespace crypto
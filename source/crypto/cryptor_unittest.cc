@@ -106,6 +106,37 @@ void wrongKey(Cryptor* client_cryptor, Cryptor* host_cryptor)
     ASSERT_FALSE(ret);
 }
 
+void inPlace(Cryptor* client_cryptor, Cryptor* host_cryptor)
+{
+    const QByteArray message_for_host = QByteArray::fromHex(
+        "6006ee8029610876ec2facd5fc9ce6bd6dc03d4a5ddb4d6c28f2ff048d4f7eb7bcf5048c901a4adaa7fd8aa65bc95ca1d9f21ced474a45e9c6e7344184d6d715");
+
+    // The message is placed at the end of the buffer and encrypted in place.
+    QByteArray encrypted_msg_for_host;
+
+    encrypted_msg_for_host.resize(
+        client_cryptor->encryptedDataSize(message_for_host.size()));
+    ASSERT_EQ(encrypted_msg_for_host.size(), message_for_host.size() + 16);
+
+    memcpy(encrypted_msg_for_host.data() + 16, message_for_host.constData(),
+           message_for_host.size());
+
+    bool ret = client_cryptor->encryptInPlace(encrypted_msg_for_host.data(),
+                                              message_for_host.size());
+    ASSERT_TRUE(ret);
+
+    QByteArray decrypted_msg_for_host;
+
+    decrypted_msg_for_host.resize(
+        host_cryptor->decryptedDataSize(encrypted_msg_for_host.size()));
+
+    ret = host_cryptor->decrypt(encrypted_msg_for_host.constData(),
+                                encrypted_msg_for_host.size(),
+                                decrypted_msg_for_host.data());
+    ASSERT_TRUE(ret);
+    ASSERT_EQ(decrypted_msg_for_host, message_for_host);
+}
+
 TEST(CryptorAes256GcmTest, TestVector)
 {
     const QByteArray key =
@@ -153,6 +184,25 @@ TEST(CryptorAes256GcmTest, WrongKey)
     wrongKey(client_cryptor.get(), host_cryptor.get());
 }
 
+TEST(CryptorAes256GcmTest, InPlace)
+{
+    const QByteArray key =
+        QByteArray::fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const QByteArray encrypt_iv = QByteArray::fromHex("ee7eb0e6fb24d445597f3e6f");
+    const QByteArray decrypt_iv = QByteArray::fromHex("924988304848184805f07167");
+
+    std::unique_ptr<Cryptor> client_cryptor(CryptorAes256Gcm::create(key, encrypt_iv, decrypt_iv));
+    ASSERT_NE(client_cryptor, nullptr);
+
+    std::unique_ptr<Cryptor> host_cryptor(CryptorAes256Gcm::create(key, decrypt_iv, encrypt_iv));
+    ASSERT_NE(host_cryptor, nullptr);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        inPlace(client_cryptor.get(), host_cryptor.get());
+    }
+}
+
 TEST(CryptorChaCha20Poly1305Test, TestVector)
 {
     const QByteArray key =
@@ -202,4 +252,25 @@ TEST(CryptorChaCha20Poly1305Test, WrongKey)
     wrongKey(client_cryptor.get(), host_cryptor.get());
 }
 
+TEST(CryptorChaCha20Poly1305Test, InPlace)
+{
+    const QByteArray key =
+        QByteArray::fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+    const QByteArray encrypt_iv = QByteArray::fromHex("ee7eb0e6fb24d445597f3e6f");
+    const QByteArray decrypt_iv = QByteArray::fromHex("924988304848184805f07167");
+
+    std::unique_ptr<Cryptor> client_cryptor(
+        CryptorChaCha20Poly1305::create(key, encrypt_iv, decrypt_iv));
+    ASSERT_NE(client_cryptor, nullptr);
+
+    std::unique_ptr<Cryptor> host_cryptor(
+        CryptorChaCha20Poly1305::create(key, decrypt_iv, encrypt_iv));
+    ASSERT_NE(host_cryptor, nullptr);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        inPlace(client_cryptor.get(), host_cryptor.get());
+    }
+}
+
 } // namespace crypto
@@ -18,33 +18,128 @@
 
 #include "desktop/capture_scheduler.h"
 
+#include <algorithm>
+
 namespace desktop {
 
-CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
-    : update_interval_(update_interval)
+namespace {
+
+// Weight of a new value in the moving average.
+const double kAverageWeight = 0.2;
+
+// The small updates are not cheaper than this fraction of the full screen update.
+const double kMinDirtyFraction = 0.05;
+
+// If the channel has more bytes in the queue, the interval grows.
+const int64_t kHighPendingBytes = 2 * 1024 * 1024; // 2 MB
+
+// If the channel has less bytes in the queue, the interval decreases.
+const int64_t kLowPendingBytes = 256 * 1024; // 256 kB
+
+// Factors by which the interval changes depending on the channel queue.
+const double kIncreaseFactor = 1.5;
+const double kDecreaseFactor = 0.9;
+
+} // namespace
+
+CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& min_interval,
+                                   const std::chrono::milliseconds& max_interval)
+    : min_interval_(min_interval),
+      max_interval_(std::max(min_interval, max_interval)),
+      network_interval_(static_cast<double>(min_interval.count()))
 {
-    // Nothing
+    decision_.interval = min_interval_;
+    decision_.full_frame_time = std::chrono::milliseconds::zero();
 }
 
 void CaptureScheduler::beginCapture()
 {
-    begin_time_ = std::chrono::high_resolution_clock::now();
+    begin_time_ = Clock::now();
 }
 
 void CaptureScheduler::endCapture()
 {
-    end_time_ = std::chrono::high_resolution_clock::now();
+    end_time_ = Clock::now();
+
+    std::scoped_lock lock(lock_);
+
+    capture_time_ = end_time_ - begin_time_;
+
+    if (pending_bytes_ > kHighPendingBytes)
+        network_interval_ *= kIncreaseFactor;
+    else if (pending_bytes_ < kLowPendingBytes)
+        network_interval_ *= kDecreaseFactor;
+
+    network_interval_ = std::clamp(network_interval_,
+                                   static_cast<double>(min_interval_.count()),
+                                   static_cast<double>(max_interval_.count()));
+
+    // Expected time of capturing and encoding the next frame.
+    const double frame_time =
+        full_frame_time_ * std::max(dirty_fraction_, kMinDirtyFraction);
+
+    const double interval = std::clamp(std::max(network_interval_, frame_time),
+                                       static_cast<double>(min_interval_.count()),
+                                       static_cast<double>(max_interval_.count()));
+
+    decision_.interval = std::chrono::milliseconds(static_cast<int64_t>(interval));
+    decision_.full_frame_time = std::chrono::milliseconds(static_cast<int64_t>(full_frame_time_));
+    decision_.pending_bytes = pending_bytes_;
+    decision_.dirty_fraction = dirty_fraction_;
 }
 
 std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
 {
+    std::scoped_lock lock(lock_);
+
     std::chrono::milliseconds diff_time =
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+    if (diff_time > decision_.interval)
+        diff_time = decision_.interval;
 
-    return update_interval_ - diff_time;
+    return decision_.interval - diff_time;
+}
+
+void CaptureScheduler::onFrameEncoded(const std::chrono::milliseconds& encode_time,
+                                      double dirty_fraction)
+{
+    std::scoped_lock lock(lock_);
+
+    dirty_fraction_ = std::clamp(dirty_fraction, 0.0, 1.0);
+
+    const double frame_time = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(capture_time_).count() +
+        encode_time.count());
+
+    // The time is converted to the time of the full screen frame.
+    const double full_frame_time = frame_time / std::max(dirty_fraction_, kMinDirtyFraction);
+
+    if (full_frame_time_ == 0)
+        full_frame_time_ = full_frame_time;
+    else
+        full_frame_time_ += (full_frame_time - full_frame_time_) * kAverageWeight;
+}
+
+void CaptureScheduler::setPendingBytes(int64_t pending_bytes)
+{
+    std::scoped_lock lock(lock_);
+    pending_bytes_ = pending_bytes;
+}
+
+CaptureScheduler::Decision CaptureScheduler::lastDecision() const
+{
+    std::scoped_lock lock(lock_);
+    return decision_;
+}
+
+std::ostream& operator<<(std::ostream& stream, const CaptureScheduler::Decision& decision)
+{
+    return stream << "CaptureScheduler::Decision("
+                  << "interval: " << decision.interval.count() << " ms, "
+                  << "full frame time: " << decision.full_frame_time.count() << " ms, "
+                  << "pending bytes: " << decision.pending_bytes << ", "
+                  << "dirty: " << static_cast<int>(decision.dirty_fraction * 100) << "%)";
 }
 
 } // namespace desktop
@@ -22,27 +22,85 @@
 #include "base/macros_magic.h"
 
 #include <chrono>
+#include <mutex>
+#include <ostream>
 
 namespace desktop {
 
+// Chooses the interval between captures inside the range [min_interval, max_interval].
+// The interval is not less than the expected time of capturing and encoding the next frame (a
+// moving average of the time spent per full screen, scaled by the dirty-area fraction). If the
+// data is queued in the channel faster than it is sent, the interval grows, when the queue is
+// empty it decreases again.
+// beginCapture(), endCapture() and nextCaptureDelay() are called by the capture thread. The other
+// methods can be called from any thread.
 class CaptureScheduler
 {
 public:
-    explicit CaptureScheduler(const std::chrono::milliseconds& update_interval);
+    CaptureScheduler(const std::chrono::milliseconds& min_interval,
+                     const std::chrono::milliseconds& max_interval);
     ~CaptureScheduler() = default;
 
+    struct Decision
+    {
+        // The chosen interval between captures.
+        std::chrono::milliseconds interval;
+
+        // The moving average of capture and encode time of a full screen frame.
+        std::chrono::milliseconds full_frame_time;
+
+        // The number of bytes which were queued in the channel.
+        int64_t pending_bytes = 0;
+
+        // The fraction of the screen which was changed in the last encoded frame.
+        double dirty_fraction = 0;
+    };
+
     void beginCapture();
     void endCapture();
     std::chrono::milliseconds nextCaptureDelay() const;
 
+    // Called when a frame is encoded. |dirty_fraction| is the changed part of the frame
+    // (from 0 to 1).
+    void onFrameEncoded(const std::chrono::milliseconds& encode_time, double dirty_fraction);
+
+    // Sets the number of bytes which are waiting to be sent.
+    void setPendingBytes(int64_t pending_bytes);
+
+    // Returns the last decision made in endCapture().
+    Decision lastDecision() const;
+
 private:
-    std::chrono::milliseconds update_interval_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
+    using Clock = std::chrono::high_resolution_clock;
+
+    const std::chrono::milliseconds min_interval_;
+    const std::chrono::milliseconds max_interval_;
+
+    Clock::time_point begin_time_;
+    Clock::time_point end_time_;
+
+    mutable std::mutex lock_;
+
+    // The duration of the last capture.
+    Clock::duration capture_time_ = Clock::duration::zero();
+
+    // The moving average of the time of capturing and encoding a full screen frame (in
+    // milliseconds).
+    double full_frame_time_ = 0;
+
+    // The interval which is adjusted by the size of the channel queue.
+    double network_interval_;
+
+    int64_t pending_bytes_ = 0;
+    double dirty_fraction_ = 0;
+
+    Decision decision_;
 
     DISALLOW_COPY_AND_ASSIGN(CaptureScheduler);
 };
 
+std::ostream& operator<<(std::ostream& stream, const CaptureScheduler::Decision& decision);
+
 } // namespace desktop
 
 #endif // DESKTOP__CAPTURE_SCHEDULER_H
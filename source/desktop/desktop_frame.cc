@@ -20,6 +20,9 @@
 
 #include "base/logging.h"
 
+#include <cstring>
+#include <functional>
+
 namespace desktop {
 
 Frame::Frame(const Size& size, const PixelFormat& format, int stride, uint8_t* data)
@@ -42,12 +45,24 @@ void Frame::copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect
 
     uint8_t* dest = frameDataAtPos(dest_rect.topLeft());
     size_t bytes_per_row = format_.bytesPerPixel() * dest_rect.width();
+    int dest_stride = stride();
+
+    // The source may be an area of this frame (a moved area). If the source rows are above the
+    // destination rows, they are copied from the bottom so they are not overwritten before being
+    // read.
+    if (std::less<const uint8_t*>()(src_buffer, dest))
+    {
+        src_buffer += src_stride * (dest_rect.height() - 1);
+        dest += dest_stride * (dest_rect.height() - 1);
+        src_stride = -src_stride;
+        dest_stride = -dest_stride;
+    }
 
     for (int y = 0; y < dest_rect.height(); ++y)
     {
-        memcpy(dest, src_buffer, bytes_per_row);
+        memmove(dest, src_buffer, bytes_per_row);
         src_buffer += src_stride;
-        dest += stride();
+        dest += dest_stride;
     }
 }
 
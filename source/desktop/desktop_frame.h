@@ -38,6 +38,7 @@ public:
     int stride() const { return stride_; }
     bool contains(int x, int y) const;
 
+    // The source pixels may overlap |dest_rect| of this frame.
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
@@ -0,0 +1,166 @@
+//
+// Aspia Project
+// Copyright (C) 2018 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "base/aligned_memory.h"
+#include "desktop/diff_block_16bpp_avx2.h"
+#include "desktop/diff_block_16bpp_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+namespace desktop {
+
+namespace {
+
+using AlignedBuffer = std::unique_ptr<uint8_t, base::AlignedFreeDeleter>;
+using DiffFullBlockFunc = uint8_t(*)(const uint8_t*, const uint8_t*, int);
+
+// Run 900 times to mimic 1280x720.
+const int kTimesToRun = 900;
+const int kBytesPerPixel = 2;
+
+struct DiffBlock16bppSSE2
+{
+    static const int kAlignment = 16;
+
+    static bool isSupported() { return libyuv::TestCpuFlag(libyuv::kCpuHasSSE2); }
+
+    static DiffFullBlockFunc function(int block_size)
+    {
+        switch (block_size)
+        {
+            case 32: return diffFullBlock_16bpp_32x32_SSE2;
+            case 16: return diffFullBlock_16bpp_16x16_SSE2;
+            default: return diffFullBlock_16bpp_8x8_SSE2;
+        }
+    }
+};
+
+struct DiffBlock16bppAVX2
+{
+    static const int kAlignment = 32;
+
+    static bool isSupported() { return libyuv::TestCpuFlag(libyuv::kCpuHasAVX2); }
+
+    static DiffFullBlockFunc function(int block_size)
+    {
+        switch (block_size)
+        {
+            case 32: return diffFullBlock_16bpp_32x32_AVX2;
+            case 16: return diffFullBlock_16bpp_16x16_AVX2;
+            default: return diffFullBlock_16bpp_8x8_AVX2;
+        }
+    }
+};
+
+void generateData(uint8_t* data, int size)
+{
+    for (int i = 0; i < size; ++i)
+        data[i] = i;
+}
+
+int fullBlockSize(int block_size)
+{
+    return block_size * block_size * kBytesPerPixel;
+}
+
+void prepareBuffers(AlignedBuffer* block1, AlignedBuffer* block2, int block_size, int alignment)
+{
+    int full_block_size = fullBlockSize(block_size);
+
+    block1->reset(reinterpret_cast<uint8_t*>(base::alignedAlloc(full_block_size, alignment)));
+    block2->reset(reinterpret_cast<uint8_t*>(base::alignedAlloc(full_block_size, alignment)));
+
+    generateData(block1->get(), full_block_size);
+
+    memcpy(block2->get(), block1->get(), full_block_size);
+}
+
+// Changes the byte at |offset(block_size)| of the second block (unless |offset| is null) and
+// compares the blocks of all sizes with the functions of |Impl|.
+template <class Impl>
+void testBlocks(int(*offset)(int), int expected)
+{
+    static const int kBlockSizes[] = { 32, 16, 8 };
+
+    AlignedBuffer block1;
+    AlignedBuffer block2;
+
+    for (int block_size : kBlockSizes)
+    {
+        prepareBuffers(&block1, &block2, block_size, Impl::kAlignment);
+
+        if (offset)
+            block2.get()[offset(block_size)] += 1;
+
+        const DiffFullBlockFunc diff_function = Impl::function(block_size);
+
+        for (int i = 0; i < kTimesToRun; ++i)
+        {
+            int result = diff_function(block1.get(), block2.get(), block_size * kBytesPerPixel);
+            EXPECT_EQ(expected, result) << "block size " << block_size;
+        }
+    }
+}
+
+} // namespace
+
+// The tests are run for each implementation which the CPU supports.
+template <class Impl>
+class diff_block_16bpp : public testing::Test
+{
+    // Nothing
+};
+
+using DiffBlock16bppImpls = testing::Types<DiffBlock16bppSSE2, DiffBlock16bppAVX2>;
+TYPED_TEST_SUITE(diff_block_16bpp, DiffBlock16bppImpls);
+
+TYPED_TEST(diff_block_16bpp, block_difference_test_same)
+{
+    if (!TypeParam::isSupported())
+        return;
+
+    // These blocks should match.
+    testBlocks<TypeParam>(nullptr, 0);
+}
+
+TYPED_TEST(diff_block_16bpp, block_difference_test_last)
+{
+    if (!TypeParam::isSupported())
+        return;
+
+    testBlocks<TypeParam>([](int block_size) { return fullBlockSize(block_size) - 2; }, 1);
+}
+
+TYPED_TEST(diff_block_16bpp, block_difference_test_mid)
+{
+    if (!TypeParam::isSupported())
+        return;
+
+    testBlocks<TypeParam>([](int block_size) { return fullBlockSize(block_size) / 2 + 1; }, 1);
+}
+
+TYPED_TEST(diff_block_16bpp, block_difference_test_first)
+{
+    if (!TypeParam::isSupported())
+        return;
+
+    testBlocks<TypeParam>([](int /* block_size */) { return 0; }, 1);
+}
+
+} // namespace desktop
@@ -0,0 +1,78 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/diff_partial_block_sse2.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <mmintrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace desktop {
+
+uint8_t diffPartialBlock_SSE2(const uint8_t* image1,
+                              const uint8_t* image2,
+                              int bytes_per_row,
+                              int bytes_per_block,
+                              int height)
+{
+    static const int kVectorSize = 16;
+    static const int kEqualMask = 0xFFFF;
+
+    const int full_vectors = bytes_per_block / kVectorSize;
+    const int tail_size = bytes_per_block % kVectorSize;
+
+    // The tail is at the end of the last 16 bytes of the row. Bit N of the mask corresponds to
+    // byte N of the vector.
+    const int tail_mask = (kEqualMask << (kVectorSize - tail_size)) & kEqualMask;
+    const int tail_offset = bytes_per_block - kVectorSize;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* i1 = reinterpret_cast<const __m128i*>(image1);
+        const __m128i* i2 = reinterpret_cast<const __m128i*>(image2);
+
+        for (int i = 0; i < full_vectors; ++i)
+        {
+            __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128(i1 + i), _mm_loadu_si128(i2 + i));
+
+            if (_mm_movemask_epi8(equal) != kEqualMask)
+                return 1U;
+        }
+
+        if (tail_size != 0)
+        {
+            __m128i equal = _mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(image1 + tail_offset)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(image2 + tail_offset)));
+
+            if (~_mm_movemask_epi8(equal) & tail_mask)
+                return 1U;
+        }
+
+        image1 += bytes_per_row;
+        image2 += bytes_per_row;
+    }
+
+    return 0U;
+}
+
+} // namespace desktop
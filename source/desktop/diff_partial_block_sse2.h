@@ -0,0 +1,38 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__DIFF_PARTIAL_BLOCK_SSE2_H
+#define DESKTOP__DIFF_PARTIAL_BLOCK_SSE2_H
+
+#include <cstdint>
+
+namespace desktop {
+
+// Checks for diffs in |height| rows of |bytes_per_block| bytes. The tail of a row which is shorter
+// than 16 bytes is compared by loading the last 16 bytes of the row and masking out the bytes
+// before it. Therefore if |bytes_per_block| is less than 16, then 16 - |bytes_per_block| bytes
+// before each row must be readable.
+uint8_t diffPartialBlock_SSE2(const uint8_t* image1,
+                              const uint8_t* image2,
+                              int bytes_per_row,
+                              int bytes_per_block,
+                              int height);
+
+} // namespace desktop
+
+#endif // DESKTOP__DIFF_PARTIAL_BLOCK_SSE2_H
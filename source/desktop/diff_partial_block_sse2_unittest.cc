@@ -0,0 +1,128 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/diff_partial_block_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <vector>
+
+namespace desktop {
+
+namespace {
+
+const int kBytesPerRow = 96;
+const int kMaxHeight = 8;
+
+// Offset of the partial block in the row. The bytes before the block belong to another block.
+const int kBlockOffset = 32;
+const int kMaxBlockWidth = kBytesPerRow - kBlockOffset;
+
+std::vector<uint8_t> generateImage()
+{
+    std::vector<uint8_t> image(kBytesPerRow * kMaxHeight);
+
+    for (size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<uint8_t>(i);
+
+    return image;
+}
+
+int diffPartialBlock(const std::vector<uint8_t>& image1,
+                     const std::vector<uint8_t>& image2,
+                     int width,
+                     int height)
+{
+    return diffPartialBlock_SSE2(image1.data() + kBlockOffset,
+                                 image2.data() + kBlockOffset,
+                                 kBytesPerRow,
+                                 width,
+                                 height);
+}
+
+} // namespace
+
+TEST(diff_partial_block_sse2, block_difference_test_same)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    std::vector<uint8_t> image1 = generateImage();
+    std::vector<uint8_t> image2 = image1;
+
+    for (int height = 1; height <= kMaxHeight; ++height)
+    {
+        for (int width = 1; width <= kMaxBlockWidth; ++width)
+            EXPECT_EQ(0, diffPartialBlock(image1, image2, width, height));
+    }
+}
+
+TEST(diff_partial_block_sse2, block_difference_test_inside)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    std::vector<uint8_t> image1 = generateImage();
+
+    for (int height = 1; height <= kMaxHeight; ++height)
+    {
+        for (int width = 1; width <= kMaxBlockWidth; ++width)
+        {
+            // The first and the last byte of the last row of the block.
+            for (int x : { 0, width - 1 })
+            {
+                std::vector<uint8_t> image2 = image1;
+                image2[(height - 1) * kBytesPerRow + kBlockOffset + x] += 1;
+
+                EXPECT_EQ(1, diffPartialBlock(image1, image2, width, height))
+                    << "width " << width << ", height " << height << ", x " << x;
+            }
+        }
+    }
+}
+
+TEST(diff_partial_block_sse2, block_difference_test_outside)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    std::vector<uint8_t> image1 = generateImage();
+
+    for (int height = 1; height < kMaxHeight; ++height)
+    {
+        for (int width = 1; width < kMaxBlockWidth; ++width)
+        {
+            std::vector<uint8_t> image2 = image1;
+
+            // The bytes to the left, to the right and below the block are not compared.
+            for (int y = 0; y < height; ++y)
+            {
+                image2[y * kBytesPerRow + kBlockOffset - 1] += 1;
+                image2[y * kBytesPerRow + kBlockOffset + width] += 1;
+            }
+
+            image2[height * kBytesPerRow + kBlockOffset] += 1;
+
+            EXPECT_EQ(0, diffPartialBlock(image1, image2, width, height))
+                << "width " << width << ", height " << height;
+        }
+    }
+}
+
+} // namespace desktop
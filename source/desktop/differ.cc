@@ -19,20 +19,34 @@
 #include "desktop/differ.h"
 
 #include "base/logging.h"
+#include "desktop/diff_block_16bpp_avx2.h"
 #include "desktop/diff_block_16bpp_c.h"
+#include "desktop/diff_block_16bpp_sse2.h"
 #include "desktop/diff_block_32bpp_avx2.h"
 #include "desktop/diff_block_32bpp_sse2.h"
 #include "desktop/diff_block_32bpp_sse3.h"
 #include "desktop/diff_block_32bpp_c.h"
+#include "desktop/diff_partial_block_sse2.h"
+#include "desktop/row_hash_sse42.h"
 
 #include <libyuv/cpu_id.h>
 
+#if defined(USE_TBB)
+#include <tbb/parallel_for.h>
+#endif // defined(USE_TBB)
+
+#include <algorithm>
+#include <thread>
+
 namespace desktop {
 
 namespace {
 
 const int kBlockSize = 8;
 
+// Minimum number of rows of blocks in a band. Smaller bands are not worth the threading overhead.
+const int kMinBandRows = 32;
+
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and height are multiples
@@ -55,16 +69,28 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
-
+int bandCount(Differ::Mode mode, int block_rows)
+{
+#if defined(USE_TBB)
+    if (mode == Differ::Mode::SERIAL)
+        return 1;
+
+    const int thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+    return std::clamp(block_rows / kMinBandRows, 1, thread_count);
+#else // defined(USE_TBB)
+    return 1;
+#endif // defined(USE_*)
+}
 
 } // namespace
 
-Differ::Differ(const Size& size, const PixelFormat& format)
+Differ::Differ(const Size& size, const PixelFormat& format, Mode mode)
     : screen_rect_(Rect::makeSize(size)),
+      full_blocks_x_(size.width() / kBlockSize),
+      full_blocks_y_(size.height() / kBlockSize),
       diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
       diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
-      full_blocks_x_(size.width() / kBlockSize),
-      full_blocks_y_(size.height() / kBlockSize)
+      block_rows_((size.height() + kBlockSize - 1) / kBlockSize)
 {
     bytes_per_pixel_ = format.bytesPerPixel();
     bytes_per_row_ = size.width() * bytes_per_pixel_;
@@ -97,6 +123,16 @@ Differ::Differ(const Size& size, const PixelFormat& format)
     }
 
     CHECK(diff_full_block_func_);
+
+    diff_partial_block_func_ = diffPartialFunction(full_blocks_x_);
+
+    hash_row_func_ = hashRowFunction();
+    if (hash_row_func_)
+        row_hashes_ = std::make_unique<uint64_t[]>(size.height());
+
+    const int band_count = bandCount(mode, block_rows_);
+    if (band_count > 1)
+        band_regions_.resize(band_count);
 }
 
 // static
@@ -157,36 +193,128 @@ Differ::DiffFullBlockFunc Differ::diffFunctionFor16bpp()
 {
     DiffFullBlockFunc func = nullptr;
 
-    LOG(LS_INFO) << "C differ loaded (16bpp)";
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 differ loaded (16bpp)";
+
+        if constexpr (kBlockSize == 8)
+            func = diffFullBlock_16bpp_8x8_AVX2;
+        else if constexpr (kBlockSize == 16)
+            func = diffFullBlock_16bpp_16x16_AVX2;
+        else if constexpr (kBlockSize == 32)
+            func = diffFullBlock_16bpp_32x32_AVX2;
+    }
+    else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+    {
+        LOG(LS_INFO) << "SSE2 differ loaded (16bpp)";
+
+        if constexpr (kBlockSize == 8)
+            func = diffFullBlock_16bpp_8x8_SSE2;
+        else if constexpr (kBlockSize == 16)
+            func = diffFullBlock_16bpp_16x16_SSE2;
+        else if constexpr (kBlockSize == 32)
+            func = diffFullBlock_16bpp_32x32_SSE2;
+    }
+    else
+    {
+        LOG(LS_INFO) << "C differ loaded (16bpp)";
 
-    if constexpr (kBlockSize == 8)
-        func = diffFullBlock_16bpp_8x8_C;
-    else if constexpr (kBlockSize == 16)
-        func = diffFullBlock_16bpp_16x16_C;
-    else if constexpr (kBlockSize == 32)
-        func = diffFullBlock_16bpp_32x32_C;
+        if constexpr (kBlockSize == 8)
+            func = diffFullBlock_16bpp_8x8_C;
+        else if constexpr (kBlockSize == 16)
+            func = diffFullBlock_16bpp_16x16_C;
+        else if constexpr (kBlockSize == 32)
+            func = diffFullBlock_16bpp_32x32_C;
+    }
 
     return func;
 }
 
+// static
+Differ::DiffPartialBlockFunc Differ::diffPartialFunction(int full_blocks_x)
+{
+    // The vectorized function reads the bytes before a partial column which is shorter than 16
+    // bytes. They belong to the previous block of the row.
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2) && full_blocks_x > 0)
+        return diffPartialBlock_SSE2;
+
+    return diffPartialBlock;
+}
+
+// static
+Differ::HashRowFunc Differ::hashRowFunction()
+{
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+    {
+        LOG(LS_INFO) << "SSE4.2 row hash loaded";
+        return hashRow_SSE42;
+    }
+
+    // Without the CRC32 instruction the checksums are not cheaper than the comparison of blocks.
+    return nullptr;
+}
+
+bool Differ::updateRowHashes(const uint8_t* curr_image, int block_row)
+{
+    const int first_row = block_row * kBlockSize;
+    const int last_row = std::min(first_row + kBlockSize, screen_rect_.height());
+
+    const uint8_t* row = curr_image + static_cast<size_t>(first_row) * bytes_per_row_;
+
+    // The checksums are unknown for the first frame.
+    bool changed = !row_hashes_valid_;
+
+    for (int y = first_row; y < last_row; ++y)
+    {
+        const uint64_t hash = hash_row_func_(row, bytes_per_row_);
+
+        if (row_hashes_[y] != hash)
+        {
+            row_hashes_[y] = hash;
+            changed = true;
+        }
+
+        row += bytes_per_row_;
+    }
+
+    return changed;
+}
+
 // Identify all of the blocks that contain changed pixels.
-void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
+void Differ::markDirtyBlocks(const uint8_t* prev_image,
+                             const uint8_t* curr_image,
+                             int first_row,
+                             int last_row)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    const size_t block_row_offset = static_cast<size_t>(first_row) * block_stride_y_;
+
+    const uint8_t* prev_block_row_start = prev_image + block_row_offset;
+    const uint8_t* curr_block_row_start = curr_image + block_row_offset;
 
     // Offset from the start of one diff_info row to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    uint8_t* is_diff_row_start = diff_info_.get() + first_row * diff_stride;
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    const int last_full_row = std::min(last_row, full_blocks_y_);
+
+    for (int y = first_row; y < last_full_row; ++y)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
 
         uint8_t* is_different = is_diff_row_start;
 
+        // The unchanged rows are skipped. Their marks are already cleared by mergeBlocks.
+        if (hash_row_func_ && !updateRowHashes(curr_image, y))
+        {
+            prev_block_row_start += block_stride_y_;
+            curr_block_row_start += block_stride_y_;
+
+            is_diff_row_start += diff_stride;
+            continue;
+        }
+
         for (int x = 0; x < full_blocks_x_; ++x)
         {
             // Mark this block as being modified so that it gets
@@ -203,11 +331,11 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
         // This condition should rarely, if ever, occur.
         if (partial_column_width_ != 0)
         {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             bytes_per_block_,
-                                             kBlockSize);
+            *is_different = diff_partial_block_func_(prev_block,
+                                                     curr_block,
+                                                     bytes_per_row_,
+                                                     partial_column_width_ * bytes_per_pixel_,
+                                                     kBlockSize);
         }
 
         // Update pointers for next row.
@@ -220,7 +348,8 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
     // If the screen height is not a multiple of the block size, then this
     // handles the last partial row. This situation is far more common than
     // the 'partial column' case.
-    if (partial_row_height_ != 0)
+    if (partial_row_height_ != 0 && last_row > full_blocks_y_ &&
+        (!hash_row_func_ || updateRowHashes(curr_image, full_blocks_y_)))
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -229,11 +358,11 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 
         for (int x = 0; x < full_blocks_x_; ++x)
         {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             bytes_per_block_,
-                                             partial_row_height_);
+            *is_different = diff_partial_block_func_(prev_block,
+                                                     curr_block,
+                                                     bytes_per_row_,
+                                                     bytes_per_block_,
+                                                     partial_row_height_);
 
             prev_block += bytes_per_block_;
             curr_block += bytes_per_block_;
@@ -243,11 +372,11 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
         if (partial_column_width_ != 0)
         {
             *is_different =
-                diffPartialBlock(prev_block,
-                                 curr_block,
-                                 bytes_per_row_,
-                                 partial_column_width_ * bytes_per_pixel_,
-                                 partial_row_height_);
+                diff_partial_block_func_(prev_block,
+                                         curr_block,
+                                         bytes_per_row_,
+                                         partial_column_width_ * bytes_per_pixel_,
+                                         partial_row_height_);
         }
     }
 }
@@ -257,12 +386,12 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 // blocks into a region.
 // The goal is to minimize the region that covers the dirty blocks.
 //
-void Differ::mergeBlocks(Region* dirty_region)
+void Differ::mergeBlocks(int first_row, int last_row, Region* dirty_region)
 {
-    uint8_t* is_diff_row_start = diff_info_.get();
     const int diff_stride = diff_width_;
+    uint8_t* is_diff_row_start = diff_info_.get() + first_row * diff_stride;
 
-    for (int y = 0; y < diff_height_; ++y)
+    for (int y = first_row; y < last_row; ++y)
     {
         uint8_t* is_different = is_diff_row_start;
 
@@ -292,13 +421,13 @@ void Differ::mergeBlocks(Region* dirty_region)
 
                 // Group with blocks below.
                 // The entire width of blocks that we matched above much match
-                // for each row that we add.
+                // for each row that we add. The rows of the next band are not
+                // touched, they can be merged by another thread at the same time.
                 uint8_t* bottom = is_different;
-                bool found_new_row;
+                bool found_new_row = true;
 
-                do
+                while (found_new_row && y + height < last_row)
                 {
-                    found_new_row = true;
                     bottom += diff_stride;
                     right = bottom;
 
@@ -321,7 +450,7 @@ void Differ::mergeBlocks(Region* dirty_region)
                             *right++ = 0;
                         }
                     }
-                } while (found_new_row);
+                }
 
                 Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
                                                  width * kBlockSize, height * kBlockSize);
@@ -347,14 +476,50 @@ void Differ::calcDirtyRegion(const uint8_t* prev_image,
 {
     dirty_region->clear();
 
-    // Identify all the blocks that contain changed pixels.
-    markDirtyBlocks(prev_image, curr_image);
+    if (band_regions_.empty())
+    {
+        // Identify all the blocks that contain changed pixels.
+        markDirtyBlocks(prev_image, curr_image, 0, block_rows_);
+
+        //
+        // Now that we've identified the blocks that have changed, merge adjacent
+        // blocks to minimize the number of rects that we return.
+        //
+        mergeBlocks(0, block_rows_, dirty_region);
+
+        // The current image becomes the previous one on the next call.
+        row_hashes_valid_ = true;
+        return;
+    }
 
-    //
-    // Now that we've identified the blocks that have changed, merge adjacent
-    // blocks to minimize the number of rects that we return.
-    //
-    mergeBlocks(dirty_region);
+    const int band_count = static_cast<int>(band_regions_.size());
+
+    auto process_band = [&](int band_index)
+    {
+        const int first_row = block_rows_ * band_index / band_count;
+        const int last_row = block_rows_ * (band_index + 1) / band_count;
+
+        Region* band_region = &band_regions_[band_index];
+        band_region->clear();
+
+        // Each band uses its own rows of |diff_info_|.
+        markDirtyBlocks(prev_image, curr_image, first_row, last_row);
+        mergeBlocks(first_row, last_row, band_region);
+    };
+
+#if defined(USE_TBB)
+    tbb::parallel_for(0, band_count, process_band);
+#else // defined(USE_TBB)
+    for (int i = 0; i < band_count; ++i)
+        process_band(i);
+#endif // defined(USE_*)
+
+    // Stitch the bands. The rectangles cut at the band boundaries are joined by the region, which
+    // keeps the same representation for the same set of pixels as in the serial mode.
+    for (const auto& band_region : band_regions_)
+        dirty_region->addRegion(band_region);
+
+    row_hashes_valid_ = true;
 }
 
 } // namespace desktop
@@ -24,6 +24,7 @@
 #include "desktop/pixel_format.h"
 
 #include <memory>
+#include <vector>
 
 namespace desktop {
 
@@ -31,9 +32,22 @@ namespace desktop {
 class Differ
 {
 public:
-    Differ(const Size& size, const PixelFormat& format);
+    enum class Mode
+    {
+        // The screen is compared on the calling thread.
+        SERIAL,
+
+        // The rows of blocks are split into bands which are compared in parallel. The result is
+        // the same as in the serial mode. Small screens are compared in one band.
+        PARALLEL
+    };
+
+    Differ(const Size& size, const PixelFormat& format, Mode mode = Mode::PARALLEL);
     ~Differ() = default;
 
+    // Calculates the region in which |curr_image| differs from |prev_image|. |prev_image| must
+    // contain the same pixels as |curr_image| of the previous call, the differ keeps the checksums
+    // of its rows.
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          Region* changed_region);
@@ -41,11 +55,27 @@ public:
 private:
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
 
+    typedef uint8_t(*DiffPartialBlockFunc)(const uint8_t*, const uint8_t*, int, int, int);
+    typedef uint64_t(*HashRowFunc)(const uint8_t*, int);
+
     static DiffFullBlockFunc diffFunctionFor32bpp();
     static DiffFullBlockFunc diffFunctionFor16bpp();
+    static DiffPartialBlockFunc diffPartialFunction(int full_blocks_x);
+    static HashRowFunc hashRowFunction();
+
+    // Calculates the checksums of the pixel rows of |curr_image| in the row of blocks |block_row|
+    // and stores them. Returns true if any of the checksums differs from the previous frame.
+    bool updateRowHashes(const uint8_t* curr_image, int block_row);
 
-    void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
-    void mergeBlocks(Region* dirty_region);
+    // Marks the changed blocks in the rows of blocks from |first_row| to |last_row| (exclusive).
+    void markDirtyBlocks(const uint8_t* prev_image,
+                         const uint8_t* curr_image,
+                         int first_row,
+                         int last_row);
+
+    // Merges the changed blocks in the rows from |first_row| to |last_row| (exclusive) into
+    // rectangles. The rectangles do not cross the bounds of the rows.
+    void mergeBlocks(int first_row, int last_row, Region* dirty_region);
 
     const Rect screen_rect_;
 
@@ -64,9 +94,25 @@ private:
     const int diff_width_;
     const int diff_height_;
 
+    // Number of rows of blocks that contain pixels.
+    const int block_rows_;
+
+    // Regions of the bands in the parallel mode. Empty if the screen is compared in one band.
+    std::vector<Region> band_regions_;
+
     std::unique_ptr<uint8_t[]> diff_info_;
 
     DiffFullBlockFunc diff_full_block_func_;
+    DiffPartialBlockFunc diff_partial_block_func_;
+
+    // Checksums of the pixel rows of the previous image. The blocks are compared only in the rows
+    // of blocks in which the checksums have changed. Null if the CPU can not calculate them fast.
+    // A change of a row which keeps its 64-bit checksum is missed until the next change of the
+    // row. The checksum is not cryptographic, but such a change of the screen is very unlikely
+    // (about 2^-64 per changed row) and is not caused by a change of a few bytes.
+    HashRowFunc hash_row_func_;
+    std::unique_ptr<uint64_t[]> row_hashes_;
+    bool row_hashes_valid_ = false;
 
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
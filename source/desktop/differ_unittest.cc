@@ -0,0 +1,230 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/differ.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const int kBytesPerPixel = 4;
+const int kChangedRectCount = 64;
+const int kBenchmarkIterations = 100;
+
+class Screen
+{
+public:
+    explicit Screen(const Size& size)
+        : size_(size),
+          stride_(size.width() * kBytesPerPixel),
+          prev_(std::make_unique<uint8_t[]>(stride_ * size.height())),
+          curr_(std::make_unique<uint8_t[]>(stride_ * size.height()))
+    {
+        std::uniform_int_distribution<int> byte(0, 255);
+
+        for (int i = 0; i < stride_ * size.height(); ++i)
+            prev_[i] = static_cast<uint8_t>(byte(random_));
+
+        memcpy(curr_.get(), prev_.get(), stride_ * size.height());
+    }
+
+    // Changes random pixels and rectangles of the current image.
+    void change()
+    {
+        std::uniform_int_distribution<int> x(0, size_.width() - 1);
+        std::uniform_int_distribution<int> y(0, size_.height() - 1);
+        std::uniform_int_distribution<int> length(1, 300);
+
+        for (int i = 0; i < kChangedRectCount; ++i)
+        {
+            const int left = x(random_);
+            const int top = y(random_);
+            const int right = std::min(left + length(random_), size_.width());
+            const int bottom = std::min(top + length(random_), size_.height());
+
+            for (int row = top; row < bottom; ++row)
+            {
+                uint8_t* pixel = curr_.get() + row * stride_ + left * kBytesPerPixel;
+
+                for (int column = left; column < right; ++column)
+                {
+                    pixel[0] ^= 0xFF;
+                    pixel += kBytesPerPixel;
+                }
+            }
+        }
+
+        // Single pixels in the partial blocks.
+        curr_[stride_ * size_.height() - 1] ^= 0xFF;
+        curr_[stride_ - 1] ^= 0xFF;
+    }
+
+    // Makes the current image the previous one.
+    void advance()
+    {
+        memcpy(prev_.get(), curr_.get(), stride_ * size_.height());
+    }
+
+    const uint8_t* prev() const { return prev_.get(); }
+    const uint8_t* curr() const { return curr_.get(); }
+
+private:
+    const Size size_;
+    const int stride_;
+    std::unique_ptr<uint8_t[]> prev_;
+    std::unique_ptr<uint8_t[]> curr_;
+    std::mt19937 random_;
+
+    DISALLOW_COPY_AND_ASSIGN(Screen);
+};
+
+void compareModes(const Size& size)
+{
+    Screen screen(size);
+    screen.change();
+
+    Differ serial_differ(size, PixelFormat::ARGB(), Differ::Mode::SERIAL);
+    Differ parallel_differ(size, PixelFormat::ARGB(), Differ::Mode::PARALLEL);
+
+    Region serial_region;
+    Region parallel_region;
+
+    serial_differ.calcDirtyRegion(screen.prev(), screen.curr(), &serial_region);
+    parallel_differ.calcDirtyRegion(screen.prev(), screen.curr(), &parallel_region);
+
+    EXPECT_FALSE(serial_region.isEmpty());
+    EXPECT_TRUE(serial_region.equals(parallel_region));
+}
+
+// The differ which keeps the checksums of the rows must find the same changes as a new one.
+void compareSequence(const Size& size, Differ::Mode mode)
+{
+    Screen screen(size);
+    Differ differ(size, PixelFormat::ARGB(), mode);
+
+    for (int i = 0; i < 5; ++i)
+    {
+        screen.change();
+
+        Region region;
+        differ.calcDirtyRegion(screen.prev(), screen.curr(), &region);
+
+        Differ new_differ(size, PixelFormat::ARGB(), Differ::Mode::SERIAL);
+        Region expected_region;
+        new_differ.calcDirtyRegion(screen.prev(), screen.curr(), &expected_region);
+
+        EXPECT_TRUE(region.equals(expected_region));
+
+        screen.advance();
+    }
+
+    // No changes.
+    Region region;
+    differ.calcDirtyRegion(screen.prev(), screen.curr(), &region);
+    EXPECT_TRUE(region.isEmpty());
+}
+
+// If |changed| is true, then the images are swapped on each frame and all the changes are found
+// each time. Otherwise, the screen does not change after the first frame.
+std::chrono::milliseconds measure(
+    const Screen& screen, const Size& size, Differ::Mode mode, bool changed)
+{
+    Differ differ(size, PixelFormat::ARGB(), mode);
+    Region region;
+
+    const auto begin_time = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < kBenchmarkIterations; ++i)
+    {
+        if (changed && (i & 1))
+            differ.calcDirtyRegion(screen.curr(), screen.prev(), &region);
+        else if (changed || !i)
+            differ.calcDirtyRegion(screen.prev(), screen.curr(), &region);
+        else
+            differ.calcDirtyRegion(screen.curr(), screen.curr(), &region);
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - begin_time);
+}
+
+void benchmark(const Size& size)
+{
+    Screen screen(size);
+    screen.change();
+
+    for (bool changed : { true, false })
+    {
+        const std::chrono::milliseconds serial_time =
+            measure(screen, size, Differ::Mode::SERIAL, changed);
+        const std::chrono::milliseconds parallel_time =
+            measure(screen, size, Differ::Mode::PARALLEL, changed);
+
+        std::cout << size.width() << "x" << size.height()
+                  << (changed ? " (changed): " : " (static): ")
+                  << "serial " << serial_time.count() << " ms, "
+                  << "parallel " << parallel_time.count() << " ms "
+                  << "(" << kBenchmarkIterations << " frames)" << std::endl;
+    }
+}
+
+} // namespace
+
+TEST(differ_test, parallel_same_as_serial)
+{
+    compareModes(Size(1920, 1080));
+    compareModes(Size(3840, 2160));
+    compareModes(Size(5120, 1440));
+}
+
+TEST(differ_test, parallel_same_as_serial_partial_blocks)
+{
+    compareModes(Size(1366, 771));
+    compareModes(Size(2557, 1437));
+    compareModes(Size(641, 257));
+}
+
+TEST(differ_test, sequence_of_frames)
+{
+    compareSequence(Size(1920, 1080), Differ::Mode::SERIAL);
+    compareSequence(Size(1920, 1080), Differ::Mode::PARALLEL);
+    compareSequence(Size(1366, 771), Differ::Mode::PARALLEL);
+}
+
+TEST(differ_test, DISABLED_benchmark_1080p)
+{
+    benchmark(Size(1920, 1080));
+}
+
+TEST(differ_test, DISABLED_benchmark_4k)
+{
+    benchmark(Size(3840, 2160));
+}
+
+TEST(differ_test, DISABLED_benchmark_8k)
+{
+    benchmark(Size(7680, 4320));
+}
+
+} // namespace desktop
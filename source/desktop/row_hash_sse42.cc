@@ -0,0 +1,88 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/row_hash_sse42.h"
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <nmmintrin.h>
+#endif
+
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+// Odd constant for the multiplication of the words of the second chain (the 64-bit golden ratio).
+const uint64_t kMixMultiplier = 0x9E3779B97F4A7C15ULL;
+
+// Adds |word| to |crc|.
+uint32_t crc32Word(uint32_t crc, uint64_t word)
+{
+#if defined(ARCH_CPU_X86_64)
+    return static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+#else
+    return _mm_crc32_u32(_mm_crc32_u32(crc, static_cast<uint32_t>(word)),
+                         static_cast<uint32_t>(word >> 32));
+#endif
+}
+
+} // namespace
+
+uint64_t hashRow_SSE42(const uint8_t* data, int size)
+{
+    // Both chains get each word of the data, so each word changes all 64 bits of the checksum.
+    // CRC32C is linear: a chain of the same words would collide together with the first one. The
+    // second chain gets the words multiplied by an odd constant, which is not linear in the bits
+    // of the word. The chains are independent and hide the latency of the CRC32 instruction.
+    uint32_t crc1 = 0xFFFFFFFF;
+    uint32_t crc2 = 0xFFFFFFFF;
+
+    const uint8_t* end = data + size;
+    uint64_t word;
+
+    while (end - data >= 8)
+    {
+        memcpy(&word, data, sizeof(word));
+
+        crc1 = crc32Word(crc1, word);
+        crc2 = crc32Word(crc2, word * kMixMultiplier);
+
+        data += 8;
+    }
+
+    if (data < end)
+    {
+        // The tail is padded with zeros. The size is added below, so the padding does not collide
+        // with the data of the longer rows.
+        word = 0;
+        memcpy(&word, data, static_cast<size_t>(end - data));
+
+        crc1 = crc32Word(crc1, word);
+        crc2 = crc32Word(crc2, word * kMixMultiplier);
+    }
+
+    crc2 = _mm_crc32_u32(crc2, static_cast<uint32_t>(size));
+
+    return (static_cast<uint64_t>(crc1) << 32) | crc2;
+}
+
+} // namespace desktop
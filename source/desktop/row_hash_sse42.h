@@ -0,0 +1,33 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__ROW_HASH_SSE42_H
+#define DESKTOP__ROW_HASH_SSE42_H
+
+#include <cstdint>
+
+namespace desktop {
+
+// Calculates a 64-bit checksum of |size| bytes of |data|. The checksum consists of two CRC32C
+// values of all 8-byte words of the data, the words of the second one are mixed by a
+// multiplication. The checksum is not cryptographic. Requires SSE4.2.
+uint64_t hashRow_SSE42(const uint8_t* data, int size);
+
+} // namespace desktop
+
+#endif // DESKTOP__ROW_HASH_SSE42_H
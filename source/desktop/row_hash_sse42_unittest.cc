@@ -0,0 +1,119 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/row_hash_sse42.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <vector>
+
+namespace desktop {
+
+namespace {
+
+const int kRowSize = 1366 * 4 + 7;
+
+std::vector<uint8_t> generateRow(int size)
+{
+    std::vector<uint8_t> row(size);
+
+    for (int i = 0; i < size; ++i)
+        row[i] = static_cast<uint8_t>(i * 7);
+
+    return row;
+}
+
+} // namespace
+
+TEST(row_hash_sse42, same_data)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        return;
+
+    std::vector<uint8_t> row1 = generateRow(kRowSize);
+    std::vector<uint8_t> row2 = row1;
+
+    for (int size = 0; size <= kRowSize; size += 13)
+        EXPECT_EQ(hashRow_SSE42(row1.data(), size), hashRow_SSE42(row2.data(), size));
+}
+
+TEST(row_hash_sse42, changed_byte)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        return;
+
+    std::vector<uint8_t> row = generateRow(kRowSize);
+    const uint64_t hash = hashRow_SSE42(row.data(), kRowSize);
+
+    // A change of any byte (including the bytes of the tail) must change the checksum.
+    for (int i = 0; i < kRowSize; ++i)
+    {
+        row[i] ^= 0x01;
+        EXPECT_NE(hash, hashRow_SSE42(row.data(), kRowSize)) << "byte " << i;
+        row[i] ^= 0x01;
+    }
+}
+
+TEST(row_hash_sse42, swapped_words)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        return;
+
+    std::vector<uint8_t> row = generateRow(kRowSize);
+    const uint64_t hash = hashRow_SSE42(row.data(), kRowSize);
+
+    // The order of the words matters.
+    std::swap_ranges(row.begin(), row.begin() + 8, row.begin() + 16);
+    EXPECT_NE(hash, hashRow_SSE42(row.data(), kRowSize));
+}
+
+TEST(row_hash_sse42, changed_byte_changes_both_halves)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        return;
+
+    std::vector<uint8_t> row = generateRow(kRowSize);
+    const uint64_t hash = hashRow_SSE42(row.data(), kRowSize);
+
+    // Each byte goes to both CRC32C chains.
+    for (int i = 0; i < kRowSize; ++i)
+    {
+        row[i] ^= 0x80;
+
+        const uint64_t changed_hash = hashRow_SSE42(row.data(), kRowSize);
+        EXPECT_NE(hash >> 32, changed_hash >> 32) << "byte " << i;
+        EXPECT_NE(hash & 0xFFFFFFFF, changed_hash & 0xFFFFFFFF) << "byte " << i;
+
+        row[i] ^= 0x80;
+    }
+}
+
+TEST(row_hash_sse42, padded_tail)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        return;
+
+    // The row with the zero byte at the end differs from the shorter row.
+    std::vector<uint8_t> row(13, 0x5A);
+    row.back() = 0;
+
+    EXPECT_NE(hashRow_SSE42(row.data(), 12), hashRow_SSE42(row.data(), 13));
+}
+
+} // namespace desktop
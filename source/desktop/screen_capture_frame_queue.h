@@ -27,10 +27,15 @@ namespace desktop {
 
 class Frame;
 
-template <typename FrameType>
+// Queue of |kQueueLength| frames which are used in turn. With more than two frames, the consumer
+// can keep the previous frames (e.g. a SharedFrame clone passed to the encoder) while the capturer
+// writes the next ones. The capturer must not write to a frame that is still shared.
+template <typename FrameType, int kQueueLength = 2>
 class ScreenCaptureFrameQueue
 {
 public:
+    static_assert(kQueueLength >= 2);
+
     ScreenCaptureFrameQueue() = default;
 
     // Moves to the next frame in the queue, moving the 'current' frame to become the 'previous'
@@ -66,7 +71,6 @@ private:
     // Index of the current frame.
     int current_ = 0;
 
-    static const int kQueueLength = 2;
     std::unique_ptr<FrameType> frames_[kQueueLength];
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCaptureFrameQueue);
@@ -19,7 +19,7 @@
 #ifndef DESKTOP__SCREEN_CAPTURER_H
 #define DESKTOP__SCREEN_CAPTURER_H
 
-#include "desktop/desktop_frame.h"
+#include "desktop/shared_desktop_frame.h"
 
 #include <QList>
 #include <QString>
@@ -46,10 +46,15 @@ public:
     static const ScreenId kFullDesktopScreenId = -1;
     static const ScreenId kInvalidScreenId = -2;
 
+    // The capturers use the frames in turn. A frame returned by captureFrame() is not changed by
+    // the next kFrameQueueLength - 1 calls of captureFrame(), so the consumer can keep a clone of
+    // the frame (see SharedFrame::share()) during this time, e.g. to encode it on another thread.
+    static const int kFrameQueueLength = 3;
+
     virtual int screenCount() = 0;
     virtual bool screenList(ScreenList* screens) = 0;
     virtual bool selectScreen(ScreenId screen_id) = 0;
-    virtual const Frame* captureFrame(Error* error) = 0;
+    virtual const SharedFrame* captureFrame(Error* error) = 0;
 
 protected:
     friend class ScreenCapturerWrapper;
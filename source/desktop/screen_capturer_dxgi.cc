@@ -142,7 +142,7 @@ bool ScreenCapturerDxgi::selectScreen(ScreenId screen_id)
     return true;
 }
 
-const Frame* ScreenCapturerDxgi::captureFrame(Error* error)
+const SharedFrame* ScreenCapturerDxgi::captureFrame(Error* error)
 {
     DCHECK(error);
 
@@ -46,7 +46,7 @@ public:
     int screenCount() override;
     bool screenList(ScreenList* screens) override;
     bool selectScreen(ScreenId screen_id) override;
-    const Frame* captureFrame(Error* error) override;
+    const SharedFrame* captureFrame(Error* error) override;
 
 protected:
     // ScreenCapturer implementation.
@@ -56,7 +56,7 @@ private:
     std::shared_ptr<DxgiDuplicatorController> controller_;
 
     ScreenId current_screen_id_ = kFullDesktopScreenId;
-    ScreenCaptureFrameQueue<DxgiFrame> queue_;
+    ScreenCaptureFrameQueue<DxgiFrame, kFrameQueueLength> queue_;
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerDxgi);
 };
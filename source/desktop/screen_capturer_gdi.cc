@@ -54,11 +54,11 @@ bool ScreenCapturerGdi::selectScreen(ScreenId screen_id)
     return true;
 }
 
-const Frame* ScreenCapturerGdi::captureFrame(Error* error)
+const SharedFrame* ScreenCapturerGdi::captureFrame(Error* error)
 {
     DCHECK(error);
 
-    const Frame* frame = captureImage();
+    const SharedFrame* frame = captureImage();
     if (!frame)
     {
         *error = Error::TEMPORARY;
@@ -76,7 +76,7 @@ void ScreenCapturerGdi::reset()
     memory_dc_.reset();
 }
 
-const Frame* ScreenCapturerGdi::captureImage()
+const SharedFrame* ScreenCapturerGdi::captureImage()
 {
     queue_.moveToNextFrame();
 
@@ -103,13 +103,14 @@ const Frame* ScreenCapturerGdi::captureImage()
             return nullptr;
         }
 
-        queue_.replaceCurrentFrame(std::move(frame));
+        queue_.replaceCurrentFrame(SharedFrame::wrap(std::move(frame)));
     }
 
-    FrameDib* current = static_cast<FrameDib*>(queue_.currentFrame());
-    FrameDib* previous = static_cast<FrameDib*>(queue_.previousFrame());
+    SharedFrame* current = queue_.currentFrame();
+    SharedFrame* previous = queue_.previousFrame();
 
-    base::win::ScopedSelectObject select_object(memory_dc_, current->bitmap());
+    base::win::ScopedSelectObject select_object(
+        memory_dc_, static_cast<FrameDib*>(current->underlyingFrame())->bitmap());
 
     BitBlt(memory_dc_,
            0, 0,
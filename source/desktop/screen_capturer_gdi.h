@@ -37,14 +37,14 @@ public:
     int screenCount() override;
     bool screenList(ScreenList* screens) override;
     bool selectScreen(ScreenId screen_id) override;
-    const Frame* captureFrame(Error* error) override;
+    const SharedFrame* captureFrame(Error* error) override;
 
 protected:
     // ScreenCapturer implementation.
     void reset() override;
 
 private:
-    const Frame* captureImage();
+    const SharedFrame* captureImage();
     bool prepareCaptureResources();
 
     ScreenId current_screen_id_ = kFullDesktopScreenId;
@@ -57,7 +57,7 @@ private:
     std::unique_ptr<base::win::ScopedGetDC> desktop_dc_;
     base::win::ScopedCreateDC memory_dc_;
 
-    ScreenCaptureFrameQueue<Frame> queue_;
+    ScreenCaptureFrameQueue<SharedFrame, kFrameQueueLength> queue_;
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCapturerGdi);
 };
@@ -71,7 +71,7 @@ bool ScreenCapturerMirror::selectScreen(ScreenId screen_id)
     return true;
 }
 
-const Frame* ScreenCapturerMirror::captureFrame(Error* error)
+const SharedFrame* ScreenCapturerMirror::captureFrame(Error* error)
 {
     DCHECK(error);
 
@@ -174,14 +174,22 @@ ScreenCapturerMirror::Error ScreenCapturerMirror::prepareCaptureResources()
         updateExcludeRegion();
     }
 
-    if (!frame_)
+    // Only the changed areas are copied into the frame, so there is only one frame. If a clone
+    // of the frame is still used by the consumer, we continue with a copy of the frame.
+    if (!frame_ || frame_->isShared())
     {
-        frame_ = FrameAligned::create(screen_rect.size(), PixelFormat::ARGB(), 32);
-        if (!frame_)
+        std::unique_ptr<Frame> frame =
+            FrameAligned::create(screen_rect.size(), PixelFormat::ARGB(), 32);
+        if (!frame)
         {
             LOG(LS_WARNING) << "Failed to create frame";
             return Error::PERMANENT;
         }
+
+        if (frame_)
+            frame->copyPixelsFrom(*frame_, Point(), Rect::makeSize(frame_->size()));
+
+        frame_ = SharedFrame::wrap(std::move(frame));
     }
 
     return Error::SUCCEEDED;
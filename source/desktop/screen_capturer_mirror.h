@@ -37,7 +37,7 @@ public:
     int screenCount() override;
     bool screenList(ScreenList* screens) override;
     bool selectScreen(ScreenId screen_id) override;
-    const Frame* captureFrame(Error* error) override;
+    const SharedFrame* captureFrame(Error* error) override;
 
 protected:
     // ScreenCapturer implementation.
@@ -48,7 +48,7 @@ private:
     Error prepareCaptureResources();
 
     std::unique_ptr<MirrorHelper> helper_;
-    std::unique_ptr<Frame> frame_;
+    std::unique_ptr<SharedFrame> frame_;
 
     ScreenId current_screen_id_ = kFullDesktopScreenId;
     QString current_device_key_;
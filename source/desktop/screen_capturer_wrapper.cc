@@ -63,7 +63,7 @@ bool ScreenCapturerWrapper::selectScreen(ScreenCapturer::ScreenId screen_id)
     return capturer_->selectScreen(screen_id);
 }
 
-const Frame* ScreenCapturerWrapper::captureFrame()
+const SharedFrame* ScreenCapturerWrapper::captureFrame()
 {
     DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
 
@@ -71,7 +71,7 @@ const Frame* ScreenCapturerWrapper::captureFrame()
         atDesktopSwitch();
 
     ScreenCapturer::Error error;
-    const Frame* frame = capturer_->captureFrame(&error);
+    const SharedFrame* frame = capturer_->captureFrame(&error);
     if (!frame)
     {
         switch (error)
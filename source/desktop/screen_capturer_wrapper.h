@@ -47,7 +47,7 @@ public:
     int screenCount();
     bool screenList(ScreenCapturer::ScreenList* screens);
     bool selectScreen(ScreenCapturer::ScreenId screen_id);
-    const Frame* captureFrame();
+    const SharedFrame* captureFrame();
 
 private:
     void selectCapturer();
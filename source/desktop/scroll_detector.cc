@@ -0,0 +1,259 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/scroll_detector.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+#include "desktop/row_hash_sse42.h"
+
+#include <libyuv/cpu_id.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace desktop {
+
+namespace {
+
+// Minimum width and height of the updated rectangle in which the moved area is searched.
+const int kMinRectSize = 64;
+
+// Minimum number of the rows (or columns for a horizontal move) in the moved area.
+const int kMinMovedLines = 32;
+
+// A shift is checked only if it is confirmed by at least 1/kMinVotesDivider of the lines.
+const int kMinVotesDivider = 8;
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t hashRow_C(const uint8_t* data, int size)
+{
+    uint64_t hash = kFnvOffsetBasis;
+
+    for (int i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * kFnvPrime;
+
+    return hash;
+}
+
+uint32_t readPixel(const uint8_t* data, int bytes_per_pixel)
+{
+    uint32_t pixel = 0;
+    memcpy(&pixel, data, bytes_per_pixel);
+    return pixel;
+}
+
+} // namespace
+
+ScrollDetector::ScrollDetector()
+{
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE42))
+        hash_row_func_ = hashRow_SSE42;
+    else
+        hash_row_func_ = hashRow_C;
+}
+
+bool ScrollDetector::detect(const Frame& prev, const Frame& curr,
+                            Rect* source_rect, Point* dest_pos)
+{
+    DCHECK(source_rect);
+    DCHECK(dest_pos);
+
+    if (prev.size() != curr.size() || prev.format() != curr.format())
+        return false;
+
+    // Usually the scrolled window is the largest updated area.
+    Rect rect;
+
+    for (Region::Iterator it(curr.constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    {
+        const Rect& current = it.rect();
+
+        if (static_cast<int64_t>(current.width()) * current.height() >
+            static_cast<int64_t>(rect.width()) * rect.height())
+        {
+            rect = current;
+        }
+    }
+
+    rect.intersectWith(Rect::makeSize(curr.size()));
+
+    if (rect.width() < kMinRectSize || rect.height() < kMinRectSize)
+        return false;
+
+    Rect moved_rect;
+    int dx = 0;
+    int dy = 0;
+
+    hashRows(prev, rect, &prev_hashes_);
+    hashRows(curr, rect, &curr_hashes_);
+
+    if (findShift(prev_hashes_, curr_hashes_, &dy))
+        moved_rect = matchingRows(prev, curr, rect, 0, dy);
+
+    if (moved_rect.height() < kMinMovedLines)
+    {
+        dy = 0;
+        moved_rect = Rect();
+
+        hashColumns(prev, rect, &prev_hashes_);
+        hashColumns(curr, rect, &curr_hashes_);
+
+        if (findShift(prev_hashes_, curr_hashes_, &dx))
+            moved_rect = matchingRows(prev, curr, rect, dx, 0);
+
+        if (moved_rect.width() < kMinMovedLines || moved_rect.height() < kMinMovedLines)
+            return false;
+    }
+
+    *source_rect = Rect::makeXYWH(moved_rect.x() - dx, moved_rect.y() - dy,
+                                  moved_rect.width(), moved_rect.height());
+    *dest_pos = moved_rect.topLeft();
+    return true;
+}
+
+bool ScrollDetector::findShift(const std::vector<uint64_t>& prev_hashes,
+                               const std::vector<uint64_t>& curr_hashes,
+                               int* shift)
+{
+    DCHECK_EQ(prev_hashes.size(), curr_hashes.size());
+
+    const int count = static_cast<int>(curr_hashes.size());
+
+    // Lines which occur several times (for example, the lines of the background) do not tell where
+    // they were moved from. Such lines have the index -1.
+    std::unordered_map<uint64_t, int> prev_lines;
+    prev_lines.reserve(count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        auto result = prev_lines.emplace(prev_hashes[i], i);
+        if (!result.second)
+            result.first->second = -1;
+    }
+
+    // The index of the vote is the shift plus |count| - 1.
+    votes_.assign(count * 2 - 1, 0);
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (curr_hashes[i] == prev_hashes[i])
+            continue;
+
+        auto it = prev_lines.find(curr_hashes[i]);
+        if (it == prev_lines.end() || it->second == -1)
+            continue;
+
+        ++votes_[i - it->second + count - 1];
+    }
+
+    int best_index = 0;
+
+    for (int i = 1; i < static_cast<int>(votes_.size()); ++i)
+    {
+        if (votes_[i] > votes_[best_index])
+            best_index = i;
+    }
+
+    if (votes_[best_index] < std::max(count / kMinVotesDivider, 1))
+        return false;
+
+    *shift = best_index - count + 1;
+    return true;
+}
+
+// static
+Rect ScrollDetector::matchingRows(const Frame& prev, const Frame& curr, const Rect& rect,
+                                  int dx, int dy)
+{
+    // The area of |rect| which has the source pixels inside |rect|.
+    const int left = std::max(rect.left(), rect.left() + dx);
+    const int right = std::min(rect.right(), rect.right() + dx);
+    const int top = std::max(rect.top(), rect.top() + dy);
+    const int bottom = std::min(rect.bottom(), rect.bottom() + dy);
+
+    if (left >= right || top >= bottom)
+        return Rect();
+
+    const size_t bytes_per_row = (right - left) * curr.format().bytesPerPixel();
+
+    int best_top = 0;
+    int best_height = 0;
+    int run_top = top;
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        if (y < bottom && memcmp(curr.frameDataAtPos(left, y),
+                                 prev.frameDataAtPos(left - dx, y - dy),
+                                 bytes_per_row) == 0)
+        {
+            continue;
+        }
+
+        if (y - run_top > best_height)
+        {
+            best_top = run_top;
+            best_height = y - run_top;
+        }
+
+        run_top = y + 1;
+    }
+
+    if (!best_height)
+        return Rect();
+
+    return Rect::makeLTRB(left, best_top, right, best_top + best_height);
+}
+
+void ScrollDetector::hashRows(const Frame& frame, const Rect& rect,
+                              std::vector<uint64_t>* hashes) const
+{
+    const int bytes_per_row = rect.width() * frame.format().bytesPerPixel();
+
+    hashes->resize(rect.height());
+
+    for (int y = 0; y < rect.height(); ++y)
+        (*hashes)[y] = hash_row_func_(frame.frameDataAtPos(rect.left(), rect.top() + y),
+                                      bytes_per_row);
+}
+
+// static
+void ScrollDetector::hashColumns(const Frame& frame, const Rect& rect,
+                                 std::vector<uint64_t>* hashes)
+{
+    const int bytes_per_pixel = frame.format().bytesPerPixel();
+
+    hashes->assign(rect.width(), kFnvOffsetBasis);
+
+    // The frame is read row by row, each pixel is added to the checksum of its column.
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        const uint8_t* pixel = frame.frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            (*hashes)[x] = ((*hashes)[x] ^ readPixel(pixel, bytes_per_pixel)) * kFnvPrime;
+            pixel += bytes_per_pixel;
+        }
+    }
+}
+
+} // namespace desktop
@@ -0,0 +1,75 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__SCROLL_DETECTOR_H
+#define DESKTOP__SCROLL_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+
+// Detects the areas which were moved on the screen (a window is scrolled or dragged). The
+// largest rectangle of the updated region of the current frame is compared with the previous
+// frame shifted vertically and horizontally. The shift is chosen by matching the checksums of the
+// rows (or columns) of the rectangle, then the matching rows are compared exactly.
+class ScrollDetector
+{
+public:
+    ScrollDetector();
+    ~ScrollDetector() = default;
+
+    // Searches the updated region of |curr| for an area which is equal to the area |source_rect|
+    // of |prev| moved to |dest_pos|. The frames must have the same size and format. Returns false
+    // if no large enough area is found.
+    bool detect(const Frame& prev, const Frame& curr, Rect* source_rect, Point* dest_pos);
+
+private:
+    typedef uint64_t(*HashRowFunc)(const uint8_t*, int);
+
+    // Finds the shift of the lines (rows or columns) which is confirmed by the most lines with
+    // unique checksums.
+    bool findShift(const std::vector<uint64_t>& prev_hashes,
+                   const std::vector<uint64_t>& curr_hashes,
+                   int* shift);
+
+    // Finds the longest run of rows in |rect| of |curr| which are equal to the rows of |prev|
+    // shifted by |dx| and |dy|.
+    static Rect matchingRows(const Frame& prev, const Frame& curr, const Rect& rect,
+                             int dx, int dy);
+
+    void hashRows(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes) const;
+    static void hashColumns(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes);
+
+    HashRowFunc hash_row_func_;
+
+    std::vector<uint64_t> prev_hashes_;
+    std::vector<uint64_t> curr_hashes_;
+    std::vector<int> votes_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScrollDetector);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__SCROLL_DETECTOR_H
@@ -0,0 +1,180 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/scroll_detector.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(320, 240);
+const Rect kWindowRect = Rect::makeLTRB(40, 20, 280, 220);
+
+void fillRandom(std::mt19937* random, Frame* frame, const Rect& rect)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int i = 0; i < rect.width() * frame->format().bytesPerPixel(); ++i)
+            row[i] = static_cast<uint8_t>(byte(*random));
+    }
+}
+
+class Screen
+{
+public:
+    Screen()
+    {
+        prev_ = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+        curr_ = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+        fillRandom(&random_, prev_.get(), Rect::makeSize(kScreenSize));
+        curr_->copyPixelsFrom(*prev_, Point(0, 0), Rect::makeSize(kScreenSize));
+    }
+
+    // Moves the content of |kWindowRect| of the current frame by |dx| and |dy|. The uncovered
+    // area is filled with the new pixels.
+    void moveWindow(int dx, int dy)
+    {
+        Rect dest_rect = kWindowRect;
+        dest_rect.translate(dx, dy);
+        dest_rect.intersectWith(kWindowRect);
+
+        curr_->copyPixelsFrom(*curr_, Point(dest_rect.x() - dx, dest_rect.y() - dy), dest_rect);
+
+        Region uncovered(kWindowRect);
+        uncovered.subtract(dest_rect);
+
+        for (Region::Iterator it(uncovered); !it.isAtEnd(); it.advance())
+            fillRandom(&random_, curr_.get(), it.rect());
+
+        curr_->updatedRegion()->addRect(kWindowRect);
+    }
+
+    // Checks that the detected move turns the previous frame into the current one.
+    void checkMove(const Rect& source_rect, const Point& dest_pos)
+    {
+        Rect dest_rect = Rect::makeXYWH(dest_pos, source_rect.size());
+
+        prev_->copyPixelsFrom(*prev_, source_rect.topLeft(), dest_rect);
+
+        for (int y = dest_rect.top(); y < dest_rect.bottom(); ++y)
+        {
+            EXPECT_EQ(0, memcmp(prev_->frameDataAtPos(dest_rect.left(), y),
+                                curr_->frameDataAtPos(dest_rect.left(), y),
+                                dest_rect.width() * prev_->format().bytesPerPixel()));
+        }
+    }
+
+    Frame* prev() const { return prev_.get(); }
+    Frame* curr() const { return curr_.get(); }
+
+    void fillCurr(const Rect& rect) { fillRandom(&random_, curr_.get(), rect); }
+
+private:
+    std::mt19937 random_;
+    std::unique_ptr<Frame> prev_;
+    std::unique_ptr<Frame> curr_;
+};
+
+} // namespace
+
+TEST(scroll_detector_test, scroll_down)
+{
+    Screen screen;
+    screen.moveWindow(0, -17);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    ASSERT_TRUE(detector.detect(*screen.prev(), *screen.curr(), &source_rect, &dest_pos));
+    EXPECT_EQ(Rect::makeLTRB(40, 37, 280, 220), source_rect);
+    EXPECT_EQ(Point(40, 20), dest_pos);
+
+    screen.checkMove(source_rect, dest_pos);
+}
+
+TEST(scroll_detector_test, scroll_up)
+{
+    Screen screen;
+    screen.moveWindow(0, 50);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    ASSERT_TRUE(detector.detect(*screen.prev(), *screen.curr(), &source_rect, &dest_pos));
+    EXPECT_EQ(Rect::makeLTRB(40, 20, 280, 170), source_rect);
+    EXPECT_EQ(Point(40, 70), dest_pos);
+
+    screen.checkMove(source_rect, dest_pos);
+}
+
+TEST(scroll_detector_test, horizontal_move)
+{
+    Screen screen;
+    screen.moveWindow(9, 0);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    ASSERT_TRUE(detector.detect(*screen.prev(), *screen.curr(), &source_rect, &dest_pos));
+    EXPECT_EQ(Rect::makeLTRB(40, 20, 271, 220), source_rect);
+    EXPECT_EQ(Point(49, 20), dest_pos);
+
+    screen.checkMove(source_rect, dest_pos);
+}
+
+TEST(scroll_detector_test, no_move)
+{
+    Screen screen;
+    screen.fillCurr(kWindowRect);
+    screen.curr()->updatedRegion()->addRect(kWindowRect);
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    EXPECT_FALSE(detector.detect(*screen.prev(), *screen.curr(), &source_rect, &dest_pos));
+}
+
+TEST(scroll_detector_test, small_update)
+{
+    Screen screen;
+    screen.moveWindow(0, -17);
+    screen.curr()->updatedRegion()->clear();
+    screen.curr()->updatedRegion()->addRect(Rect::makeXYWH(40, 20, 240, 48));
+
+    ScrollDetector detector;
+    Rect source_rect;
+    Point dest_pos;
+
+    EXPECT_FALSE(detector.detect(*screen.prev(), *screen.curr(), &source_rect, &dest_pos));
+}
+
+} // namespace desktop
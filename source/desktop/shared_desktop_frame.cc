@@ -20,7 +20,7 @@
 
 namespace desktop {
 
-SharedFrame::SharedFrame(std::shared_ptr<Frame>& frame)
+SharedFrame::SharedFrame(const std::shared_ptr<Frame>& frame)
     : Frame(frame->size(), frame->format(), frame->stride(), frame->frameData()),
       frame_(frame)
 {
@@ -41,14 +41,14 @@ bool SharedFrame::shareFrameWith(const SharedFrame& other) const
     return frame_.get() == other.frame_.get();
 }
 
-std::unique_ptr<SharedFrame> SharedFrame::share()
+std::unique_ptr<SharedFrame> SharedFrame::share() const
 {
     std::unique_ptr<SharedFrame> result(new SharedFrame(frame_));
     result->copyFrameInfoFrom(*this);
     return result;
 }
 
-bool SharedFrame::isShared()
+bool SharedFrame::isShared() const
 {
     return !frame_.unique();
 }
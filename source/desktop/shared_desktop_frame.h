@@ -36,15 +36,19 @@ public:
     // Returns whether |this| and |other| share the underlying Frame.
     bool shareFrameWith(const SharedFrame& other) const;
 
-    // Creates a clone of this object.
-    std::unique_ptr<SharedFrame> share();
+    // Creates a clone of this object. The clone has its own copy of the frame information (e.g.
+    // the updated region).
+    std::unique_ptr<SharedFrame> share() const;
 
     // Checks if the frame is currently shared. If it returns false it's guaranteed that there are
     // no clones of the object.
-    bool isShared();
+    bool isShared() const;
+
+    // Returns the frame that owns the buffer.
+    Frame* underlyingFrame() const { return frame_.get(); }
 
 private:
-    SharedFrame(std::shared_ptr<Frame>& frame);
+    SharedFrame(const std::shared_ptr<Frame>& frame);
 
     std::shared_ptr<Frame> frame_;
 
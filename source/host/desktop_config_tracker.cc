@@ -58,6 +58,18 @@ uint32_t DesktopConfigTracker::changesMask(const proto::desktop::Config& new_con
     if (old_config_->compress_ratio() != new_config.compress_ratio())
         result |= HAS_VIDEO;
 
+    if (old_config_->video_features() != new_config.video_features())
+        result |= HAS_VIDEO;
+
+    if (old_config_->encoder_threads() != new_config.encoder_threads())
+        result |= HAS_VIDEO;
+
+    if (old_config_->video_quality() != new_config.video_quality())
+        result |= HAS_VIDEO;
+
+    if (old_config_->scale_factor() != new_config.scale_factor())
+        result |= HAS_VIDEO;
+
     if ((old_config_->flags() & proto::desktop::ENABLE_CURSOR_SHAPE) !=
         (new_config.flags() & proto::desktop::ENABLE_CURSOR_SHAPE))
     {
@@ -69,13 +69,27 @@ void Session::start()
     connect(channel_, &ipc::Channel::disconnected, this, &Session::stop, Qt::QueuedConnection);
     connect(channel_, &ipc::Channel::errorOccurred, this, &Session::stop, Qt::QueuedConnection);
     connect(channel_, &ipc::Channel::messageReceived, this, &Session::messageReceived);
+    connect(channel_, &ipc::Channel::messageWritten, this, &Session::pendingBytesChanged);
+    connect(channel_, &ipc::Channel::forwardPendingBytesChanged,
+            this, &Session::pendingBytesChanged);
 
     channel_->connectToServer(channel_id_);
 }
 
-void Session::sendMessage(const QByteArray& message)
+void Session::sendMessage(const QByteArray& message, base::MessagePriority priority)
 {
-    channel_->send(message);
+    channel_->send(message, priority);
+}
+
+void Session::sendMessage(const google::protobuf::MessageLite& message,
+                          base::MessagePriority priority)
+{
+    channel_->sendMessage(message, priority);
+}
+
+int64_t Session::pendingBytes() const
+{
+    return channel_ ? channel_->pendingBytes() : 0;
 }
 
 void Session::stop()
@@ -20,10 +20,17 @@
 #define HOST__HOST_SESSION_H
 
 #include "base/macros_magic.h"
+#include "base/message_priority.h"
 
 #include <QByteArray>
 #include <QObject>
 
+namespace google {
+namespace protobuf {
+class MessageLite;
+} // namespace protobuf
+} // namespace google
+
 namespace ipc {
 class Channel;
 } // namespace ipc
@@ -43,12 +50,23 @@ public:
 protected:
     explicit Session(const QString& channel_id);
 
-    // Sends outgoing message.
-    void sendMessage(const QByteArray& message);
+    // Sends outgoing message. Messages with a higher |priority| are sent to the client first.
+    void sendMessage(const QByteArray& message,
+                     base::MessagePriority priority = base::MessagePriority::CONTROL);
+    void sendMessage(const google::protobuf::MessageLite& message,
+                     base::MessagePriority priority = base::MessagePriority::CONTROL);
+
+    // Returns the total size of the outgoing messages which are not yet written to the channel or
+    // wait for the network in the service process.
+    int64_t pendingBytes() const;
 
     virtual void sessionStarted() = 0;
     virtual void messageReceived(const QByteArray& buffer) = 0;
 
+    // Called when an outgoing message is written to the channel or the service process reports
+    // the size of its network queue.
+    virtual void pendingBytesChanged() {}
+
 private:
     QString channel_id_;
     ipc::Channel* channel_ = nullptr;
@@ -48,9 +48,19 @@ SessionDesktop::SessionDesktop(proto::SessionType session_type, const QString& c
 
 SessionDesktop::~SessionDesktop() = default;
 
-void SessionDesktop::onScreenUpdate(const QByteArray& message)
+void SessionDesktop::onScreenUpdate(const QByteArray& message, base::MessagePriority priority)
 {
-    sendMessage(message);
+    sendMessage(message, priority);
+
+    if (screen_updater_)
+        screen_updater_->setPendingBytes(pendingBytes());
+}
+
+void SessionDesktop::onScreenScaled(const desktop::Rect& source_rect,
+                                    const desktop::Rect& scaled_rect)
+{
+    source_rect_ = source_rect;
+    scaled_rect_ = scaled_rect;
 }
 
 void SessionDesktop::sessionStarted()
@@ -69,12 +79,13 @@ void SessionDesktop::sessionStarted()
     // Create a configuration request.
     proto::desktop::ConfigRequest* request = outgoing_message_.mutable_config_request();
 
-    // Add supported extensions and video encodings.
+    // Add supported extensions, video encodings and features.
     request->set_extensions(extensions);
     request->set_video_encodings(common::kSupportedVideoEncodings);
+    request->set_video_features(common::kSupportedVideoFeatures);
 
     // Send the request.
-    sendMessage(common::serializeMessage(outgoing_message_));
+    sendMessage(outgoing_message_);
 }
 
 void SessionDesktop::messageReceived(const QByteArray& buffer)
@@ -103,6 +114,12 @@ void SessionDesktop::messageReceived(const QByteArray& buffer)
     }
 }
 
+void SessionDesktop::pendingBytesChanged()
+{
+    if (screen_updater_)
+        screen_updater_->setPendingBytes(pendingBytes());
+}
+
 void SessionDesktop::clipboardEvent(const proto::desktop::ClipboardEvent& event)
 {
     if (session_type_ != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -110,7 +127,7 @@ void SessionDesktop::clipboardEvent(const proto::desktop::ClipboardEvent& event)
 
     outgoing_message_.Clear();
     outgoing_message_.mutable_clipboard_event()->CopyFrom(event);
-    sendMessage(common::serializeMessage(outgoing_message_));
+    sendMessage(outgoing_message_);
 }
 
 void SessionDesktop::readPointerEvent(const proto::desktop::PointerEvent& event)
@@ -122,8 +139,27 @@ void SessionDesktop::readPointerEvent(const proto::desktop::PointerEvent& event)
         return;
     }
 
-    if (input_thread_)
+    if (!input_thread_)
+        return;
+
+    if (scaled_rect_.isEmpty())
+    {
         input_thread_->injectPointerEvent(event);
+        return;
+    }
+
+    // Convert the position in the scaled frame to the position on the screen. The pixel of the
+    // scaled frame is mapped to the source pixel which the scaler takes for it.
+    proto::desktop::PointerEvent screen_event(event);
+
+    screen_event.set_x(source_rect_.x() + static_cast<int32_t>(
+        static_cast<int64_t>(event.x() - scaled_rect_.x()) * source_rect_.width() /
+        scaled_rect_.width()));
+    screen_event.set_y(source_rect_.y() + static_cast<int32_t>(
+        static_cast<int64_t>(event.y() - scaled_rect_.y()) * source_rect_.height() /
+        scaled_rect_.height()));
+
+    input_thread_->injectPointerEvent(screen_event);
 }
 
 void SessionDesktop::readKeyEvent(const proto::desktop::KeyEvent& event)
@@ -220,6 +256,19 @@ void SessionDesktop::readExtension(const proto::desktop::Extension& extension)
     {
         sendSystemInfo();
     }
+    else if (extension.name() == common::kFrameAckExtension)
+    {
+        proto::desktop::FrameAck frame_ack;
+
+        if (!frame_ack.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse frame ack extension data";
+            return;
+        }
+
+        if (screen_updater_)
+            screen_updater_->frameAcknowledged(frame_ack.packet_count());
+    }
     else
     {
         LOG(LS_WARNING) << "Unknown extension: " << extension.name();
@@ -255,6 +304,10 @@ void SessionDesktop::readConfig(const proto::desktop::Config& config)
 
     if (mask & DesktopConfigTracker::HAS_VIDEO)
     {
+        // The new screen updater reports the geometry if it scales the frames.
+        source_rect_ = desktop::Rect();
+        scaled_rect_ = desktop::Rect();
+
         screen_updater_.reset(new ScreenUpdater(this));
 
         if (!screen_updater_->start(config))
@@ -273,7 +326,7 @@ void SessionDesktop::sendSystemInfo()
     extension->set_name(common::kSystemInfoExtension);
     extension->set_data(system_info.SerializeAsString());
 
-    sendMessage(common::serializeMessage(outgoing_message_));
+    sendMessage(outgoing_message_);
 }
 
 } // namespace host
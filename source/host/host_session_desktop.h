@@ -44,12 +44,14 @@ public:
     ~SessionDesktop();
 
     // ScreenUpdater::Delegate implementation.
-    void onScreenUpdate(const QByteArray& message);
+    void onScreenUpdate(const QByteArray& message, base::MessagePriority priority);
+    void onScreenScaled(const desktop::Rect& source_rect, const desktop::Rect& scaled_rect);
 
 protected:
     // Session implementation.
     void sessionStarted() override;
     void messageReceived(const QByteArray& buffer) override;
+    void pendingBytesChanged() override;
 
 private slots:
     void clipboardEvent(const proto::desktop::ClipboardEvent& event);
@@ -72,6 +74,11 @@ private:
 
     DesktopConfigTracker config_tracker_;
 
+    // Geometry of the scaled frames sent to the client. The client sends the pointer positions
+    // in the scaled frame. Empty if the frames are not scaled.
+    desktop::Rect source_rect_;
+    desktop::Rect scaled_rect_;
+
     std::unique_ptr<ScreenUpdater> screen_updater_;
     std::unique_ptr<common::Clipboard> clipboard_;
     std::unique_ptr<InputThread> input_thread_;
@@ -17,6 +17,7 @@
 //
 
 #include "host/host_session_fake_desktop.h"
+#include "codec/video_encoder_hybrid.h"
 #include "codec/video_encoder_vpx.h"
 #include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
@@ -83,15 +84,33 @@ codec::VideoEncoder* SessionFakeDesktop::createEncoder(const proto::desktop::Con
     switch (config.video_encoding())
     {
         case proto::desktop::VIDEO_ENCODING_VP8:
-            return codec::VideoEncoderVPX::createVP8();
+            return codec::VideoEncoderVPX::createVP8(
+                config.encoder_threads(), config.video_quality());
 
         case proto::desktop::VIDEO_ENCODING_VP9:
-            return codec::VideoEncoderVPX::createVP9();
+            return codec::VideoEncoderVPX::createVP9(
+                config.encoder_threads(), config.video_quality());
+
+        case proto::desktop::VIDEO_ENCODING_VP9_I444:
+            return codec::VideoEncoderVPX::createVP9I444(
+                config.encoder_threads(), config.video_quality());
+
+        case proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS:
+            return codec::VideoEncoderVPX::createVP9Lossless(config.encoder_threads());
 
         case proto::desktop::VIDEO_ENCODING_ZSTD:
             return codec::VideoEncoderZstd::create(
-                codec::VideoUtil::fromVideoPixelFormat(
-                    config.pixel_format()), config.compress_ratio());
+                codec::VideoUtil::fromVideoPixelFormat(config.pixel_format()),
+                config.compress_ratio(),
+                config.video_features());
+
+        case proto::desktop::VIDEO_ENCODING_HYBRID:
+            return codec::VideoEncoderHybrid::create(
+                codec::VideoUtil::fromVideoPixelFormat(config.pixel_format()),
+                config.compress_ratio(),
+                config.video_features(),
+                config.encoder_threads(),
+                config.video_quality());
 
         default:
             LOG(LS_WARNING) << "Unsupported video encoding: " << config.video_encoding();
@@ -44,7 +44,7 @@ void SessionFileTransfer::messageReceived(const QByteArray& buffer)
         return;
     }
 
-    sendMessage(common::serializeMessage(worker_->doRequest(request)));
+    sendMessage(worker_->doRequest(request), base::MessagePriority::BULK);
 }
 
 } // namespace host
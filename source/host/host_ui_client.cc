@@ -73,7 +73,7 @@ void UiClient::refresh()
     message.mutable_credentials_request()->set_flags(
         proto::host::CredentialsRequest::REFRESH);
 
-    channel_->send(common::serializeMessage(message));
+    channel_->sendMessage(message);
 }
 
 void UiClient::newPassword()
@@ -86,7 +86,7 @@ void UiClient::newPassword()
     message.mutable_credentials_request()->set_flags(
         proto::host::CredentialsRequest::NEW_PASSWORD);
 
-    channel_->send(common::serializeMessage(message));
+    channel_->sendMessage(message);
 }
 
 void UiClient::killSession(const std::string& uuid)
@@ -96,7 +96,7 @@ void UiClient::killSession(const std::string& uuid)
 
     proto::host::UiToService message;
     message.mutable_kill_session()->set_uuid(uuid);
-    channel_->send(common::serializeMessage(message));
+    channel_->sendMessage(message);
 }
 
 void UiClient::onChannelMessage(const QByteArray& buffer)
@@ -76,14 +76,14 @@ void UiProcess::setConnectEvent(const proto::host::ConnectEvent& event)
 {
     proto::host::ServiceToUi message;
     message.mutable_connect_event()->CopyFrom(event);
-    channel_->send(common::serializeMessage(message));
+    channel_->sendMessage(message);
 }
 
 void UiProcess::setDisconnectEvent(const std::string& uuid)
 {
     proto::host::ServiceToUi message;
     message.mutable_disconnect_event()->set_uuid(uuid);
-    channel_->send(common::serializeMessage(message));
+    channel_->sendMessage(message);
 }
 
 bool UiProcess::start()
@@ -201,7 +201,7 @@ void UiProcess::sendCredentials(uint32_t flags)
         }
     }
 
-    channel_->send(common::serializeMessage(message));
+    channel_->sendMessage(message);
 }
 
 } // namespace host
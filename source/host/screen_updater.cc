@@ -43,12 +43,32 @@ void ScreenUpdater::selectScreen(int64_t screen_id)
     impl_->selectScreen(screen_id);
 }
 
+void ScreenUpdater::setPendingBytes(int64_t pending_bytes)
+{
+    impl_->setPendingBytes(pending_bytes);
+}
+
+void ScreenUpdater::frameAcknowledged(int packet_count)
+{
+    impl_->frameAcknowledged(packet_count);
+}
+
 void ScreenUpdater::customEvent(QEvent* event)
 {
-    if (event->type() != ScreenUpdaterImpl::MessageEvent::kType)
-        return;
+    if (event->type() == ScreenUpdaterImpl::MessageEvent::kType)
+    {
+        ScreenUpdaterImpl::MessageEvent* message_event =
+            static_cast<ScreenUpdaterImpl::MessageEvent*>(event);
+
+        delegate_->onScreenUpdate(message_event->buffer(), message_event->priority());
+    }
+    else if (event->type() == ScreenUpdaterImpl::ScaleEvent::kType)
+    {
+        ScreenUpdaterImpl::ScaleEvent* scale_event =
+            static_cast<ScreenUpdaterImpl::ScaleEvent*>(event);
 
-    delegate_->onScreenUpdate(static_cast<ScreenUpdaterImpl::MessageEvent*>(event)->buffer());
+        delegate_->onScreenScaled(scale_event->sourceRect(), scale_event->scaledRect());
+    }
 }
 
 } // namespace host
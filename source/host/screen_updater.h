@@ -20,6 +20,8 @@
 #define HOST__SCREEN_UPDATER_H
 
 #include "base/macros_magic.h"
+#include "base/message_priority.h"
+#include "desktop/desktop_geometry.h"
 #include "proto/desktop.pb.h"
 
 #include <QObject>
@@ -38,7 +40,13 @@ public:
     public:
         virtual ~Delegate() = default;
 
-        virtual void onScreenUpdate(const QByteArray& message) = 0;
+        virtual void onScreenUpdate(const QByteArray& message,
+                                    base::MessagePriority priority) = 0;
+
+        // Called if the frames are scaled and the client sees |source_rect| of the screen as
+        // |scaled_rect|.
+        virtual void onScreenScaled(const desktop::Rect& source_rect,
+                                    const desktop::Rect& scaled_rect) = 0;
     };
 
     ScreenUpdater(Delegate* delegate, QObject* parent = nullptr);
@@ -47,6 +55,8 @@ public:
 public slots:
     bool start(const proto::desktop::Config& config);
     void selectScreen(int64_t screen_id);
+    void setPendingBytes(int64_t pending_bytes);
+    void frameAcknowledged(int packet_count);
 
 protected:
     // QObject implementation.
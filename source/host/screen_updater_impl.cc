@@ -19,6 +19,9 @@
 #include "host/screen_updater_impl.h"
 
 #include "codec/cursor_encoder.h"
+#include "codec/scale_reducer.h"
+#include "codec/tile_cache_encoder.h"
+#include "codec/video_encoder_hybrid.h"
 #include "codec/video_encoder_vpx.h"
 #include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
@@ -26,13 +29,60 @@
 #include "common/message_serialization.h"
 #include "desktop/capture_scheduler.h"
 #include "desktop/cursor_capturer_win.h"
+#include "desktop/desktop_frame_aligned.h"
+#include "desktop/mouse_cursor.h"
 #include "desktop/screen_capturer_wrapper.h"
+#include "desktop/scroll_detector.h"
 #include "proto/desktop_extensions.pb.h"
 
 #include <QCoreApplication>
 
+#include <algorithm>
+
 namespace host {
 
+namespace {
+
+// The capture interval can be increased up to this value if the encoder or the network can not
+// keep up with the screen updates.
+const std::chrono::milliseconds kMaxCaptureInterval(500);
+
+// Maximum number of the video packets sent to the client and not yet decoded by it. While the limit
+// is reached, the updates are merged and wait for the acknowledgement.
+const int kMaxFramesInFlight = 2;
+
+// If the screen does not change for this time, the encoder sends the areas encoded with reduced
+// quality again.
+const std::chrono::milliseconds kStaticRefreshDelay(500);
+
+// Number of the tiles in the tile cache of the client (16 MB for 32-bit pixels).
+const size_t kTileCacheSize = 1024;
+
+// Returns the changed fraction of the frame.
+double dirtyFraction(const desktop::Frame* frame)
+{
+    const int64_t frame_area =
+        static_cast<int64_t>(frame->size().width()) * frame->size().height();
+    if (!frame_area)
+        return 0;
+
+    int64_t dirty_area = 0;
+
+    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+        dirty_area += static_cast<int64_t>(it.rect().width()) * it.rect().height();
+
+    return static_cast<double>(dirty_area) / frame_area;
+}
+
+// Returns true if the client changes its frame after decoding |packet|.
+bool hasVideoData(const proto::desktop::VideoPacket& packet)
+{
+    return !packet.data().empty() || packet.dirty_rect_size() || packet.copy_rect_size() ||
+           packet.part_size() || packet.cached_tile_size() || packet.stored_tile_size();
+}
+
+} // namespace
+
 ScreenUpdaterImpl::ScreenUpdaterImpl(QObject* parent)
     : QThread(parent)
 {
@@ -58,17 +108,39 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
     switch (config.video_encoding())
     {
         case proto::desktop::VIDEO_ENCODING_VP8:
-            video_encoder_.reset(codec::VideoEncoderVPX::createVP8());
+            video_encoder_.reset(codec::VideoEncoderVPX::createVP8(
+                config.encoder_threads(), config.video_quality()));
             break;
 
         case proto::desktop::VIDEO_ENCODING_VP9:
-            video_encoder_.reset(codec::VideoEncoderVPX::createVP9());
+            video_encoder_.reset(codec::VideoEncoderVPX::createVP9(
+                config.encoder_threads(), config.video_quality()));
+            break;
+
+        case proto::desktop::VIDEO_ENCODING_VP9_I444:
+            video_encoder_.reset(codec::VideoEncoderVPX::createVP9I444(
+                config.encoder_threads(), config.video_quality()));
+            break;
+
+        case proto::desktop::VIDEO_ENCODING_VP9_LOSSLESS:
+            video_encoder_.reset(codec::VideoEncoderVPX::createVP9Lossless(
+                config.encoder_threads()));
             break;
 
         case proto::desktop::VIDEO_ENCODING_ZSTD:
             video_encoder_.reset(codec::VideoEncoderZstd::create(
-                codec::VideoUtil::fromVideoPixelFormat(
-                    config.pixel_format()), config.compress_ratio()));
+                codec::VideoUtil::fromVideoPixelFormat(config.pixel_format()),
+                config.compress_ratio(),
+                config.video_features()));
+            break;
+
+        case proto::desktop::VIDEO_ENCODING_HYBRID:
+            video_encoder_.reset(codec::VideoEncoderHybrid::create(
+                codec::VideoUtil::fromVideoPixelFormat(config.pixel_format()),
+                config.compress_ratio(),
+                config.video_features(),
+                config.encoder_threads(),
+                config.video_quality()));
             break;
 
         default:
@@ -83,14 +155,31 @@ bool ScreenUpdaterImpl::startUpdater(const proto::desktop::Config& config)
     if (!video_encoder_)
         return false;
 
+    if (config.scale_factor() >= common::kMinScaleFactor)
+        scale_reducer_ = codec::ScaleReducer::create(config.scale_factor());
+
+    // The moved areas and the cached tiles are copied from the pixels which the client has. The
+    // lossy encoders do not keep them exact.
+    if (config.video_encoding() == proto::desktop::VIDEO_ENCODING_ZSTD)
+    {
+        if (config.video_features() & proto::desktop::VIDEO_FEATURE_COPY_RECT)
+            scroll_detector_ = std::make_unique<desktop::ScrollDetector>();
+
+        if (config.video_features() & proto::desktop::VIDEO_FEATURE_TILE_CACHE)
+            tile_cache_encoder_ = std::make_unique<codec::TileCacheEncoder>(kTileCacheSize);
+    }
+
     if (config.flags() & proto::desktop::ENABLE_CURSOR_SHAPE)
     {
         cursor_capturer_.reset(new desktop::CursorCapturerWin());
         cursor_encoder_.reset(new codec::CursorEncoder());
     }
 
-    capture_scheduler_.reset(
-        new desktop::CaptureScheduler(std::chrono::milliseconds(config.update_interval())));
+    capture_scheduler_.reset(new desktop::CaptureScheduler(
+        std::chrono::milliseconds(config.update_interval()), kMaxCaptureInterval));
+
+    if (config.video_features() & proto::desktop::VIDEO_FEATURE_FRAME_ACK)
+        max_frames_in_flight_ = kMaxFramesInFlight;
 
     if (config.flags() & proto::desktop::DISABLE_DESKTOP_EFFECTS)
         screen_capturer_flags_ |= desktop::ScreenCapturerWrapper::DISABLE_EFFECTS;
@@ -113,9 +202,33 @@ void ScreenUpdaterImpl::selectScreen(desktop::ScreenCapturer::ScreenId screen_id
     event_condition_.notify_all();
 }
 
+void ScreenUpdaterImpl::setPendingBytes(int64_t pending_bytes)
+{
+    if (capture_scheduler_)
+        capture_scheduler_->setPendingBytes(pending_bytes);
+}
+
+void ScreenUpdaterImpl::frameAcknowledged(int packet_count)
+{
+    {
+        std::scoped_lock lock(encode_lock_);
+
+        // The client can acknowledge the packets of the previous updater after reconfiguration.
+        frames_in_flight_ = std::max(frames_in_flight_ - std::max(packet_count, 0), 0);
+    }
+
+    encode_condition_.notify_all();
+}
+
 void ScreenUpdaterImpl::run()
 {
     screen_capturer_ = std::make_unique<desktop::ScreenCapturerWrapper>(screen_capturer_flags_);
+    encode_thread_ = std::thread(&ScreenUpdaterImpl::runEncoder, this);
+
+    std::chrono::milliseconds logged_interval = std::chrono::milliseconds::zero();
+
+    auto last_change_time = std::chrono::high_resolution_clock::now();
+    bool refresh_posted = false;
 
     while (true)
     {
@@ -143,15 +256,15 @@ void ScreenUpdaterImpl::run()
                     item->set_title(screen.title.toStdString());
                 }
 
-                message_.Clear();
-
-                proto::desktop::Extension* extension = message_.mutable_extension();
+                proto::desktop::HostToClient message;
+                proto::desktop::Extension* extension = message.mutable_extension();
 
                 extension->set_name(common::kSelectScreenExtension);
                 extension->set_data(screen_list.SerializeAsString());
 
                 QCoreApplication::postEvent(
-                    parent(), new MessageEvent(common::serializeMessage(message_)));
+                    parent(), new MessageEvent(common::serializeMessage(message),
+                                                 base::MessagePriority::CONTROL));
             }
 
             screen_capturer_->selectScreen(screen_id_);
@@ -159,35 +272,50 @@ void ScreenUpdaterImpl::run()
 
         capture_scheduler_->beginCapture();
 
-        const desktop::Frame* screen_frame = screen_capturer_->captureFrame();
+        waitForFreeFrame();
+
+        const desktop::SharedFrame* screen_frame = screen_capturer_->captureFrame();
+        ++capture_number_;
+
+        std::unique_ptr<desktop::SharedFrame> frame;
         if (screen_frame)
-        {
-            message_.Clear();
+            frame = screen_frame->share();
 
-            if (!screen_frame->constUpdatedRegion().isEmpty())
-                video_encoder_->encode(screen_frame, message_.mutable_video_packet());
+        bool refresh = false;
+
+        if (frame)
+        {
+            const auto now = std::chrono::high_resolution_clock::now();
 
-            if (cursor_capturer_ && cursor_encoder_)
+            if (!frame->constUpdatedRegion().isEmpty())
             {
-                std::unique_ptr<desktop::MouseCursor> mouse_cursor(
-                    cursor_capturer_->captureCursor());
-                if (mouse_cursor)
-                {
-                    cursor_encoder_->encode(std::move(mouse_cursor),
-                                            message_.mutable_cursor_shape());
-                }
+                last_change_time = now;
+                refresh_posted = false;
             }
-
-            if (message_.has_video_packet() || message_.has_cursor_shape())
+            else if (!refresh_posted && now - last_change_time >= kStaticRefreshDelay)
             {
-                QCoreApplication::postEvent(parent(),
-                                        new MessageEvent(common::serializeMessage(message_)),
-                                        Qt::HighEventPriority);
+                refresh = true;
+                refresh_posted = true;
             }
         }
 
+        std::unique_ptr<desktop::MouseCursor> mouse_cursor;
+        if (cursor_capturer_)
+            mouse_cursor.reset(cursor_capturer_->captureCursor());
+
+        postUpdate(std::move(frame), std::move(mouse_cursor), refresh);
+
         capture_scheduler_->endCapture();
 
+        const desktop::CaptureScheduler::Decision decision = capture_scheduler_->lastDecision();
+
+        // Log only noticeable changes of the interval.
+        if (std::chrono::abs(decision.interval - logged_interval) * 4 > logged_interval)
+        {
+            LOG(LS_INFO) << "Capture interval changed: " << decision;
+            logged_interval = decision.interval;
+        }
+
         std::unique_lock lock(event_lock_);
         event_condition_.wait_for(lock, capture_scheduler_->nextCaptureDelay());
 
@@ -197,6 +325,7 @@ void ScreenUpdaterImpl::run()
                 break;
 
             case Event::TERMINATE:
+                stopEncoder();
                 return;
 
             case Event::SELECT_SCREEN:
@@ -208,4 +337,291 @@ void ScreenUpdaterImpl::run()
     }
 }
 
+void ScreenUpdaterImpl::waitForFreeFrame()
+{
+    // The frames captured kFrameQueueLength captures ago and earlier can be overwritten.
+    const int64_t oldest_valid_capture =
+        capture_number_ - desktop::ScreenCapturer::kFrameQueueLength + 1;
+
+    std::unique_lock lock(encode_lock_);
+
+    if (pending_update_ && pending_update_->frame &&
+        pending_update_->capture_number < oldest_valid_capture)
+    {
+        // The encoder has not taken the frame yet (it is busy or the client has not acknowledged
+        // the previous packets). A newer frame will be sent instead of it.
+        skipped_region_.addRegion(pending_update_->frame->constUpdatedRegion());
+        skipped_refresh_ = skipped_refresh_ || pending_update_->refresh;
+
+        pending_update_.reset();
+    }
+
+    encode_condition_.wait(lock, [&]()
+    {
+        return encoding_capture_number_ == -1 || encoding_capture_number_ >= oldest_valid_capture;
+    });
+}
+
+void ScreenUpdaterImpl::postUpdate(std::unique_ptr<desktop::SharedFrame> frame,
+                                   std::unique_ptr<desktop::MouseCursor> mouse_cursor,
+                                   bool refresh)
+{
+    std::scoped_lock lock(encode_lock_);
+
+    if (frame && skipped_refresh_)
+    {
+        refresh = true;
+        skipped_refresh_ = false;
+    }
+
+    if (frame && !skipped_region_.isEmpty())
+    {
+        desktop::Region* updated_region = frame->updatedRegion();
+
+        updated_region->addRegion(skipped_region_);
+        updated_region->intersectWith(desktop::Rect::makeSize(frame->size()));
+
+        skipped_region_.clear();
+    }
+
+    if (frame && frame->constUpdatedRegion().isEmpty() && !refresh)
+        frame.reset();
+
+    if (!frame && !mouse_cursor)
+        return;
+
+    if (mouse_cursor)
+        pending_cursor_ = std::move(mouse_cursor);
+
+    if (frame)
+    {
+        std::unique_ptr<PendingUpdate> update = std::make_unique<PendingUpdate>();
+
+        update->frame = std::move(frame);
+        update->capture_number = capture_number_ - 1;
+        update->refresh = refresh;
+
+        if (pending_update_)
+        {
+            // The encoder is behind. The previous update is dropped, but its changes must be sent
+            // with the new frame.
+            desktop::Region* updated_region = update->frame->updatedRegion();
+
+            updated_region->addRegion(pending_update_->frame->constUpdatedRegion());
+            updated_region->intersectWith(desktop::Rect::makeSize(update->frame->size()));
+
+            update->refresh = update->refresh || pending_update_->refresh;
+        }
+
+        pending_update_ = std::move(update);
+    }
+
+    encode_condition_.notify_all();
+}
+
+void ScreenUpdaterImpl::runEncoder()
+{
+    while (true)
+    {
+        std::unique_ptr<PendingUpdate> update;
+        std::unique_ptr<desktop::MouseCursor> mouse_cursor;
+
+        {
+            std::unique_lock lock(encode_lock_);
+
+            // The video packets wait until the client decodes the previous ones. The cursor shapes
+            // do not wait.
+            auto can_send_frame = [this]()
+            {
+                return pending_update_ &&
+                       (!max_frames_in_flight_ || frames_in_flight_ < max_frames_in_flight_);
+            };
+
+            encode_condition_.wait(lock, [&]()
+            {
+                return encoder_terminating_ || pending_cursor_ || can_send_frame();
+            });
+
+            if (encoder_terminating_)
+                return;
+
+            mouse_cursor = std::move(pending_cursor_);
+
+            if (can_send_frame())
+            {
+                update = std::move(pending_update_);
+                encoding_capture_number_ = update->capture_number;
+            }
+        }
+
+        message_.Clear();
+
+        // The frame which is sent to the client.
+        desktop::Frame* frame = update ? update->frame.get() : nullptr;
+
+        // The encoder receives the scaled frame. All the next steps work in its coordinates.
+        if (frame && scale_reducer_)
+        {
+            const desktop::Rect source_rect =
+                desktop::Rect::makeXYWH(frame->topLeft(), frame->size());
+
+            frame = scale_reducer_->scaleFrame(frame);
+
+            const desktop::Rect scaled_rect =
+                desktop::Rect::makeXYWH(frame->topLeft(), frame->size());
+
+            // The session maps the pointer positions of the client with the actual geometry of
+            // the frames. The event goes before the messages of the frame.
+            if (source_rect != source_rect_ || scaled_rect != scaled_rect_)
+            {
+                source_rect_ = source_rect;
+                scaled_rect_ = scaled_rect;
+
+                QCoreApplication::postEvent(parent(),
+                                            new ScaleEvent(source_rect, scaled_rect),
+                                            Qt::HighEventPriority);
+            }
+        }
+
+        if (frame)
+        {
+            video_encoder_->setPendingBytes(capture_scheduler_->lastDecision().pending_bytes);
+
+            if (update->refresh)
+                video_encoder_->prepareRefresh(frame->updatedRegion());
+        }
+
+        // True if the packet contains the areas which the client copies from its own pixels.
+        bool has_copied_areas = false;
+
+        // The areas which the client receives from the packet except the moved ones.
+        desktop::Region sent_region;
+
+        if (frame && scroll_detector_)
+            has_copied_areas = addCopyRect(frame, &message_);
+
+        if (frame && sent_frame_)
+            sent_region = frame->constUpdatedRegion();
+
+        // The video packet is created only for a frame with changes.
+        if (frame && tile_cache_encoder_ && !frame->constUpdatedRegion().isEmpty())
+        {
+            has_copied_areas |=
+                tile_cache_encoder_->encode(frame, message_.mutable_video_packet());
+        }
+
+        if (frame && (has_copied_areas || !frame->constUpdatedRegion().isEmpty()))
+        {
+            const auto begin_time = std::chrono::high_resolution_clock::now();
+
+            video_encoder_->encode(frame, message_.mutable_video_packet());
+
+            capture_scheduler_->onFrameEncoded(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::high_resolution_clock::now() - begin_time),
+                dirtyFraction(frame));
+
+            if (sent_frame_)
+            {
+                for (desktop::Region::Iterator it(sent_region); !it.isAtEnd(); it.advance())
+                    sent_frame_->copyPixelsFrom(*frame, it.rect().topLeft(), it.rect());
+            }
+        }
+
+        // The cursor shapes are sent in their own messages. The client caches the shapes and
+        // needs them in the order of encoding, while the video packets are sent with a lower
+        // priority.
+        if (mouse_cursor && cursor_encoder_)
+        {
+            cursor_message_.Clear();
+            cursor_encoder_->encode(std::move(mouse_cursor),
+                                    cursor_message_.mutable_cursor_shape());
+            postMessage(cursor_message_, base::MessagePriority::CURSOR);
+        }
+
+        // A packet without changes (e.g. the refresh of a frame without lossy areas) is not sent.
+        if (message_.has_video_packet() && !hasVideoData(message_.video_packet()))
+            message_.clear_video_packet();
+
+        if (message_.has_video_packet() && max_frames_in_flight_)
+        {
+            std::scoped_lock lock(encode_lock_);
+            ++frames_in_flight_;
+        }
+
+        if (message_.has_video_packet())
+            postMessage(message_, base::MessagePriority::VIDEO);
+
+        // Release the frame before the capturer is allowed to overwrite it.
+        update.reset();
+
+        {
+            std::scoped_lock lock(encode_lock_);
+            encoding_capture_number_ = -1;
+        }
+
+        encode_condition_.notify_all();
+    }
+}
+
+void ScreenUpdaterImpl::postMessage(const proto::desktop::HostToClient& message,
+                                    base::MessagePriority priority)
+{
+    if (!common::serializeMessage(message, &serialized_message_))
+        return;
+
+    QCoreApplication::postEvent(parent(),
+                                new MessageEvent(QByteArray(serialized_message_), priority),
+                                Qt::HighEventPriority);
+}
+
+bool ScreenUpdaterImpl::addCopyRect(desktop::Frame* frame, proto::desktop::HostToClient* message)
+{
+    if (!sent_frame_ || sent_frame_->size() != frame->size() ||
+        sent_frame_->format() != frame->format() || sent_frame_->topLeft() != frame->topLeft())
+    {
+        // The screen has changed and the client receives it completely.
+        sent_frame_ = desktop::FrameAligned::create(frame->size(), frame->format(), 32);
+        if (sent_frame_)
+        {
+            sent_frame_->setTopLeft(frame->topLeft());
+            sent_frame_->copyPixelsFrom(*frame, desktop::Point(0, 0),
+                                        desktop::Rect::makeSize(frame->size()));
+        }
+
+        return false;
+    }
+
+    desktop::Rect source_rect;
+    desktop::Point dest_pos;
+
+    if (!scroll_detector_->detect(*sent_frame_, *frame, &source_rect, &dest_pos))
+        return false;
+
+    const desktop::Rect dest_rect = desktop::Rect::makeXYWH(dest_pos, source_rect.size());
+
+    proto::desktop::CopyRect* copy_rect = message->mutable_video_packet()->add_copy_rect();
+    codec::VideoUtil::toVideoRect(source_rect, copy_rect->mutable_source_rect());
+    copy_rect->set_dest_x(dest_pos.x());
+    copy_rect->set_dest_y(dest_pos.y());
+
+    // The client gets the pixels of the moved area by copying, only the rest is encoded.
+    sent_frame_->copyPixelsFrom(*sent_frame_, source_rect.topLeft(), dest_rect);
+    frame->updatedRegion()->subtract(dest_rect);
+    return true;
+}
+
+void ScreenUpdaterImpl::stopEncoder()
+{
+    {
+        std::scoped_lock lock(encode_lock_);
+        encoder_terminating_ = true;
+    }
+
+    encode_condition_.notify_all();
+
+    if (encode_thread_.joinable())
+        encode_thread_.join();
+}
+
 } // namespace host
@@ -19,21 +19,32 @@
 #ifndef HOST__SCREEN_UPDATER_IMPL_H
 #define HOST__SCREEN_UPDATER_IMPL_H
 
+#include "base/message_priority.h"
+#include "desktop/desktop_region.h"
 #include "desktop/screen_capturer_wrapper.h"
 #include "proto/desktop.pb.h"
 
 #include <QEvent>
 #include <QThread>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace codec {
 class CursorEncoder;
 class ScaleReducer;
+class TileCacheEncoder;
 class VideoEncoder;
 } // namespace codec
 
 namespace desktop {
 class CaptureScheduler;
 class CursorCapturer;
+class Frame;
+class MouseCursor;
+class ScrollDetector;
+class SharedFrame;
 } // namespace desktop
 
 namespace host {
@@ -49,30 +60,103 @@ public:
     public:
         static const int kType = QEvent::User + 1;
 
-        MessageEvent(QByteArray&& buffer) noexcept
+        MessageEvent(QByteArray&& buffer, base::MessagePriority priority) noexcept
             : QEvent(static_cast<QEvent::Type>(kType)),
-              buffer_(std::move(buffer))
+              buffer_(std::move(buffer)),
+              priority_(priority)
         {
             // Nothing
         }
 
         const QByteArray& buffer() const { return buffer_; }
+        base::MessagePriority priority() const { return priority_; }
 
     private:
         QByteArray buffer_;
+        base::MessagePriority priority_;
         DISALLOW_COPY_AND_ASSIGN(MessageEvent);
     };
 
+    // Sent before the first frame with the new geometry if the frames are scaled. The client sees
+    // |source_rect| of the screen as |scaled_rect|.
+    class ScaleEvent : public QEvent
+    {
+    public:
+        static const int kType = QEvent::User + 2;
+
+        ScaleEvent(const desktop::Rect& source_rect, const desktop::Rect& scaled_rect) noexcept
+            : QEvent(static_cast<QEvent::Type>(kType)),
+              source_rect_(source_rect),
+              scaled_rect_(scaled_rect)
+        {
+            // Nothing
+        }
+
+        const desktop::Rect& sourceRect() const { return source_rect_; }
+        const desktop::Rect& scaledRect() const { return scaled_rect_; }
+
+    private:
+        desktop::Rect source_rect_;
+        desktop::Rect scaled_rect_;
+        DISALLOW_COPY_AND_ASSIGN(ScaleEvent);
+    };
+
     bool startUpdater(const proto::desktop::Config& config);
     void selectScreen(desktop::ScreenCapturer::ScreenId screen_id);
 
+    // Sets the number of bytes waiting to be sent to the client. Used to choose the capture
+    // interval.
+    void setPendingBytes(int64_t pending_bytes);
+
+    // Called when the client acknowledges |packet_count| video packets. Used only if the client
+    // has enabled proto::desktop::VIDEO_FEATURE_FRAME_ACK.
+    void frameAcknowledged(int packet_count);
+
 protected:
-    // QThread implementation.
+    // QThread implementation. The thread captures the screen and passes the frames to the
+    // encoding thread.
     void run() override;
 
 private:
     enum class Event { NO_EVENT, SELECT_SCREEN, TERMINATE };
 
+    // Captured frame waiting for the encoding thread.
+    struct PendingUpdate
+    {
+        std::unique_ptr<desktop::SharedFrame> frame;
+
+        // Number of the capture in which |frame| was received.
+        int64_t capture_number = 0;
+
+        // If true, the screen has not changed for a while and the encoder can send the areas
+        // encoded with reduced quality again.
+        bool refresh = false;
+    };
+
+    // Waits until the encoding thread releases the frame which will be overwritten by the next
+    // capture. If the frame is still waiting for the encoder, it is dropped and its updated region
+    // is sent with the next frame.
+    void waitForFreeFrame();
+
+    // Passes the update to the encoding thread. If the encoder has not taken the previous update
+    // yet, it is merged with the new one. Frames without changes are passed only if |refresh| is
+    // true.
+    void postUpdate(std::unique_ptr<desktop::SharedFrame> frame,
+                    std::unique_ptr<desktop::MouseCursor> mouse_cursor,
+                    bool refresh);
+
+    // Encodes the updates and sends the serialized messages. Runs on |encode_thread_|.
+    void runEncoder();
+
+    // Serializes |message| and passes it to the parent.
+    void postMessage(const proto::desktop::HostToClient& message, base::MessagePriority priority);
+
+    // Searches |frame| for an area moved since the previous packet. If it is found, the area is
+    // added to the video packet of |message| as CopyRect and removed from the updated region of
+    // |frame|. The video packet is not created if no area is found.
+    bool addCopyRect(desktop::Frame* frame, proto::desktop::HostToClient* message);
+    void stopEncoder();
+
     uint32_t screen_capturer_flags_ = 0;
 
     std::unique_ptr<desktop::CaptureScheduler> capture_scheduler_;
@@ -80,6 +164,22 @@ private:
     std::unique_ptr<desktop::ScreenCapturerWrapper> screen_capturer_;
     std::unique_ptr<codec::VideoEncoder> video_encoder_;
 
+    // Null if the client receives the frames in the screen size.
+    std::unique_ptr<codec::ScaleReducer> scale_reducer_;
+
+    // Geometry of the last ScaleEvent. Used only on the encoding thread.
+    desktop::Rect source_rect_;
+    desktop::Rect scaled_rect_;
+
+    // Null if the client has not enabled proto::desktop::VIDEO_FEATURE_COPY_RECT.
+    std::unique_ptr<desktop::ScrollDetector> scroll_detector_;
+
+    // The screen as the client has it after the sent packets. Used only on the encoding thread.
+    std::unique_ptr<desktop::Frame> sent_frame_;
+
+    // Null if the client has not enabled proto::desktop::VIDEO_FEATURE_TILE_CACHE.
+    std::unique_ptr<codec::TileCacheEncoder> tile_cache_encoder_;
+
     std::unique_ptr<desktop::CursorCapturer> cursor_capturer_;
     std::unique_ptr<codec::CursorEncoder> cursor_encoder_;
 
@@ -92,7 +192,43 @@ private:
     std::condition_variable event_condition_;
     std::mutex event_lock_;
 
+    // Number of the next capture.
+    int64_t capture_number_ = 0;
+
+    std::thread encode_thread_;
+    bool encoder_terminating_ = false;
+
+    // Only one update can wait for the encoder. The newer updates are merged with it.
+    std::unique_ptr<PendingUpdate> pending_update_;
+
+    // The cursor shape waiting for the encoder. It does not wait for the acknowledgements of the
+    // video packets. A newer shape replaces it.
+    std::unique_ptr<desktop::MouseCursor> pending_cursor_;
+
+    // Number of the capture of the frame which is being encoded or -1.
+    int64_t encoding_capture_number_ = -1;
+
+    // Updated region of the dropped frames which is not sent yet.
+    desktop::Region skipped_region_;
+
+    // True if a dropped frame was a static screen refresh.
+    bool skipped_refresh_ = false;
+
+    // Maximum number of the video packets which are not acknowledged by the client. If 0, then
+    // the client does not send acknowledgements and the number is not limited.
+    int max_frames_in_flight_ = 0;
+    int frames_in_flight_ = 0;
+
+    std::condition_variable encode_condition_;
+    std::mutex encode_lock_;
+
+    // Used only on the encoding thread.
     proto::desktop::HostToClient message_;
+    proto::desktop::HostToClient cursor_message_;
+
+    // The last serialized message. The event shares the buffer with the updater, when the event is
+    // processed the memory of the buffer is used for the next message.
+    QByteArray serialized_message_;
 
     DISALLOW_COPY_AND_ASSIGN(ScreenUpdaterImpl);
 };
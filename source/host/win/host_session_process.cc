@@ -25,8 +25,18 @@
 
 #include <QCoreApplication>
 
+#include <cstdlib>
+
 namespace host {
 
+namespace {
+
+// The size of the network queue is reported to the session when it changes by this value or the
+// queue becomes empty.
+const int64_t kPendingBytesReportStep = 256 * 1024; // 256 kB
+
+} // namespace
+
 SessionProcess::SessionProcess(QObject* parent)
     : QObject(parent)
 {
@@ -349,6 +359,15 @@ void SessionProcess::ipcNewConnection(ipc::Channel* channel)
     connect(ipc_channel_, &ipc::Channel::messageReceived, network_channel_, &net::Channel::send);
     connect(network_channel_, &net::Channel::messageReceived, ipc_channel_, &ipc::Channel::send);
 
+    // The messages of the session are always forwarded, so the control messages are not held
+    // behind the video. Only the session's capture rate reacts to the network queue.
+    reported_pending_bytes_ = 0;
+
+    connect(ipc_channel_, &ipc::Channel::messageReceived,
+            this, &SessionProcess::reportNetworkPendingBytes);
+    connect(network_channel_, &net::Channel::messageWritten,
+            ipc_channel_, [this]() { reportNetworkPendingBytes(); });
+
     LOG(LS_INFO) << "Session process is attached (SID: " << session_id_ << ")";
     state_ = State::ATTACHED;
 
@@ -358,6 +377,23 @@ void SessionProcess::ipcNewConnection(ipc::Channel* channel)
     ipc_channel_->start();
 }
 
+void SessionProcess::reportNetworkPendingBytes()
+{
+    if (!ipc_channel_)
+        return;
+
+    const int64_t pending_bytes = network_channel_->pendingBytes();
+
+    if (std::abs(pending_bytes - reported_pending_bytes_) < kPendingBytesReportStep &&
+        (pending_bytes || !reported_pending_bytes_))
+    {
+        return;
+    }
+
+    reported_pending_bytes_ = pending_bytes;
+    ipc_channel_->sendForwardPendingBytes(pending_bytes);
+}
+
 bool SessionProcess::startFakeSession()
 {
     LOG(LS_INFO) << "Starting a fake session";
@@ -370,7 +406,11 @@ bool SessionProcess::startFakeSession()
         return false;
     }
 
-    connect(fake_session_, &SessionFake::sendMessage, network_channel_, &net::Channel::send);
+    connect(fake_session_, &SessionFake::sendMessage,
+            network_channel_, [this](const QByteArray& buffer)
+    {
+        network_channel_->send(buffer);
+    });
 
     connect(network_channel_, &net::Channel::messageReceived,
             fake_session_, &SessionFake::onMessageReceived);
@@ -83,6 +83,10 @@ private slots:
 private:
     bool startFakeSession();
 
+    // Tells the session how many of its messages wait for the network, so that the session
+    // reduces the frame rate. Only noticeable changes are reported.
+    void reportNetworkPendingBytes();
+
     std::string uuid_;
 
     base::win::SessionId session_id_ = base::win::kInvalidSessionId;
@@ -95,6 +99,9 @@ private:
     QPointer<HostProcess> session_process_;
     QPointer<SessionFake> fake_session_;
 
+    // The size of the network queue last reported to the session.
+    int64_t reported_pending_bytes_ = 0;
+
     DISALLOW_COPY_AND_ASSIGN(SessionProcess);
 };
 
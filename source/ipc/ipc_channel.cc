@@ -24,6 +24,10 @@
 #include <windows.h>
 #endif // defined(OS_WIN)
 
+#include <google/protobuf/message_lite.h>
+
+#include <cstring>
+
 namespace ipc {
 
 Q_DECLARE_METATYPE(QLocalSocket::LocalSocketError);
@@ -32,6 +36,9 @@ namespace {
 
 constexpr uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16MB
 
+// Maximum number of the written buffers kept for reuse.
+constexpr size_t kMaxFreeBuffers = 4;
+
 #if defined(OS_WIN)
 base::ProcessId clientProcessIdImpl(HANDLE pipe_handle)
 {
@@ -145,14 +152,54 @@ void Channel::stop()
 
 void Channel::start()
 {
+    paused_ = false;
     onReadyRead();
 }
 
-void Channel::send(const QByteArray& buffer)
+void Channel::pause()
+{
+    paused_ = true;
+}
+
+void Channel::send(const QByteArray& buffer, base::MessagePriority priority)
 {
     bool schedule_write = write_queue_.empty();
 
-    write_queue_.emplace(buffer);
+    char* data = prepareMessage(buffer.size(), MessageType::DATA, priority);
+    if (!data)
+        return;
+
+    memcpy(data, buffer.constData(), buffer.size());
+
+    if (schedule_write)
+        scheduleWrite();
+}
+
+void Channel::sendMessage(const google::protobuf::MessageLite& message,
+                          base::MessagePriority priority)
+{
+    bool schedule_write = write_queue_.empty();
+
+    char* data = prepareMessage(message.ByteSizeLong(), MessageType::DATA, priority);
+    if (!data)
+        return;
+
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data));
+
+    if (schedule_write)
+        scheduleWrite();
+}
+
+void Channel::sendForwardPendingBytes(int64_t pending_bytes)
+{
+    bool schedule_write = write_queue_.empty();
+
+    char* data = prepareMessage(sizeof(pending_bytes), MessageType::FORWARD_PENDING_BYTES,
+                                base::MessagePriority::CONTROL);
+    if (!data)
+        return;
+
+    memcpy(data, &pending_bytes, sizeof(pending_bytes));
 
     if (schedule_write)
         scheduleWrite();
@@ -166,69 +213,103 @@ void Channel::onError(QLocalSocket::LocalSocketError /* socket_error */)
 
 void Channel::onBytesWritten(int64_t bytes)
 {
-    const QByteArray& write_buffer = write_queue_.front();
+    QByteArray& write_buffer = write_queue_.front();
 
     written_ += bytes;
 
-    if (written_ < sizeof(MessageSizeType))
-    {
-        socket_->write(reinterpret_cast<const char*>(&write_size_) + written_,
-                       sizeof(MessageSizeType) - written_);
-    }
-    else if (written_ < sizeof(MessageSizeType) + write_buffer.size())
-    {
-        socket_->write(write_buffer.data() + (written_ - sizeof(MessageSizeType)),
-                       write_buffer.size() - (written_ - sizeof(MessageSizeType)));
-    }
-    else
-    {
-        write_queue_.pop();
-        written_ = 0;
+    // The message is passed to the socket together with its size by one call.
+    if (written_ < write_buffer.size())
+        return;
 
-        if (!write_queue_.empty())
-            scheduleWrite();
-    }
+    pending_bytes_ -= write_buffer.size() - sizeof(MessageHeader);
+    written_ = 0;
+
+    // The socket does not use the buffer anymore. It is kept for the next messages.
+    if (free_buffers_.size() < kMaxFreeBuffers)
+        free_buffers_.emplace_back(std::move(write_buffer));
+
+    write_queue_.pop();
+
+    if (!write_queue_.empty())
+        scheduleWrite();
+
+    emit messageWritten();
 }
 
 void Channel::onReadyRead()
 {
     int64_t current;
 
-    for (;;)
+    // The message handler can pause the channel.
+    while (!paused_)
     {
-        if (!read_size_received_)
+        if (!read_header_received_)
         {
-            current = socket_->read(reinterpret_cast<char*>(&read_size_) + read_,
-                                    sizeof(MessageSizeType) - read_);
-            if (current + read_ == sizeof(MessageSizeType))
+            current = socket_->read(reinterpret_cast<char*>(&read_header_) + read_,
+                                    sizeof(MessageHeader) - read_);
+            if (current + read_ == sizeof(MessageHeader))
             {
-                read_size_received_ = true;
+                read_header_received_ = true;
+
+                if (!read_header_.size || read_header_.size > kMaxMessageSize)
+                {
+                    LOG(LS_WARNING) << "Wrong message size: " << read_header_.size;
+                    socket_->abort();
+                    return;
+                }
+
+                if (read_header_.priority >= base::kMessagePriorityCount)
+                {
+                    LOG(LS_WARNING) << "Wrong message priority: " << read_header_.priority;
+                    socket_->abort();
+                    return;
+                }
+
+                const MessageType type = static_cast<MessageType>(read_header_.type);
+
+                if (type != MessageType::DATA && type != MessageType::FORWARD_PENDING_BYTES)
+                {
+                    LOG(LS_WARNING) << "Wrong message type: " << read_header_.type;
+                    socket_->abort();
+                    return;
+                }
 
-                if (!read_size_ || read_size_ > kMaxMessageSize)
+                if (type == MessageType::FORWARD_PENDING_BYTES &&
+                    read_header_.size != sizeof(forward_pending_bytes_))
                 {
-                    LOG(LS_WARNING) << "Wrong message size: " << read_size_;
+                    LOG(LS_WARNING) << "Wrong size of the pending bytes: " << read_header_.size;
                     socket_->abort();
                     return;
                 }
 
-                if (read_buffer_.capacity() < static_cast<int>(read_size_))
-                    read_buffer_.reserve(read_size_);
+                if (read_buffer_.capacity() < static_cast<int>(read_header_.size))
+                    read_buffer_.reserve(read_header_.size);
 
-                read_buffer_.resize(read_size_);
+                read_buffer_.resize(read_header_.size);
                 read_ = 0;
                 continue;
             }
         }
-        else if (read_ < read_size_)
+        else if (read_ < read_header_.size)
         {
-            current = socket_->read(read_buffer_.data() + read_, read_size_ - read_);
+            current = socket_->read(read_buffer_.data() + read_, read_header_.size - read_);
         }
         else
         {
-            read_size_received_ = false;
+            read_header_received_ = false;
             read_ = 0;
 
-            emit messageReceived(read_buffer_);
+            if (read_header_.type == static_cast<uint16_t>(MessageType::FORWARD_PENDING_BYTES))
+            {
+                memcpy(&forward_pending_bytes_, read_buffer_.constData(),
+                       sizeof(forward_pending_bytes_));
+
+                emit forwardPendingBytesChanged();
+                continue;
+            }
+
+            emit messageReceived(read_buffer_,
+                                 static_cast<base::MessagePriority>(read_header_.priority));
             continue;
         }
 
@@ -253,17 +334,46 @@ void Channel::initConnected()
 
 void Channel::scheduleWrite()
 {
-    const QByteArray& write_buffer = write_queue_.front();
+    socket_->write(write_queue_.front());
+}
 
-    write_size_ = write_buffer.size();
-    if (!write_size_ || write_size_ > kMaxMessageSize)
+char* Channel::prepareMessage(size_t size, MessageType type, base::MessagePriority priority)
+{
+    if (!size || size > kMaxMessageSize)
     {
-        LOG(LS_WARNING) << "Wrong message size: " << write_size_;
+        LOG(LS_WARNING) << "Wrong message size: " << size;
         socket_->abort();
-        return;
+        return nullptr;
+    }
+
+    QByteArray buffer;
+
+    if (!free_buffers_.empty())
+    {
+        buffer = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
     }
 
-    socket_->write(reinterpret_cast<const char*>(&write_size_), sizeof(MessageSizeType));
+    const int buffer_size = sizeof(MessageHeader) + size;
+
+    // If the reserved buffer size is less, then increase it.
+    if (buffer.capacity() < buffer_size)
+        buffer.reserve(buffer_size);
+
+    buffer.resize(buffer_size);
+
+    // Copy the header of the message to the buffer.
+    MessageHeader header;
+    header.size = static_cast<uint32_t>(size);
+    header.type = static_cast<uint16_t>(type);
+    header.priority = static_cast<uint16_t>(priority);
+
+    memcpy(buffer.data(), &header, sizeof(MessageHeader));
+
+    write_queue_.emplace(std::move(buffer));
+    pending_bytes_ += size;
+
+    return write_queue_.back().data() + sizeof(MessageHeader);
 }
 
 } // namespace ipc
@@ -20,6 +20,7 @@
 #define IPC__IPC_CHANNEL_H
 
 #include "base/macros_magic.h"
+#include "base/message_priority.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -36,6 +37,13 @@
 #include <QPointer>
 
 #include <queue>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+class MessageLite;
+} // namespace protobuf
+} // namespace google
 
 namespace ipc {
 
@@ -55,6 +63,18 @@ public:
 
     void connectToServer(const QString& channel_name);
 
+    // Returns the total size of the messages in the sending queue and the size reported by the
+    // other side with sendForwardPendingBytes().
+    int64_t pendingBytes() const { return pending_bytes_ + forward_pending_bytes_; }
+
+    // Tells the other side how many bytes of its messages wait to be forwarded further (e.g. to
+    // the network). The other side adds them to its pendingBytes().
+    void sendForwardPendingBytes(int64_t pending_bytes);
+
+    // Sends a message. The message is serialized directly into the send buffer.
+    void sendMessage(const google::protobuf::MessageLite& message,
+                     base::MessagePriority priority = base::MessagePriority::CONTROL);
+
 #if defined(OS_WIN)
     base::ProcessId clientProcessId() const { return client_process_id_; }
     base::ProcessId serverProcessId() const { return server_process_id_; }
@@ -68,14 +88,25 @@ public slots:
     // Starts reading the message.
     void start();
 
-    // Sends a message.
-    void send(const QByteArray& buffer);
+    // Suspends reading of the messages until |start| is called.
+    void pause();
+
+    // Sends a message. The channel copies the message and does not keep |buffer|. |priority| is
+    // passed to the other side with the message.
+    void send(const QByteArray& buffer,
+              base::MessagePriority priority = base::MessagePriority::CONTROL);
 
 signals:
     void connected();
     void disconnected();
     void errorOccurred();
-    void messageReceived(const QByteArray& buffer);
+    void messageReceived(const QByteArray& buffer, base::MessagePriority priority);
+
+    // Emitted when a message from the sending queue is completely written to the socket.
+    void messageWritten();
+
+    // Emitted when the other side reports the size of the forwarded messages.
+    void forwardPendingBytesChanged();
 
 private slots:
     void onError(QLocalSocket::LocalSocketError socket_error);
@@ -89,7 +120,19 @@ private:
     void initConnected();
     void scheduleWrite();
 
-    using MessageSizeType = uint32_t;
+    // Adds a message of |size| bytes to the queue. Returns the pointer to which the message should
+    // be written or nullptr if the size is invalid.
+    enum class MessageType : uint16_t { DATA, FORWARD_PENDING_BYTES };
+
+    char* prepareMessage(size_t size, MessageType type, base::MessagePriority priority);
+
+    // Each message is preceded by its header.
+    struct MessageHeader
+    {
+        uint32_t size;
+        uint16_t type;
+        uint16_t priority;
+    };
 
     const Type type_;
     QPointer<QLocalSocket> socket_;
@@ -102,14 +145,22 @@ private:
 
     using QueueContainer = std::deque<QByteArray, QueueAllocator>;
 
-    // The queue contains unencrypted source messages.
+    // The queue contains the messages with their sizes in front.
     std::queue<QByteArray, QueueContainer> write_queue_;
-    MessageSizeType write_size_ = 0;
     int64_t written_ = 0;
 
-    bool read_size_received_ = false;
+    // The written buffers which can be used for the next messages.
+    std::vector<QByteArray> free_buffers_;
+    int64_t pending_bytes_ = 0;
+
+    // The size of the messages which the other side has not forwarded yet.
+    int64_t forward_pending_bytes_ = 0;
+
+    bool paused_ = false;
+
+    bool read_header_received_ = false;
     QByteArray read_buffer_;
-    MessageSizeType read_size_ = 0;
+    MessageHeader read_header_ = { 0, 0, 0 };
     int64_t read_ = 0;
 
 #if defined(OS_WIN)
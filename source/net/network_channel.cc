@@ -22,20 +22,46 @@
 
 #include <QNetworkProxy>
 
+#include <google/protobuf/message_lite.h>
+
+#include <algorithm>
+#include <cstring>
+
 namespace net {
 
 namespace {
 
 constexpr uint32_t kMaxMessageSize = 16 * 1024 * 1024; // 16 MB
-constexpr int64_t kMaxWriteSize = 1200; // 1200 bytes
 
-QByteArray createWriteBuffer(const QByteArray& message_buffer)
-{
-    size_t message_size = message_buffer.size();
-    if (!message_size || message_size > kMaxMessageSize)
-        return QByteArray();
+// Small messages from the queue are combined into one write to the socket until the total size
+// reaches this value. A larger message is always written with one call.
+constexpr int64_t kMaxCoalescedSize = 64 * 1024; // 64 kB
 
-    uint8_t length_data[4];
+// The messages are encrypted and passed to the socket ahead until the size of the data which is
+// not yet written to the network reaches this value. The next messages wait in the queue.
+constexpr int64_t kMaxBytesInFlight = 4 * 1024 * 1024; // 4 MB
+
+// If the peer supports fragments, the messages larger than this size are sent in fragments. A
+// fragment with its size and the authentication data fits into one write to the socket.
+constexpr int64_t kMaxFragmentSize = kMaxCoalescedSize - 64;
+
+// The same limit for video and file data: two fragments. A message of a higher priority added to
+// the queue later waits only for them.
+constexpr int64_t kMaxLowPriorityBytesInFlight = 2 * kMaxCoalescedSize; // 128 kB
+
+// The last byte of each encrypted message if the fragments are used. The lower bits contain the
+// priority of the message (the index of its queue).
+constexpr uint8_t kPriorityMask = 0x03;
+constexpr uint8_t kMoreFragmentsFlag = 0x80;
+
+// Maximum number of the buffers kept for reuse. Each message in the sending queue has its own
+// buffer until it is encrypted.
+constexpr size_t kMaxFreeBuffers = 16;
+
+// Writes the variable-length size of the message to |length_data|. Returns the number of bytes
+// written (from 1 to 4).
+size_t writeMessageSize(size_t message_size, uint8_t* length_data)
+{
     size_t length_data_size = 1;
 
     length_data[0] = message_size & 0x7F;
@@ -57,6 +83,25 @@ QByteArray createWriteBuffer(const QByteArray& message_buffer)
         }
     }
 
+    return length_data_size;
+}
+
+// Returns the size of the message with its header.
+int64_t writtenMessageSize(size_t message_size)
+{
+    uint8_t length_data[4];
+    return writeMessageSize(message_size, length_data) + message_size;
+}
+
+QByteArray createWriteBuffer(const QByteArray& message_buffer)
+{
+    size_t message_size = message_buffer.size();
+    if (!message_size || message_size > kMaxMessageSize)
+        return QByteArray();
+
+    uint8_t length_data[4];
+    size_t length_data_size = writeMessageSize(message_size, length_data);
+
     QByteArray write_buffer;
     write_buffer.resize(length_data_size + message_size);
 
@@ -117,6 +162,10 @@ void Channel::stop()
 {
     channel_state_ = ChannelState::NOT_CONNECTED;
 
+    // The received messages which are not processed yet are discarded.
+    read_.begin = 0;
+    read_.end = 0;
+
     if (socket_->state() != QTcpSocket::UnconnectedState)
     {
         socket_->abort();
@@ -131,33 +180,51 @@ void Channel::pause()
     read_.paused = true;
 }
 
-void Channel::send(const QByteArray& buffer)
+void Channel::send(const QByteArray& buffer, base::MessagePriority priority)
 {
-    if (buffer.isEmpty())
+    // Add the message to the queue for sending.
+    char* data = prepareMessage(buffer.size(), priority);
+    if (!data)
     {
         emit errorOccurred(Error::UNKNOWN);
         return;
     }
 
-    bool schedule_write = write_.queue.empty();
+    memcpy(data, buffer.constData(), buffer.size());
+
+    // If the socket has enough data to write, the message is written together with the next
+    // messages when the previous ones are written.
+    scheduleWrite();
+}
 
-    // Add the buffer to the queue for sending.
-    write_.queue.emplace(buffer);
+void Channel::sendMessage(const google::protobuf::MessageLite& message,
+                          base::MessagePriority priority)
+{
+    char* data = prepareMessage(message.ByteSizeLong(), priority);
+    if (!data)
+    {
+        emit errorOccurred(Error::UNKNOWN);
+        return;
+    }
 
-    if (schedule_write)
-        scheduleWrite();
+    message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data));
+    scheduleWrite();
 }
 
 void Channel::sendInternal(const QByteArray& buffer)
 {
-    write_.buffer = createWriteBuffer(buffer);
-    if (write_.buffer.isEmpty())
+    QByteArray write_buffer = createWriteBuffer(buffer);
+    if (write_buffer.isEmpty())
     {
         stop();
         return;
     }
 
-    socket_->write(write_.buffer);
+    write_.messages.push_back({ write_buffer.size(), 0, true, true });
+    write_.bytes_in_flight += write_buffer.size();
+    write_.buffers.emplace_back(std::move(write_buffer));
+
+    socket_->write(write_.buffers.back());
 }
 
 void Channel::onError(QAbstractSocket::SocketError error)
@@ -205,211 +272,489 @@ void Channel::onError(QAbstractSocket::SocketError error)
 
 void Channel::onBytesWritten(int64_t bytes)
 {
+    // The socket keeps the whole buffer passed to it and writes it to the network itself. We only
+    // count the written messages.
     write_.bytes_transferred += bytes;
 
-    if (write_.bytes_transferred < write_.buffer.size())
+    while (!write_.messages.empty() && write_.bytes_transferred >= write_.messages.front().size)
     {
-        int64_t bytes_to_write =
-            std::min(write_.buffer.size() - write_.bytes_transferred, kMaxWriteSize);
+        const WrittenMessage message = write_.messages.front();
 
-        socket_->write(write_.buffer.constData() + write_.bytes_transferred, bytes_to_write);
-    }
-    else
-    {
-        onMessageWritten();
+        write_.messages.pop_front();
+        write_.bytes_transferred -= message.size;
+        write_.bytes_in_flight -= message.size;
+
+        if (message.is_last_in_buffer)
+        {
+            DCHECK(!write_.buffers.empty());
 
-        write_.buffer.clear();
-        write_.bytes_transferred = 0;
+            // The socket does not use the buffer anymore. It is kept for the next messages.
+            releaseWriteBuffer(std::move(write_.buffers.front()));
+            write_.buffers.pop_front();
+        }
+
+        onMessageWritten(message);
     }
 }
 
 void Channel::onReadyRead()
 {
-    if (read_.paused)
-        return;
-
-    int64_t current = 0;
-
     for (;;)
     {
-        if (!read_.buffer_size_received)
-        {
-            uint8_t byte;
+        // The messages received earlier are processed first.
+        if (!readMessages())
+            return;
 
-            current = socket_->read(reinterpret_cast<char*>(&byte), sizeof(byte));
-            if (current == sizeof(byte))
-            {
-                switch (read_.bytes_transferred)
-                {
-                    case 0:
-                        read_.buffer_size += byte & 0x7F;
-                        break;
-
-                    case 1:
-                        read_.buffer_size += (byte & 0x7F) << 7;
-                        break;
-
-                    case 2:
-                        read_.buffer_size += (byte & 0x7F) << 14;
-                        break;
-
-                    case 3:
-                        read_.buffer_size += byte << 21;
-                        break;
-
-                    default:
-                        break;
-                }
-
-                if (!(byte & 0x80) || read_.bytes_transferred == 3)
-                {
-                    read_.buffer_size_received = true;
-
-                    if (!read_.buffer_size || read_.buffer_size > kMaxMessageSize)
-                    {
-                        emit errorOccurred(Error::UNKNOWN);
-                        return;
-                    }
-
-                    if (read_.buffer.capacity() < read_.buffer_size)
-                        read_.buffer.reserve(read_.buffer_size);
-
-                    read_.buffer.resize(read_.buffer_size);
-                    read_.buffer_size = 0;
-                    read_.bytes_transferred = 0;
-                    continue;
-                }
-            }
-        }
-        else if (read_.bytes_transferred < read_.buffer.size())
-        {
-            current = socket_->read(read_.buffer.data() + read_.bytes_transferred,
-                                    read_.buffer.size() - read_.bytes_transferred);
-        }
-        else
+        const int64_t bytes_available = socket_->bytesAvailable();
+        if (bytes_available <= 0)
+            return;
+
+        // Move the beginning of the next message to the start of the buffer.
+        const int64_t unprocessed_size = read_.end - read_.begin;
+        if (read_.begin)
         {
-            read_.buffer_size_received = false;
-            read_.bytes_transferred = 0;
+            if (unprocessed_size)
+                memmove(read_.buffer.data(), read_.buffer.data() + read_.begin, unprocessed_size);
 
-            onMessageReceived();
-            return;
+            read_.begin = 0;
+            read_.end = unprocessed_size;
         }
 
+        const int64_t required_size = unprocessed_size + bytes_available;
+
+        // If the reserved buffer size is less, then increase it.
+        if (read_.buffer.capacity() < required_size)
+            read_.buffer.reserve(required_size);
+
+        if (read_.buffer.size() < required_size)
+            read_.buffer.resize(required_size);
+
+        const int64_t current =
+            socket_->read(read_.buffer.data() + read_.end, read_.buffer.size() - read_.end);
         if (current <= 0)
             return;
 
-        read_.bytes_transferred += current;
+        read_.end += current;
     }
 }
 
-void Channel::onMessageWritten()
+bool Channel::readMessages()
 {
-    if (channel_state_ == ChannelState::ENCRYPTED)
+    while (!read_.paused)
     {
-        DCHECK(!write_.queue.empty());
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(read_.buffer.constData());
+        const int64_t size = read_.end - read_.begin;
+
+        data += read_.begin;
+
+        // Read the variable-length size of the message.
+        uint32_t message_size = 0;
+        int64_t length_data_size = 0;
+
+        for (int64_t i = 0; i < std::min(size, int64_t(4)); ++i)
+        {
+            const uint8_t byte = data[i];
+
+            if (i < 3)
+                message_size += (byte & 0x7F) << (i * 7);
+            else
+                message_size += byte << 21;
+
+            if (!(byte & 0x80) || i == 3)
+            {
+                length_data_size = i + 1;
+                break;
+            }
+        }
 
-        // Delete the sent message from the queue.
-        write_.queue.pop();
+        // The size is not received completely yet.
+        if (!length_data_size)
+            return true;
 
-        // If the queue is not empty, then we send the following message.
-        if (!write_.queue.empty())
-            scheduleWrite();
+        if (!message_size || message_size > kMaxMessageSize)
+        {
+            emit errorOccurred(Error::UNKNOWN);
+            return false;
+        }
+
+        // The message is not received completely yet.
+        if (size - length_data_size < message_size)
+            return true;
+
+        read_.begin += length_data_size + message_size;
+
+        if (!onMessageReceived(reinterpret_cast<const char*>(data) + length_data_size,
+                               message_size))
+        {
+            return false;
+        }
     }
-    else
+
+    return false;
+}
+
+void Channel::onMessageWritten(const WrittenMessage& message)
+{
+    if (message.is_internal)
     {
         internalMessageWritten();
+        return;
     }
+
+    // If the queue is not empty, then we send the following messages.
+    scheduleWrite();
+
+    // The message is not completely written until its last fragment is written.
+    if (!message.source_size)
+        return;
+
+    write_.pending_bytes -= message.source_size;
+    emit messageWritten();
 }
 
-void Channel::onMessageReceived()
+bool Channel::onMessageReceived(const char* data, int size)
 {
     if (channel_state_ == ChannelState::ENCRYPTED)
     {
-        int decrypted_data_size = cryptor_->decryptedDataSize(read_.buffer.size());
+        int decrypted_data_size = cryptor_->decryptedDataSize(size);
 
         if (decrypt_buffer_.capacity() < decrypted_data_size)
             decrypt_buffer_.reserve(decrypted_data_size);
 
         decrypt_buffer_.resize(decrypted_data_size);
 
-        if (!cryptor_->decrypt(read_.buffer.constData(),
-                               read_.buffer.size(),
-                               decrypt_buffer_.data()))
+        // The message is decrypted directly from the receive buffer.
+        if (!cryptor_->decrypt(data, size, decrypt_buffer_.data()))
         {
             emit errorOccurred(Error::DECRYPTION_FAILURE);
-            return;
+            return false;
         }
 
-        emit messageReceived(decrypt_buffer_);
+        if (fragments_enabled_)
+            return onFragmentReceived();
+
+        emit messageReceived(decrypt_buffer_, base::MessagePriority::CONTROL);
     }
     else
     {
-        internalMessageReceived(read_.buffer);
+        internalMessageReceived(QByteArray(data, size));
     }
 
-    // Read next message.
-    onReadyRead();
+    return true;
 }
 
-void Channel::scheduleWrite()
+bool Channel::onFragmentReceived()
 {
-    const QByteArray& source_buffer = write_.queue.front();
+    if (decrypt_buffer_.isEmpty())
+    {
+        emit errorOccurred(Error::PROTOCOL_FAILURE);
+        return false;
+    }
 
-    // Calculate the size of the encrypted message.
-    size_t encrypted_data_size = cryptor_->encryptedDataSize(source_buffer.size());
-    if (encrypted_data_size > kMaxMessageSize)
+    // The last byte contains the priority of the message and the flag of the next fragment.
+    const uint8_t trailer = static_cast<uint8_t>(decrypt_buffer_.at(decrypt_buffer_.size() - 1));
+    const int priority = trailer & kPriorityMask;
+
+    decrypt_buffer_.chop(1);
+
+    QByteArray& message = read_.fragments[priority];
+
+    if (!(trailer & kMoreFragmentsFlag) && message.isEmpty())
+    {
+        // The message is not fragmented.
+        emit messageReceived(decrypt_buffer_, static_cast<base::MessagePriority>(priority));
+        return true;
+    }
+
+    const int64_t message_size = static_cast<int64_t>(message.size()) + decrypt_buffer_.size();
+    if (message_size > kMaxMessageSize)
     {
         emit errorOccurred(Error::UNKNOWN);
-        return;
+        return false;
     }
 
-    uint8_t length_data[4];
-    size_t length_data_size = 1;
+    // The buffer of the message is increased in advance to not reallocate it for each fragment.
+    if (message.capacity() < message_size)
+    {
+        message.reserve(std::min<int64_t>(
+            std::max<int64_t>(message_size, message.capacity() * 2), kMaxMessageSize));
+    }
+
+    message.append(decrypt_buffer_);
+
+    if (trailer & kMoreFragmentsFlag)
+        return true;
+
+    emit messageReceived(message, static_cast<base::MessagePriority>(priority));
+
+    // The memory of the buffer is kept for the next fragmented message.
+    message.resize(0);
+    return true;
+}
+
+void Channel::scheduleWrite()
+{
+    // The messages are encrypted while the network writes the previous ones. Video and file data
+    // are passed to the socket with a lower limit.
+    for (;;)
+    {
+        int priority;
+
+        if (!nextQueuedMessage(&priority))
+            return;
+
+        const int64_t max_bytes_in_flight =
+            priority < static_cast<int>(base::MessagePriority::VIDEO) ?
+            kMaxBytesInFlight : kMaxLowPriorityBytesInFlight;
+
+        if (write_.bytes_in_flight >= max_bytes_in_flight)
+            return;
+
+        if (!writeNextBuffer())
+            return;
+    }
+}
+
+bool Channel::writeNextBuffer()
+{
+    int priority;
+    QueuedMessage* message = nextQueuedMessage(&priority);
+    DCHECK(message);
 
-    // Calculate the variable-length.
-    length_data[0] = encrypted_data_size & 0x7F;
-    if (encrypted_data_size > 0x7F) // 127 bytes
+    // A large message which is not split into fragments is encrypted in its own buffer, and the
+    // buffer is passed to the socket as is.
+    if (!isFragmented(*message) && message->buffer.size() > kMaxCoalescedSize)
     {
-        length_data[0] |= 0x80;
-        length_data[length_data_size++] = encrypted_data_size >> 7 & 0x7F;
+        if (!encryptMessage(message, priority))
+            return false;
 
-        if (encrypted_data_size > 0x3FFF) // 16383 bytes
-        {
-            length_data[1] |= 0x80;
-            length_data[length_data_size++] = encrypted_data_size >> 14 & 0x7F;
+        const int64_t message_size = message->buffer.size();
 
-            if (encrypted_data_size > 0x1FFFF) // 2097151 bytes
-            {
-                length_data[2] |= 0x80;
-                length_data[length_data_size++] = encrypted_data_size >> 21 & 0xFF;
-            }
+        write_.messages.push_back({ message_size, message->source_size, false, true });
+        write_.bytes_in_flight += message_size;
+        write_.buffers.emplace_back(std::move(message->buffer));
+        write_.queues[priority].pop_front();
+
+        socket_->write(write_.buffers.back());
+        return true;
+    }
+
+    // Small messages and fragments are combined. Before each part the queue with the highest
+    // priority is selected again.
+    QByteArray buffer = takeWriteBuffer(kMaxCoalescedSize);
+    int64_t total_size = 0;
+
+    while (message)
+    {
+        const int64_t part_size = partSize(*message);
+
+        if (total_size + part_size > kMaxCoalescedSize)
+            break;
+
+        bool is_last_part;
+
+        if (!writePart(message, priority, buffer.data() + total_size, &is_last_part))
+            return false;
+
+        write_.messages.push_back(
+            { part_size, is_last_part ? message->source_size : 0, false, false });
+        total_size += part_size;
+
+        if (is_last_part)
+        {
+            releaseWriteBuffer(std::move(message->buffer));
+            write_.queues[priority].pop_front();
         }
+
+        message = nextQueuedMessage(&priority);
     }
 
-    // Now we can calculate the full size.
-    int total_size = length_data_size + encrypted_data_size;
+    DCHECK(total_size);
 
-    // If the reserved buffer size is less, then increase it.
-    if (write_.buffer.capacity() < total_size)
-        write_.buffer.reserve(total_size);
+    write_.messages.back().is_last_in_buffer = true;
+    write_.bytes_in_flight += total_size;
 
-    // Change the size of the buffer.
-    write_.buffer.resize(total_size);
+    buffer.resize(total_size);
+    write_.buffers.emplace_back(std::move(buffer));
 
-    // Copy the size of the message to the buffer.
-    memcpy(write_.buffer.data(), length_data, length_data_size);
+    // Send the buffer to the recipient. The socket writes it to the network in parts itself.
+    socket_->write(write_.buffers.back());
+    return true;
+}
+
+bool Channel::writePart(QueuedMessage* message, int priority, char* output, bool* is_last_part)
+{
+    if (!isFragmented(*message))
+    {
+        if (!encryptMessage(message, priority))
+            return false;
+
+        memcpy(output, message->buffer.constData(), message->buffer.size());
+        *is_last_part = true;
+        return true;
+    }
+
+    // The source message is located at the end of the buffer before the trailing byte.
+    char* source = message->buffer.data() + message->buffer.size() - 1 - message->source_size;
+    char* fragment = source + message->bytes_sent;
 
-    // Encrypt the message.
-    if (!cryptor_->encrypt(source_buffer.constData(),
-                           source_buffer.size(),
-                           write_.buffer.data() + length_data_size))
+    const int64_t fragment_size =
+        std::min(message->source_size - message->bytes_sent, kMaxFragmentSize);
+    const bool has_more_fragments = message->bytes_sent + fragment_size < message->source_size;
+
+    // The trailing byte of the fragment temporarily replaces the first byte of the next one.
+    char* trailer = fragment + fragment_size;
+    const char next_byte = *trailer;
+
+    *trailer = static_cast<char>(priority | (has_more_fragments ? kMoreFragmentsFlag : 0));
+
+    const size_t encrypted_data_size = cryptor_->encryptedDataSize(fragment_size + 1);
+    const size_t length_data_size =
+        writeMessageSize(encrypted_data_size, reinterpret_cast<uint8_t*>(output));
+
+    const bool result = cryptor_->encrypt(fragment, fragment_size + 1, output + length_data_size);
+
+    *trailer = next_byte;
+
+    if (!result)
     {
         emit errorOccurred(Error::ENCRYPTION_FAILURE);
-        return;
+        return false;
+    }
+
+    message->bytes_sent += fragment_size;
+    *is_last_part = !has_more_fragments;
+    return true;
+}
+
+bool Channel::encryptMessage(QueuedMessage* message, int priority)
+{
+    const size_t data_size = messageDataSize(message->source_size);
+
+    // The trailing byte contains the priority of the message.
+    if (fragments_enabled_)
+        message->buffer.data()[message->buffer.size() - 1] = static_cast<char>(priority);
+
+    // The encrypted data follows the size of the message to the end of the buffer.
+    const size_t encrypted_data_size = cryptor_->encryptedDataSize(data_size);
+    char* encrypted_data = message->buffer.data() + message->buffer.size() - encrypted_data_size;
+
+    // The nonce of the cryptor is incremented for each message, so the messages are encrypted
+    // strictly in the order of sending.
+    if (!cryptor_->encryptInPlace(encrypted_data, data_size))
+    {
+        emit errorOccurred(Error::ENCRYPTION_FAILURE);
+        return false;
+    }
+
+    return true;
+}
+
+char* Channel::prepareMessage(size_t source_size, base::MessagePriority priority)
+{
+    // Calculate the size of the encrypted message.
+    const size_t encrypted_data_size = cryptor_->encryptedDataSize(messageDataSize(source_size));
+    if (!source_size || encrypted_data_size > kMaxMessageSize)
+        return nullptr;
+
+    QByteArray buffer = takeWriteBuffer(writtenMessageSize(encrypted_data_size));
+
+    // Copy the size of the message to the buffer.
+    writeMessageSize(encrypted_data_size, reinterpret_cast<uint8_t*>(buffer.data()));
+
+    auto& queue = write_.queues[static_cast<int>(priority)];
+
+    queue.push_back({ std::move(buffer), static_cast<int64_t>(source_size), 0 });
+    write_.pending_bytes += source_size;
+
+    // The source message is placed at the end of the buffer before the trailing byte.
+    QByteArray& queued_buffer = queue.back().buffer;
+    return queued_buffer.data() + queued_buffer.size() - (fragments_enabled_ ? 1 : 0) - source_size;
+}
+
+Channel::QueuedMessage* Channel::nextQueuedMessage(int* priority)
+{
+    for (int i = 0; i < base::kMessagePriorityCount; ++i)
+    {
+        if (!write_.queues[i].empty())
+        {
+            *priority = i;
+            return &write_.queues[i].front();
+        }
+    }
+
+    return nullptr;
+}
+
+size_t Channel::messageDataSize(size_t source_size) const
+{
+    return fragments_enabled_ ? source_size + 1 : source_size;
+}
+
+bool Channel::isFragmented(const QueuedMessage& message) const
+{
+    return fragments_enabled_ && message.source_size > kMaxFragmentSize;
+}
+
+int64_t Channel::partSize(const QueuedMessage& message) const
+{
+    if (!isFragmented(message))
+        return message.buffer.size();
+
+    const int64_t fragment_size =
+        std::min(message.source_size - message.bytes_sent, kMaxFragmentSize);
+
+    return writtenMessageSize(cryptor_->encryptedDataSize(fragment_size + 1));
+}
+
+QByteArray Channel::takeWriteBuffer(int64_t size)
+{
+    // The smallest buffer which is large enough is taken. If there is no such buffer, the largest
+    // one is enlarged.
+    auto best = write_.free_buffers.end();
+
+    for (auto it = write_.free_buffers.begin(); it != write_.free_buffers.end(); ++it)
+    {
+        if (best == write_.free_buffers.end())
+        {
+            best = it;
+            continue;
+        }
+
+        const bool is_enough = it->capacity() >= size;
+        const bool is_best_enough = best->capacity() >= size;
+
+        if (is_enough != is_best_enough)
+        {
+            if (is_enough)
+                best = it;
+        }
+        else if (is_enough == (it->capacity() < best->capacity()))
+        {
+            best = it;
+        }
+    }
+
+    QByteArray buffer;
+
+    if (best != write_.free_buffers.end())
+    {
+        buffer = std::move(*best);
+        write_.free_buffers.erase(best);
     }
 
-    // Send the buffer to the recipient.
-    socket_->write(write_.buffer);
+    // If the reserved buffer size is less, then increase it.
+    if (buffer.capacity() < size)
+        buffer.reserve(size);
+
+    buffer.resize(size);
+    return buffer;
+}
+
+void Channel::releaseWriteBuffer(QByteArray&& buffer)
+{
+    if (write_.free_buffers.size() < kMaxFreeBuffers)
+        write_.free_buffers.emplace_back(std::move(buffer));
 }
 
 } // namespace net
@@ -20,6 +20,7 @@
 #define NET__NETWORK_CHANNEL_H
 
 #include "base/macros_magic.h"
+#include "base/message_priority.h"
 #include "base/version.h"
 
 #if defined(USE_TBB)
@@ -29,12 +30,20 @@
 #include <QPointer>
 #include <QTcpSocket>
 
-#include <queue>
+#include <array>
+#include <deque>
+#include <vector>
 
 namespace crypto {
 class Cryptor;
 } // namespace crypto
 
+namespace google {
+namespace protobuf {
+class MessageLite;
+} // namespace protobuf
+} // namespace google
+
 namespace net {
 
 class Channel : public QObject
@@ -78,6 +87,13 @@ public:
     // Returns the version of the connected peer.
     base::Version peerVersion() const { return peer_version_; }
 
+    // Returns the total size of the messages in the sending queue.
+    int64_t pendingBytes() const { return write_.pending_bytes; }
+
+    // Sends a message. The message is serialized directly into the send buffer.
+    void sendMessage(const google::protobuf::MessageLite& message,
+                     base::MessagePriority priority = base::MessagePriority::CONTROL);
+
 signals:
     // Emits when the connection is aborted.
     void disconnected();
@@ -85,8 +101,12 @@ signals:
     // Emitted when an error occurred. Parameter |message| contains a text description of the error.
     void errorOccurred(Error error);
 
-    // Emitted when a new message is received.
-    void messageReceived(const QByteArray& buffer);
+    // Emitted when a new message is received. |priority| is the priority with which the peer sent
+    // the message. If the peer does not support fragments, it is always CONTROL.
+    void messageReceived(const QByteArray& buffer, base::MessagePriority priority);
+
+    // Emitted when a message from the sending queue is completely written to the socket.
+    void messageWritten();
 
 public slots:
     // Starts reading messages from the channel. After receiving each new message, the signal
@@ -102,8 +122,10 @@ public slots:
     // need to call slot |start|.
     void pause();
 
-    // Sends a message.
-    void send(const QByteArray& buffer);
+    // Sends a message. The channel copies the message and does not keep |buffer|. The queued
+    // messages of a higher priority are sent first.
+    void send(const QByteArray& buffer,
+              base::MessagePriority priority = base::MessagePriority::CONTROL);
 
 protected:
     QPointer<QTcpSocket> socket_;
@@ -115,6 +137,11 @@ protected:
     ChannelState channel_state_ = ChannelState::NOT_CONNECTED;
     KeyExchangeState key_exchange_state_ = KeyExchangeState::HELLO;
 
+    // If true, the large messages are split into fragments and each encrypted message ends with
+    // the byte of its priority (see proto::CHANNEL_FEATURE_FRAGMENTS). Set after the key exchange
+    // if both sides support it.
+    bool fragments_enabled_ = false;
+
     Channel(ChannelType channel_type, QTcpSocket* socket, QObject* parent);
 
     void sendInternal(const QByteArray& buffer);
@@ -126,12 +153,80 @@ private slots:
     void onError(QAbstractSocket::SocketError error);
     void onBytesWritten(int64_t bytes);
     void onReadyRead();
-    void onMessageWritten();
-    void onMessageReceived();
 
 private:
+    // Information about a message passed to the socket.
+    struct WrittenMessage
+    {
+        // Size of the message with the header.
+        int64_t size;
+
+        // Size of the source message in the sending queue. 0 for internal messages and fragments
+        // which are not the last ones.
+        int64_t source_size;
+
+        bool is_internal;
+
+        // True if the message is the last one in its write buffer.
+        bool is_last_in_buffer;
+    };
+
+    // A message in the sending queue.
+    struct QueuedMessage
+    {
+        // The message with the space for its size and the authentication data of the cryptor
+        // in front and the trailing byte if the fragments are used. The message is encrypted in
+        // place. The fragments are encrypted into the write buffers.
+        QByteArray buffer;
+
+        // Size of the source message.
+        int64_t source_size;
+
+        // Number of bytes of the source message sent in fragments.
+        int64_t bytes_sent;
+    };
+
+    void onMessageWritten(const WrittenMessage& message);
+
+    // Processes the complete messages in the receive buffer. Returns false if the channel is
+    // paused or an error occurred.
+    bool readMessages();
+    bool onMessageReceived(const char* data, int size);
+
+    // Processes the message in |decrypt_buffer_| if the fragments are used.
+    bool onFragmentReceived();
+
+    // Encrypts the messages from the beginning of the queue and passes them to the socket while
+    // the size of the data not yet written to the network is less than the limit.
     void scheduleWrite();
 
+    // Encrypts the next messages from the queues and passes them to the socket with one buffer.
+    bool writeNextBuffer();
+
+    // Encrypts the message or its next fragment to |output|.
+    bool writePart(QueuedMessage* message, int priority, char* output, bool* is_last_part);
+    bool encryptMessage(QueuedMessage* message, int priority);
+
+    // Adds a message of |source_size| bytes to the queue. Returns the pointer to which the message
+    // should be written or nullptr if the size is invalid.
+    char* prepareMessage(size_t source_size, base::MessagePriority priority);
+
+    // Returns the first message of the queue with the highest priority or nullptr if the queues
+    // are empty.
+    QueuedMessage* nextQueuedMessage(int* priority);
+
+    // Returns the size of the encrypted data of the message with the trailing byte.
+    size_t messageDataSize(size_t source_size) const;
+
+    bool isFragmented(const QueuedMessage& message) const;
+
+    // Returns the size of the message or its next fragment written to the socket.
+    int64_t partSize(const QueuedMessage& message) const;
+
+    // Returns a buffer of |size| bytes. The buffers are reused.
+    QByteArray takeWriteBuffer(int64_t size);
+    void releaseWriteBuffer(QByteArray&& buffer);
+
     const ChannelType channel_type_;
 
     // To this buffer decrypts the data received from the network.
@@ -140,39 +235,53 @@ private:
     struct WriteContext
     {
 #if defined(USE_TBB)
-        using QueueAllocator = tbb::scalable_allocator<QByteArray>;
+        using QueueAllocator = tbb::scalable_allocator<QueuedMessage>;
 #else // defined(USE_TBB)
-        using QueueAllocator = std::allocator<QByteArray>;
+        using QueueAllocator = std::allocator<QueuedMessage>;
 #endif // defined(USE_*)
 
-        using QueueContainer = std::deque<QByteArray, QueueAllocator>;
+        // The queues contain unencrypted messages which are not passed to the socket yet. There is
+        // a queue for each priority.
+        std::array<std::deque<QueuedMessage, QueueAllocator>, base::kMessagePriorityCount> queues;
 
-        // The queue contains unencrypted source messages.
-        std::queue<QByteArray, QueueContainer> queue;
+        // The buffers contain the encrypted messages that are being sent to the current moment.
+        // The messages are encrypted ahead while the socket writes the previous buffers.
+        std::deque<QByteArray> buffers;
 
-        // The buffer contains an encrypted message that is being sent to the current moment.
-        QByteArray buffer;
+        // The buffers which can be used for the next messages.
+        std::vector<QByteArray> free_buffers;
 
-        // Number of bytes transferred from the |buffer|.
+        // The messages passed to the socket which are not completely written yet.
+        std::deque<WrittenMessage> messages;
+
+        // Number of bytes of the first message in |messages| written to the network.
         int64_t bytes_transferred = 0;
+
+        // Total size of |buffers|.
+        int64_t bytes_in_flight = 0;
+
+        // Total size of the messages in |queues|.
+        int64_t pending_bytes = 0;
     };
 
     struct ReadContext
     {
         bool paused = false;
 
-        // To this buffer reads data from the network.
+        // To this buffer reads data from the network. All the data available in the socket is
+        // read at once. The buffer contains the messages which are not processed yet and the
+        // beginning of the next message.
         QByteArray buffer;
 
-        // If the flag is set to true, then the buffer size is read from the network, if false,
-        // then no.
-        bool buffer_size_received = false;
+        // Offset of the first unprocessed byte in |buffer|.
+        int64_t begin = 0;
 
-        // Size of |buffer|.
-        int buffer_size = 0;
+        // Offset of the end of the data in |buffer|.
+        int64_t end = 0;
 
-        // Number of bytes read into the |buffer|.
-        int64_t bytes_transferred = 0;
+        // The fragments of the messages which are not received completely. There is a buffer for
+        // each priority.
+        std::array<QByteArray, base::kMessagePriorityCount> fragments;
     };
 
     ReadContext read_;
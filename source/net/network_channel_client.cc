@@ -271,8 +271,15 @@ void ChannelClient::readSessionChallenge(const QByteArray& buffer)
     peer_version_ = base::Version(
         host_version.major(), host_version.minor(), host_version.patch());
 
+    // The features supported by both sides are used after the response.
+    const uint32_t channel_features =
+        session_challenge.channel_features() & proto::CHANNEL_FEATURE_FRAGMENTS;
+
+    fragments_enabled_ = channel_features & proto::CHANNEL_FEATURE_FRAGMENTS;
+
     proto::SessionResponse session_response;
     session_response.set_session_type(session_type_);
+    session_response.set_channel_features(channel_features);
 
     proto::Version* client_version = session_response.mutable_version();
     client_version->set_major(ASPIA_VERSION_MAJOR);
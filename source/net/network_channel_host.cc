@@ -189,6 +189,7 @@ void ChannelHost::readClientKeyExchange(const QByteArray& buffer)
 
     proto::SessionChallenge session_challenge;
     session_challenge.set_session_types(srp_host_->sessionTypes());
+    session_challenge.set_channel_features(proto::CHANNEL_FEATURE_FRAGMENTS);
 
     proto::Version* host_version = session_challenge.mutable_version();
     host_version->set_major(ASPIA_VERSION_MAJOR);
@@ -245,6 +246,9 @@ void ChannelHost::readSessionResponse(const QByteArray& buffer)
     username_ = srp_host_->userName();
     session_type_ = session_response.session_type();
 
+    // The client selects the features offered in the challenge.
+    fragments_enabled_ = session_response.channel_features() & proto::CHANNEL_FEATURE_FRAGMENTS;
+
     key_exchange_state_ = KeyExchangeState::DONE;
     channel_state_ = ChannelState::ENCRYPTED;
 
@@ -0,0 +1,453 @@
+//
+// Aspia Project
+// Copyright (C) 2019 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "net/network_channel.h"
+#include "crypto/cryptor_aes256_gcm.h"
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTcpServer>
+#include <QTimer>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace net {
+
+namespace {
+
+const int kLargeMessageSize = 2 * 1024 * 1024;
+const int kSmallMessageSize = 64;
+const int kLargeMessageCount = 32;
+
+// Number of the messages of the test of the receive path.
+const int kSmallMessageCount = 100000;
+
+// Number of the small messages sent after each large one (input echo, cursor, clipboard).
+const int kSmallMessagesPerLarge = 16;
+
+// Size of the writes of the previous implementation of the channel.
+const int kChunkSize = 1200;
+
+const int kTimeout = 60000; // 60 seconds
+
+// Sizes of the messages of the ordering test: the limits of the size header and the messages
+// which are written with the coalesced ones or alone.
+const int kOrderTestSizes[] = { 1, 127, 128, 16383, 16384, 70000, 300000 };
+const int kOrderTestRounds = 4;
+
+// Size of the file data message sent before the input message. It is larger than the limit of
+// the low priority data passed to the socket ahead.
+const int kBulkMessageSize = 2 * 1024 * 1024;
+
+// The channel which is encrypted from the start. The key exchange is not needed for the test.
+class TestChannel : public Channel
+{
+public:
+    TestChannel(QTcpSocket* socket, bool is_host, bool fragments_enabled = false)
+        : Channel(is_host ? ChannelType::HOST : ChannelType::CLIENT, socket, nullptr)
+    {
+        const QByteArray key =
+            QByteArray::fromHex("5ce26794165a808ec425684e9384c27c22499512a513da8b455bd39746dc5014");
+        const QByteArray host_iv = QByteArray::fromHex("ee7eb0e6fb24d445597f3e6f");
+        const QByteArray client_iv = QByteArray::fromHex("924988304848184805f07167");
+
+        if (is_host)
+            cryptor_.reset(crypto::CryptorAes256Gcm::create(key, host_iv, client_iv));
+        else
+            cryptor_.reset(crypto::CryptorAes256Gcm::create(key, client_iv, host_iv));
+
+        channel_state_ = ChannelState::ENCRYPTED;
+        fragments_enabled_ = fragments_enabled;
+    }
+
+protected:
+    void internalMessageReceived(const QByteArray& /* buffer */) override {}
+    void internalMessageWritten() override {}
+};
+
+// Connected sockets over the loopback interface.
+class SocketPair
+{
+public:
+    SocketPair()
+    {
+        server_.listen(QHostAddress::LocalHost);
+
+        QEventLoop loop;
+        QObject::connect(&server_, &QTcpServer::newConnection, &loop, &QEventLoop::quit);
+        QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+        client_ = new QTcpSocket();
+        client_->connectToHost(QHostAddress::LocalHost, server_.serverPort());
+
+        loop.exec();
+
+        host_ = server_.nextPendingConnection();
+        if (host_)
+            host_->setParent(nullptr);
+    }
+
+    ~SocketPair()
+    {
+        delete client_;
+        delete host_;
+    }
+
+    // The ownership of the sockets can be passed to the channels.
+    QTcpSocket* releaseClient() { QTcpSocket* socket = client_; client_ = nullptr; return socket; }
+    QTcpSocket* releaseHost() { QTcpSocket* socket = host_; host_ = nullptr; return socket; }
+
+    QTcpSocket* client() const { return client_; }
+    QTcpSocket* host() const { return host_; }
+
+private:
+    QTcpServer server_;
+    QTcpSocket* client_ = nullptr;
+    QTcpSocket* host_ = nullptr;
+};
+
+QByteArray createMessage(int size, int index)
+{
+    return QByteArray(size, static_cast<char>(index));
+}
+
+double megabytesPerSecond(int64_t bytes, int64_t milliseconds)
+{
+    const double seconds = std::max<int64_t>(milliseconds, 1) / 1000.0;
+    return static_cast<double>(bytes) / (1024 * 1024) / seconds;
+}
+
+} // namespace
+
+// The messages of different sizes are received in order and intact.
+TEST(network_channel_test, message_order)
+{
+    SocketPair sockets;
+    ASSERT_TRUE(sockets.host());
+
+    TestChannel host(sockets.releaseHost(), true);
+    TestChannel client(sockets.releaseClient(), false);
+
+    std::vector<QByteArray> messages;
+
+    for (int i = 0; i < kOrderTestRounds; ++i)
+    {
+        for (int size : kOrderTestSizes)
+            messages.emplace_back(createMessage(size, static_cast<int>(messages.size())));
+    }
+
+    size_t received_count = 0;
+    bool has_error = false;
+
+    QEventLoop loop;
+
+    QObject::connect(&client, &Channel::messageReceived, [&](const QByteArray& buffer)
+    {
+        if (received_count >= messages.size() || buffer != messages[received_count])
+        {
+            has_error = true;
+            loop.quit();
+            return;
+        }
+
+        if (++received_count == messages.size())
+            loop.quit();
+    });
+
+    QObject::connect(&host, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+    QObject::connect(&client, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+
+    QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+    client.start();
+
+    for (const auto& message : messages)
+        host.send(message);
+
+    loop.exec();
+
+    EXPECT_FALSE(has_error);
+    EXPECT_EQ(received_count, messages.size());
+}
+
+// Sends the large and small messages through the channel and checks that all of them are received
+// in order and intact.
+TEST(network_channel_test, DISABLED_throughput)
+{
+    SocketPair sockets;
+    ASSERT_TRUE(sockets.host());
+
+    TestChannel host(sockets.releaseHost(), true);
+    TestChannel client(sockets.releaseClient(), false);
+
+    std::vector<QByteArray> messages;
+
+    for (int i = 0; i < kLargeMessageCount; ++i)
+    {
+        messages.emplace_back(createMessage(kLargeMessageSize, i));
+
+        for (int j = 0; j < kSmallMessagesPerLarge; ++j)
+            messages.emplace_back(createMessage(kSmallMessageSize, j));
+    }
+
+    int64_t total_size = 0;
+    for (const auto& message : messages)
+        total_size += message.size();
+
+    size_t received_count = 0;
+    bool has_error = false;
+
+    QEventLoop loop;
+
+    QObject::connect(&client, &Channel::messageReceived, [&](const QByteArray& buffer)
+    {
+        if (received_count >= messages.size() || buffer != messages[received_count])
+        {
+            has_error = true;
+            loop.quit();
+            return;
+        }
+
+        if (++received_count == messages.size())
+            loop.quit();
+    });
+
+    QObject::connect(&host, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+    QObject::connect(&client, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+
+    QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+    client.start();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const auto& message : messages)
+        host.send(message);
+
+    loop.exec();
+
+    const int64_t elapsed = timer.elapsed();
+
+    EXPECT_FALSE(has_error);
+    EXPECT_EQ(received_count, messages.size());
+
+    printf("Channel: %lld bytes in %lld ms (%.1f MB/s)\n",
+           static_cast<long long>(total_size), static_cast<long long>(elapsed),
+           megabytesPerSecond(total_size, elapsed));
+}
+
+// Many small messages are read from the socket at once and parsed in one pass.
+TEST(network_channel_test, DISABLED_small_messages_throughput)
+{
+    SocketPair sockets;
+    ASSERT_TRUE(sockets.host());
+
+    TestChannel host(sockets.releaseHost(), true);
+    TestChannel client(sockets.releaseClient(), false);
+
+    int received_count = 0;
+    bool has_error = false;
+
+    QEventLoop loop;
+
+    QObject::connect(&client, &Channel::messageReceived, [&](const QByteArray& buffer)
+    {
+        if (buffer != createMessage(kSmallMessageSize, received_count % 128))
+        {
+            has_error = true;
+            loop.quit();
+            return;
+        }
+
+        if (++received_count == kSmallMessageCount)
+            loop.quit();
+    });
+
+    QObject::connect(&host, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+    QObject::connect(&client, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+
+    QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+    client.start();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < kSmallMessageCount; ++i)
+        host.send(createMessage(kSmallMessageSize, i % 128));
+
+    loop.exec();
+
+    const int64_t elapsed = timer.elapsed();
+
+    EXPECT_FALSE(has_error);
+    EXPECT_EQ(received_count, kSmallMessageCount);
+
+    printf("Small messages: %d messages in %lld ms\n",
+           kSmallMessageCount, static_cast<long long>(elapsed));
+}
+
+// A control message sent after a large file data message is received before it. The large message
+// is split into fragments and is received intact.
+TEST(network_channel_test, priority_fragments)
+{
+    SocketPair sockets;
+    ASSERT_TRUE(sockets.host());
+
+    TestChannel host(sockets.releaseHost(), true, true);
+    TestChannel client(sockets.releaseClient(), false, true);
+
+    const QByteArray bulk_message = createMessage(kBulkMessageSize, 1);
+    const QByteArray control_message = createMessage(kSmallMessageSize, 2);
+
+    std::vector<base::MessagePriority> received_priorities;
+    bool has_error = false;
+
+    QEventLoop loop;
+
+    QObject::connect(&client, &Channel::messageReceived,
+                     [&](const QByteArray& buffer, base::MessagePriority priority)
+    {
+        const QByteArray& expected = priority == base::MessagePriority::BULK ?
+            bulk_message : control_message;
+
+        if (buffer != expected)
+        {
+            has_error = true;
+            loop.quit();
+            return;
+        }
+
+        received_priorities.push_back(priority);
+        if (received_priorities.size() == 2)
+            loop.quit();
+    });
+
+    QObject::connect(&host, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+    QObject::connect(&client, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+
+    QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+    client.start();
+
+    host.send(bulk_message, base::MessagePriority::BULK);
+    host.send(control_message, base::MessagePriority::CONTROL);
+
+    loop.exec();
+
+    EXPECT_FALSE(has_error);
+    ASSERT_EQ(received_priorities.size(), 2u);
+    EXPECT_EQ(received_priorities[0], base::MessagePriority::CONTROL);
+    EXPECT_EQ(received_priorities[1], base::MessagePriority::BULK);
+}
+
+// A message larger than the limit breaks the connection as soon as its size is received.
+TEST(network_channel_test, message_size_limit)
+{
+    SocketPair sockets;
+    ASSERT_TRUE(sockets.host());
+
+    QTcpSocket* sender = sockets.host();
+    TestChannel client(sockets.releaseClient(), false);
+
+    bool has_error = false;
+
+    QEventLoop loop;
+
+    QObject::connect(&client, &Channel::errorOccurred, [&]() { has_error = true; loop.quit(); });
+    QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+    client.start();
+
+    // The size of 16 MB + 1 byte. The body of the message is not sent.
+    const char kSize[] = { '\x81', '\x80', '\x80', '\x08' };
+    sender->write(kSize, sizeof(kSize));
+
+    loop.exec();
+
+    EXPECT_TRUE(has_error);
+}
+
+// The previous write path of the channel for comparison: the data is passed to the socket in
+// small parts, the next part is written after the socket reports the previous one.
+TEST(network_channel_test, DISABLED_chunked_write_throughput)
+{
+    SocketPair sockets;
+    ASSERT_TRUE(sockets.host());
+
+    QTcpSocket* sender = sockets.host();
+    QTcpSocket* receiver = sockets.client();
+
+    const int64_t total_size = static_cast<int64_t>(kLargeMessageCount) *
+        (kLargeMessageSize + kSmallMessagesPerLarge * kSmallMessageSize);
+
+    const QByteArray data = createMessage(kLargeMessageSize, 0);
+
+    int64_t bytes_written = 0;
+    int64_t bytes_received = 0;
+
+    QEventLoop loop;
+
+    auto write_chunk = [&]()
+    {
+        if (bytes_written >= total_size)
+            return;
+
+        const int64_t size = std::min(total_size - bytes_written, static_cast<int64_t>(kChunkSize));
+
+        sender->write(data.constData(), size);
+        bytes_written += size;
+    };
+
+    QObject::connect(sender, &QTcpSocket::bytesWritten, [&](int64_t /* bytes */)
+    {
+        if (!sender->bytesToWrite())
+            write_chunk();
+    });
+
+    QObject::connect(receiver, &QTcpSocket::readyRead, [&]()
+    {
+        bytes_received += receiver->readAll().size();
+
+        if (bytes_received >= total_size)
+            loop.quit();
+    });
+
+    QTimer::singleShot(kTimeout, &loop, &QEventLoop::quit);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    write_chunk();
+    loop.exec();
+
+    const int64_t elapsed = timer.elapsed();
+
+    EXPECT_EQ(bytes_received, total_size);
+
+    printf("Chunked writes: %lld bytes in %lld ms (%.1f MB/s)\n",
+           static_cast<long long>(total_size), static_cast<long long>(elapsed),
+           megabytesPerSecond(total_size, elapsed));
+}
+
+} // namespace net